@@ -0,0 +1,337 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "Vector3.h"
+#include "Matrix4x4.h"
+#include "Quaternion.h"
+#include "InstanceData.h"
+#include "ThreadPool.h"
+
+struct VectorKey {
+    float time;
+    Vector3 value;
+};
+
+struct RotationKey {
+    float time;
+    Quaternion value;
+};
+
+// Keyframed translation, rotation and scale tracks of many objects, sampled
+// together into model matrices (translation * rotation * scale). Objects
+// are evaluated in batches of BATCH: their keys are gathered into
+// structure-of-arrays lanes, interpolated and composed there with loops the
+// compiler vectorizes, then stored. Each track remembers the key segment it
+// used last, so finding the keys is O(1) while time moves forward; random
+// jumps fall back to a binary search. Times before the first key or after
+// the last one hold that key's value.
+class AnimationSet {
+public:
+    enum class Interpolation {
+        NLERP,  // Normalized lerp, cheapest; not constant speed on wide arcs
+        SLERP   // Constant angular speed
+    };
+
+private:
+    enum : size_t { BATCH = 64 };
+    
+    // Keys of all objects back to back; object i owns [first[i], first[i + 1])
+    struct Channel {
+        std::vector<float> times;
+        std::vector<float> values;
+        std::vector<uint32_t> first;
+        std::vector<uint32_t> cursor;
+        size_t components;
+        
+        explicit Channel(size_t components) : first(1, 0), components(components) {}
+        
+        void addTrack(size_t keyCount) {
+            cursor.push_back(first.back());
+            first.push_back(static_cast<uint32_t>(first.back() + keyCount));
+        }
+        
+        // Key k and the blend factor towards key k + 1 (0 when clamped)
+        void locate(size_t object, float time, uint32_t& k, float& alpha) {
+            uint32_t begin = first[object];
+            uint32_t last = first[object + 1] - 1;
+            const float* t = times.data();
+            alpha = 0.0f;
+            if (!(time > t[begin])) {
+                k = begin;
+                return;
+            }
+            if (time >= t[last]) {
+                k = last;
+                return;
+            }
+            k = cursor[object];
+            if (!(t[k] <= time && time < t[k + 1])) {
+                if (t[k + 1] <= time && time < t[k + 2]) {
+                    k++;
+                } else {
+                    k = static_cast<uint32_t>(std::upper_bound(t + begin, t + last + 1, time) - t - 1);
+                }
+                cursor[object] = k;
+            }
+            alpha = (time - t[k]) / (t[k + 1] - t[k]);
+        }
+        
+        // Component c of key k and of the key it blends towards
+        void gather(uint32_t k, float alpha, size_t c, float& a, float& b) const {
+            a = values[k * components + c];
+            b = alpha > 0.0f ? values[(k + 1) * components + c] : a;
+        }
+    };
+    
+    Channel translation;
+    Channel rotation;
+    Channel scale;
+    Interpolation interpolation = Interpolation::NLERP;
+    float duration = 0.0f;
+    
+    template <typename Key>
+    static void checkTimes(const std::vector<Key>& keys) {
+        for (size_t i = 1; i < keys.size(); i++) {
+            if (!(keys[i].time > keys[i - 1].time)) {
+                throw std::invalid_argument("AnimationSet: key times must be strictly increasing");
+            }
+        }
+    }
+    
+    void addVectorTrack(Channel& channel, const std::vector<VectorKey>& keys, const Vector3& rest) {
+        if (keys.empty()) {
+            channel.times.push_back(0.0f);
+            channel.values.insert(channel.values.end(), { rest.x, rest.y, rest.z });
+            channel.addTrack(1);
+            return;
+        }
+        for (const auto& key : keys) {
+            channel.times.push_back(key.time);
+            channel.values.insert(channel.values.end(), { key.value.x, key.value.y, key.value.z });
+        }
+        channel.addTrack(keys.size());
+        duration = std::max(duration, keys.back().time);
+    }
+    
+    // Unit quaternions, each in the hemisphere of its predecessor so
+    // interpolation takes the shorter arc without a per-sample sign test
+    void addRotationTrack(const std::vector<RotationKey>& keys) {
+        if (keys.empty()) {
+            rotation.times.push_back(0.0f);
+            rotation.values.insert(rotation.values.end(), { 1.0f, 0.0f, 0.0f, 0.0f });
+            rotation.addTrack(1);
+            return;
+        }
+        Quaternion previous;
+        for (size_t i = 0; i < keys.size(); i++) {
+            Quaternion q = keys[i].value.normalize();
+            if (i > 0 && q.dot(previous) < 0.0f) q = Quaternion(-q.w, -q.x, -q.y, -q.z);
+            rotation.times.push_back(keys[i].time);
+            rotation.values.insert(rotation.values.end(), { q.w, q.x, q.y, q.z });
+            previous = q;
+        }
+        rotation.addTrack(keys.size());
+        duration = std::max(duration, keys.back().time);
+    }
+    
+    // Samples objects [begin, end) and calls store(object, m, lane) with
+    // the top three rows of each model matrix in m[row * 4 + column][lane]
+    template <typename Store>
+    void evaluateRange(size_t begin, size_t end, float time, const Store& store) {
+        float ta[3][BATCH], tb[3][BATCH], tAlpha[BATCH];
+        float qa[4][BATCH], qb[4][BATCH], qAlpha[BATCH];
+        float sa[3][BATCH], sb[3][BATCH], sAlpha[BATCH];
+        float m[12][BATCH];
+        
+        for (size_t base = begin; base < end; base += BATCH) {
+            size_t n = std::min<size_t>(BATCH, end - base);
+            
+            // Gather the bracketing keys of every track into lanes
+            for (size_t i = 0; i < n; i++) {
+                uint32_t k;
+                translation.locate(base + i, time, k, tAlpha[i]);
+                for (size_t c = 0; c < 3; c++) translation.gather(k, tAlpha[i], c, ta[c][i], tb[c][i]);
+                rotation.locate(base + i, time, k, qAlpha[i]);
+                for (size_t c = 0; c < 4; c++) rotation.gather(k, qAlpha[i], c, qa[c][i], qb[c][i]);
+                scale.locate(base + i, time, k, sAlpha[i]);
+                for (size_t c = 0; c < 3; c++) scale.gather(k, sAlpha[i], c, sa[c][i], sb[c][i]);
+            }
+            // The math below always runs over full batches, which lets the
+            // compiler vectorize it without a remainder loop; spare lanes of
+            // the last batch hold the rest pose
+            for (size_t i = n; i < BATCH; i++) {
+                tAlpha[i] = qAlpha[i] = sAlpha[i] = 0.0f;
+                for (size_t c = 0; c < 3; c++) {
+                    ta[c][i] = tb[c][i] = 0.0f;
+                    sa[c][i] = sb[c][i] = 1.0f;
+                }
+                for (size_t c = 0; c < 4; c++) qa[c][i] = qb[c][i] = c == 0 ? 1.0f : 0.0f;
+            }
+            
+            for (size_t c = 0; c < 3; c++) {
+                for (size_t i = 0; i < BATCH; i++) {
+                    ta[c][i] += (tb[c][i] - ta[c][i]) * tAlpha[i];
+                    sa[c][i] += (sb[c][i] - sa[c][i]) * sAlpha[i];
+                }
+            }
+            
+            // Blend weights of the two rotation keys, per lane
+            float wa[BATCH], wb[BATCH];
+            for (size_t i = 0; i < BATCH; i++) {
+                wa[i] = 1.0f - qAlpha[i];
+                wb[i] = qAlpha[i];
+            }
+            if (interpolation == Interpolation::SLERP) {
+                for (size_t i = 0; i < BATCH; i++) {
+                    float cosTheta = qa[0][i] * qb[0][i] + qa[1][i] * qb[1][i] + qa[2][i] * qb[2][i] + qa[3][i] * qb[3][i];
+                    if (qAlpha[i] == 0.0f || cosTheta > 0.9995f) continue;
+                    float theta = std::acos(std::min(cosTheta, 1.0f));
+                    float invSin = 1.0f / std::sin(theta);
+                    wa[i] = std::sin(wa[i] * theta) * invSin;
+                    wb[i] = std::sin(wb[i] * theta) * invSin;
+                }
+            }
+            float q[4][BATCH];
+            for (size_t c = 0; c < 4; c++) {
+                for (size_t i = 0; i < BATCH; i++) q[c][i] = qa[c][i] * wa[i] + qb[c][i] * wb[i];
+            }
+            
+            // Same matrix as TransformationPipeline::composeModelMatrix, for a
+            // quaternion of any length: scaling the products by 2 / |q|^2
+            // replaces normalizing q and its square root, which would not
+            // vectorize
+            for (size_t i = 0; i < BATCH; i++) {
+                float w = q[0][i], x = q[1][i], y = q[2][i], z = q[3][i];
+                float s = 2.0f / (w * w + x * x + y * y + z * z);
+                float xx = s * x * x, yy = s * y * y, zz = s * z * z;
+                float xy = s * x * y, xz = s * x * z, yz = s * y * z;
+                float wx = s * w * x, wy = s * w * y, wz = s * w * z;
+                m[0][i] = (1.0f - (yy + zz)) * sa[0][i];
+                m[1][i] = (xy - wz) * sa[1][i];
+                m[2][i] = (xz + wy) * sa[2][i];
+                m[3][i] = ta[0][i];
+                m[4][i] = (xy + wz) * sa[0][i];
+                m[5][i] = (1.0f - (xx + zz)) * sa[1][i];
+                m[6][i] = (yz - wx) * sa[2][i];
+                m[7][i] = ta[1][i];
+                m[8][i] = (xz - wy) * sa[0][i];
+                m[9][i] = (yz + wx) * sa[1][i];
+                m[10][i] = (1.0f - (xx + yy)) * sa[2][i];
+                m[11][i] = ta[2][i];
+            }
+            
+            for (size_t i = 0; i < n; i++) store(base + i, m, i);
+        }
+    }
+    
+    template <typename Store>
+    void evaluateAll(float time, ThreadPool& pool, const Store& store) {
+        pool.parallelForRange(objectCount(), BATCH * 4, [&](size_t begin, size_t end) {
+            evaluateRange(begin, end, time, store);
+        });
+    }
+
+public:
+    AnimationSet() : translation(3), rotation(4), scale(3) {}
+    
+    // Adds an object with the given tracks and returns its index. Empty
+    // tracks hold the rest pose (no translation or rotation, unit scale).
+    // Key times must be strictly increasing within each track.
+    size_t addObject(const std::vector<VectorKey>& translationKeys,
+                     const std::vector<RotationKey>& rotationKeys,
+                     const std::vector<VectorKey>& scaleKeys) {
+        checkTimes(translationKeys);
+        checkTimes(rotationKeys);
+        checkTimes(scaleKeys);
+        addVectorTrack(translation, translationKeys, Vector3(0.0f, 0.0f, 0.0f));
+        addRotationTrack(rotationKeys);
+        addVectorTrack(scale, scaleKeys, Vector3(1.0f, 1.0f, 1.0f));
+        return objectCount() - 1;
+    }
+    
+    size_t objectCount() const {
+        return translation.cursor.size();
+    }
+    
+    // Time of the last key of any track
+    float getDuration() const {
+        return duration;
+    }
+    
+    void setInterpolation(Interpolation mode) {
+        interpolation = mode;
+    }
+    
+    Interpolation getInterpolation() const {
+        return interpolation;
+    }
+    
+    // One object's pose, without batching
+    void sample(size_t object, float time, Vector3& position, Quaternion& orientation, Vector3& size) {
+        uint32_t k;
+        float alpha, a, b;
+        float v[4];
+        translation.locate(object, time, k, alpha);
+        for (size_t c = 0; c < 3; c++) {
+            translation.gather(k, alpha, c, a, b);
+            v[c] = a + (b - a) * alpha;
+        }
+        position = Vector3(v[0], v[1], v[2]);
+        
+        scale.locate(object, time, k, alpha);
+        for (size_t c = 0; c < 3; c++) {
+            scale.gather(k, alpha, c, a, b);
+            v[c] = a + (b - a) * alpha;
+        }
+        size = Vector3(v[0], v[1], v[2]);
+        
+        rotation.locate(object, time, k, alpha);
+        const float* qa = &rotation.values[k * 4];
+        orientation = Quaternion(qa[0], qa[1], qa[2], qa[3]);
+        if (alpha > 0.0f) {
+            const float* qb = &rotation.values[(k + 1) * 4];
+            Quaternion next(qb[0], qb[1], qb[2], qb[3]);
+            orientation = interpolation == Interpolation::SLERP ? Quaternion::slerp(orientation, next, alpha)
+                                                                : Quaternion::nlerp(orientation, next, alpha);
+        }
+    }
+    
+    // Model matrices of all objects at the given time; out must hold
+    // objectCount() matrices
+    void evaluate(float time, Matrix4x4* out, ThreadPool& pool = ThreadPool::shared()) {
+        evaluateAll(time, pool, [out](size_t object, const float (&m)[12][BATCH], size_t lane) {
+            float (&r)[4][4] = out[object].m;
+            for (int row = 0; row < 3; row++) {
+                for (int col = 0; col < 4; col++) r[row][col] = m[row * 4 + col][lane];
+            }
+            r[3][0] = 0.0f;
+            r[3][1] = 0.0f;
+            r[3][2] = 0.0f;
+            r[3][3] = 1.0f;
+        });
+    }
+    
+    void evaluate(float time, std::vector<Matrix4x4>& out, ThreadPool& pool = ThreadPool::shared()) {
+        out.resize(objectCount());
+        evaluate(time, out.data(), pool);
+    }
+    
+    // Instance transforms of all objects, ready for renderInstances; colors
+    // are left untouched
+    void evaluate(float time, InstanceData* out, ThreadPool& pool = ThreadPool::shared()) {
+        evaluateAll(time, pool, [out](size_t object, const float (&m)[12][BATCH], size_t lane) {
+            float (&r)[3][4] = out[object].transform;
+            for (int row = 0; row < 3; row++) {
+                for (int col = 0; col < 4; col++) r[row][col] = m[row * 4 + col][lane];
+            }
+        });
+    }
+};
+
+#endif
\ No newline at end of file
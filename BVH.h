@@ -0,0 +1,238 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "BoundingVolume.h"
+#include "Frustum.h"
+
+// Bounding volume hierarchy over scene instances, each given by its
+// world-space AABB and addressed by its index. Nodes are stored depth
+// first, so a child always follows its parent and refitting walks the
+// array backwards. Moving instances only marks their leaves and the
+// ancestors above them; refit() recomputes exactly those boxes. When
+// refitting has inflated the tree (total node surface area more than
+// REBUILD_GROWTH times the area after the last build), the next refit()
+// rebuilds it instead.
+class BVH {
+public:
+    static const uint32_t MAX_LEAF_SIZE = 4;
+    static constexpr float REBUILD_GROWTH = 2.0f;
+
+private:
+    struct Node {
+        AABB bounds;
+        // Leaves: first entry in instanceOrder. Interior nodes: right child
+        // (the left child is the next node).
+        uint32_t offset;
+        // Instances in a leaf, 0 for interior nodes
+        uint32_t count;
+        uint32_t parent;
+    };
+    
+    static const uint32_t NO_PARENT = UINT32_MAX;
+    
+    std::vector<Node> nodes;
+    std::vector<uint8_t> nodeDirty;
+    std::vector<AABB> instanceBounds;
+    // Build-time centers, indexed like instanceBounds
+    std::vector<Vector3> centers;
+    std::vector<uint32_t> instanceOrder;
+    std::vector<uint32_t> leafOf;
+    
+    float builtArea = 0.0f;
+    float currentArea = 0.0f;
+    bool anyDirty = false;
+    size_t rebuildCount = 0;
+    
+    uint32_t buildRange(uint32_t begin, uint32_t end, uint32_t parent) {
+        uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node());
+        Node node;
+        node.parent = parent;
+        
+        AABB centroids;
+        for (uint32_t i = begin; i < end; i++) {
+            uint32_t instance = instanceOrder[i];
+            node.bounds.expand(instanceBounds[instance]);
+            if (!instanceBounds[instance].isEmpty()) centroids.expand(centers[instance]);
+        }
+        
+        if (end - begin <= MAX_LEAF_SIZE || centroids.isEmpty()) {
+            node.offset = begin;
+            node.count = end - begin;
+            for (uint32_t i = begin; i < end; i++) leafOf[instanceOrder[i]] = index;
+            nodes[index] = node;
+            return index;
+        }
+        
+        // Median split along the widest axis of the centroids
+        Vector3 size = centroids.max - centroids.min;
+        int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+        uint32_t middle = begin + (end - begin) / 2;
+        const float* keys = &centers[0].x + axis;
+        std::nth_element(instanceOrder.begin() + begin, instanceOrder.begin() + middle, instanceOrder.begin() + end,
+                         [keys](uint32_t a, uint32_t b) { return keys[a * 3] < keys[b * 3]; });
+        
+        node.count = 0;
+        buildRange(begin, middle, index);
+        node.offset = buildRange(middle, end, index);
+        nodes[index] = node;
+        return index;
+    }
+    
+    float totalArea() const {
+        float area = 0.0f;
+        for (const auto& node : nodes) area += node.bounds.surfaceArea();
+        return area;
+    }
+
+public:
+    BVH() {}
+    
+    explicit BVH(const std::vector<AABB>& bounds) {
+        build(bounds);
+    }
+    
+    void build(const std::vector<AABB>& bounds) {
+        instanceBounds = bounds;
+        rebuild();
+    }
+    
+    // Rebuilds the tree from the current instance bounds
+    void rebuild() {
+        size_t count = instanceBounds.size();
+        if (count >= UINT32_MAX) throw std::length_error("BVH: too many instances");
+        
+        nodes.clear();
+        nodes.reserve(count > 0 ? 2 * count : 1);
+        instanceOrder.resize(count);
+        for (size_t i = 0; i < count; i++) instanceOrder[i] = static_cast<uint32_t>(i);
+        leafOf.assign(count, 0);
+        centers.resize(count);
+        for (size_t i = 0; i < count; i++) centers[i] = instanceBounds[i].center();
+        if (count > 0) buildRange(0, static_cast<uint32_t>(count), NO_PARENT);
+        
+        nodeDirty.assign(nodes.size(), 0);
+        builtArea = currentArea = totalArea();
+        anyDirty = false;
+        rebuildCount++;
+    }
+    
+    // Marks the instance's leaf and ancestors for the next refit()
+    void setInstanceBounds(size_t instance, const AABB& bounds) {
+        instanceBounds[instance] = bounds;
+        for (uint32_t node = leafOf[instance]; node != NO_PARENT && !nodeDirty[node]; node = nodes[node].parent) {
+            nodeDirty[node] = 1;
+        }
+        anyDirty = true;
+    }
+    
+    // Recomputes the boxes of dirty nodes bottom-up, or rebuilds the tree
+    // once refitting has made it too loose
+    void refit() {
+        if (!anyDirty) return;
+        for (size_t i = nodes.size(); i-- > 0;) {
+            if (!nodeDirty[i]) continue;
+            Node& node = nodes[i];
+            AABB bounds;
+            if (node.count > 0) {
+                for (uint32_t k = 0; k < node.count; k++) bounds.expand(instanceBounds[instanceOrder[node.offset + k]]);
+            } else {
+                bounds.expand(nodes[i + 1].bounds);
+                bounds.expand(nodes[node.offset].bounds);
+            }
+            currentArea += bounds.surfaceArea() - node.bounds.surfaceArea();
+            node.bounds = bounds;
+            nodeDirty[i] = 0;
+        }
+        anyDirty = false;
+        
+        if (currentArea > REBUILD_GROWTH * builtArea) rebuild();
+    }
+    
+    // Calls visit(instance) for every instance whose box intersects the
+    // frustum. Subtrees fully inside skip the remaining plane tests.
+    template <typename Visit>
+    void cull(const Frustum& frustum, CullStats& stats, Visit visit) const {
+        if (nodes.empty()) return;
+        
+        struct Entry {
+            uint32_t node;
+            uint32_t planeMask;
+        };
+        Entry stack[64];
+        size_t depth = 0;
+        stack[depth++] = { 0, Frustum::ALL_PLANES };
+        
+        while (depth > 0) {
+            Entry entry = stack[--depth];
+            const Node& node = nodes[entry.node];
+            uint32_t planeMask = entry.planeMask;
+            
+            if (planeMask != 0) {
+                stats.nodesTested++;
+                if (frustum.classify(node.bounds, planeMask) == Frustum::OUTSIDE) {
+                    stats.objectsCulled += subtreeSize(entry.node);
+                    continue;
+                }
+            }
+            
+            if (node.count > 0) {
+                for (uint32_t k = 0; k < node.count; k++) {
+                    uint32_t instance = instanceOrder[node.offset + k];
+                    uint32_t instanceMask = planeMask;
+                    if (instanceMask != 0) {
+                        stats.objectsTested++;
+                        if (frustum.classify(instanceBounds[instance], instanceMask) == Frustum::OUTSIDE) {
+                            stats.objectsCulled++;
+                            continue;
+                        }
+                    }
+                    stats.objectsDrawn++;
+                    visit(instance);
+                }
+            } else {
+                // Median splits keep the depth near log2(n / MAX_LEAF_SIZE)
+                if (depth + 2 > sizeof(stack) / sizeof(stack[0])) throw std::runtime_error("BVH: tree too deep");
+                stack[depth++] = { node.offset, planeMask };
+                stack[depth++] = { entry.node + 1, planeMask };
+            }
+        }
+    }
+    
+    // Instances below a node: leaves are contiguous in instanceOrder
+    size_t subtreeSize(uint32_t index) const {
+        uint32_t first = index;
+        while (nodes[first].count == 0) first++;
+        uint32_t last = index;
+        while (nodes[last].count == 0) last = nodes[last].offset;
+        return nodes[last].offset + nodes[last].count - nodes[first].offset;
+    }
+    
+    size_t instanceCount() const {
+        return instanceBounds.size();
+    }
+    
+    size_t nodeCount() const {
+        return nodes.size();
+    }
+    
+    size_t rebuilds() const {
+        return rebuildCount;
+    }
+    
+    const AABB& bounds() const {
+        static const AABB empty;
+        return nodes.empty() ? empty : nodes[0].bounds;
+    }
+    
+    const AABB& instance(size_t index) const {
+        return instanceBounds[index];
+    }
+};
+
+#endif
\ No newline at end of file
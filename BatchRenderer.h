@@ -0,0 +1,463 @@
+#ifndef BATCH_RENDERER_H
+#define BATCH_RENDERER_H
+
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Vector3.h"
+#include "Object3D.h"
+#include "MeshCache.h"
+#include "Texture.h"
+#include "ImageIO.h"
+#include "SoftwareRenderer.h"
+#include "InstanceData.h"
+#include "ThreadPool.h"
+
+// One object of a batch job's scene. Rotation is in degrees; spin adds
+// degrees per frame on top of it.
+struct BatchObject {
+    std::string mesh;
+    std::string texture;
+    std::array<float, 3> color = {{ 1.0f, 1.0f, 1.0f }};
+    Vector3 position;
+    Vector3 rotation;
+    Vector3 scale = Vector3(1.0f, 1.0f, 1.0f);
+    Vector3 spin;
+};
+
+struct CameraKey {
+    int frame;
+    Vector3 position;
+    Vector3 target;
+};
+
+// A sequence of frames of one scene, written to numbered image files
+struct RenderJob {
+    std::string name;
+    std::string output;
+    int width = 640;
+    int height = 480;
+    int frames = 1;
+    bool wireframe = false;
+    bool lighting = true;
+    bool textures = true;
+    bool depthTest = true;
+    RenderBackend::CullMode cullMode = RenderBackend::CullMode::None;
+    std::array<float, 3> background = {{ 0.1f, 0.1f, 0.1f }};
+    std::vector<BatchObject> objects;
+    
+    // Keyed camera path, interpolated linearly and held before the first
+    // and after the last key. An orbit radius above zero replaces it with a
+    // turntable around the target of the first key (or the origin).
+    std::vector<CameraKey> camera;
+    float orbitRadius = 0.0f;
+    float orbitHeight = 0.0f;
+    float orbitDegreesPerFrame = 0.0f;
+    
+    void cameraAt(int frame, Vector3& position, Vector3& target) const {
+        position = Vector3(0.0f, 0.0f, 5.0f);
+        target = Vector3(0.0f, 0.0f, 0.0f);
+        if (!camera.empty()) {
+            position = camera.front().position;
+            target = camera.front().target;
+            for (size_t i = 0; i + 1 < camera.size(); i++) {
+                const CameraKey& a = camera[i];
+                const CameraKey& b = camera[i + 1];
+                if (frame < a.frame) break;
+                if (frame >= b.frame) {
+                    position = b.position;
+                    target = b.target;
+                    continue;
+                }
+                float t = static_cast<float>(frame - a.frame) / (b.frame - a.frame);
+                position = a.position + (b.position - a.position) * t;
+                target = a.target + (b.target - a.target) * t;
+                break;
+            }
+        }
+        if (orbitRadius > 0.0f) {
+            float angle = frame * orbitDegreesPerFrame * static_cast<float>(M_PI) / 180.0f;
+            position = target + Vector3(orbitRadius * std::sin(angle), orbitHeight, orbitRadius * std::cos(angle));
+        }
+    }
+    
+    // The output pattern with its run of '#' replaced by the zero-padded
+    // frame number
+    std::string framePath(int frame) const {
+        size_t first = output.find('#');
+        if (first == std::string::npos) return output;
+        size_t last = output.find_first_not_of('#', first);
+        size_t digits = (last == std::string::npos ? output.size() : last) - first;
+        std::string number = std::to_string(frame);
+        if (number.size() < digits) number.insert(0, digits - number.size(), '0');
+        return output.substr(0, first) + number + output.substr(first + digits);
+    }
+};
+
+// Meshes and textures shared by all jobs, each loaded once. Built-in meshes
+// are "cube", "pyramid", "tetrahedron" and "sphere" or "sphere:<segments>";
+// anything else is a mesh file imported through MeshCache. Built-in
+// textures are the procedural "checkerboard", "brick" and "gradient";
+// anything else is a binary PPM file. Loading is not thread-safe: load
+// everything up front, then share the cache read-only.
+class AssetCache {
+private:
+    std::map<std::string, std::unique_ptr<Object3D>> meshes;
+    std::map<std::string, std::unique_ptr<Texture>> textures;
+    
+    static Object3D loadMesh(const std::string& name) {
+        if (name == "cube") return Object3D::createCube(1.0f);
+        if (name == "pyramid") return Object3D::createPyramid(1.0f, 1.5f);
+        if (name == "tetrahedron") return Object3D::createTetrahedron(1.0f);
+        if (name == "sphere") return Object3D::createSphere(1.0f, 32);
+        if (name.compare(0, 7, "sphere:") == 0) {
+            int segments = std::atoi(name.c_str() + 7);
+            if (segments < 3) throw std::runtime_error("Bad sphere resolution: " + name);
+            return Object3D::createSphere(1.0f, segments);
+        }
+        return MeshCache::load(name).toObject3D();
+    }
+    
+    static Texture loadTexture(const std::string& name) {
+        if (name == "checkerboard" || name == "brick" || name == "gradient") {
+            return Texture::createProcedural(name);
+        }
+        int width = 0, height = 0;
+        std::vector<uint32_t> texels = ImageIO::readPPM(name, width, height);
+        return Texture(width, height, texels.data());
+    }
+
+public:
+    const Object3D& mesh(const std::string& name) {
+        std::unique_ptr<Object3D>& slot = meshes[name];
+        if (!slot) slot.reset(new Object3D(loadMesh(name)));
+        return *slot;
+    }
+    
+    const Texture& texture(const std::string& name) {
+        std::unique_ptr<Texture>& slot = textures[name];
+        if (!slot) slot.reset(new Texture(loadTexture(name)));
+        return *slot;
+    }
+    
+    // Already loaded assets only; throws for anything else
+    const Object3D& loadedMesh(const std::string& name) const {
+        auto it = meshes.find(name);
+        if (it == meshes.end()) throw std::runtime_error("Mesh not loaded: " + name);
+        return *it->second;
+    }
+    
+    const Texture& loadedTexture(const std::string& name) const {
+        auto it = textures.find(name);
+        if (it == textures.end()) throw std::runtime_error("Texture not loaded: " + name);
+        return *it->second;
+    }
+    
+    size_t meshCount() const {
+        return meshes.size();
+    }
+    
+    size_t textureCount() const {
+        return textures.size();
+    }
+};
+
+// Headless rendering of job files to image sequences. A job file is plain
+// text, one statement per line, a word starting with '#' starting a
+// comment:
+//
+//   job <name>                  starts a job, closed by "end"
+//   output <path>               .ppm, .png or .exr; a run of '#' becomes
+//                               the zero-padded frame number
+//   size <width> <height>
+//   frames <count>
+//   wireframe|lighting|textures|depthtest on|off
+//   cull none|back|front|both
+//   background <r> <g> <b>
+//   camera <frame> <px> <py> <pz> <tx> <ty> <tz>
+//   orbit <radius> <height> <degrees per frame>
+//   object <mesh> [color r g b] [texture name] [position x y z]
+//                 [rotation x y z] [scale x y z] [spin x y z]
+//
+// Frames of all jobs are independent and are spread over the thread pool,
+// each rendered by its own single-threaded SoftwareRenderer. When there
+// are fewer frames than threads the frames run one after another with the
+// pool rendering each of them instead. Throws std::runtime_error on
+// malformed job files, missing assets and unwritable outputs.
+class BatchRenderer {
+private:
+    struct Parser {
+        std::istringstream line;
+        std::string source;
+        int lineNumber;
+        
+        std::runtime_error error(const std::string& message) const {
+            return std::runtime_error(source + ":" + std::to_string(lineNumber) + ": " + message);
+        }
+        
+        std::string word() {
+            std::string value;
+            if (!(line >> value)) throw error("missing argument");
+            return value;
+        }
+        
+        float number() {
+            float value;
+            if (!(line >> value)) throw error("expected a number");
+            return value;
+        }
+        
+        int integer() {
+            int value;
+            if (!(line >> value)) throw error("expected an integer");
+            return value;
+        }
+        
+        Vector3 vector() {
+            float x = number();
+            float y = number();
+            float z = number();
+            return Vector3(x, y, z);
+        }
+        
+        bool flag() {
+            std::string value = word();
+            if (value == "on") return true;
+            if (value == "off") return false;
+            throw error("expected on or off, got " + value);
+        }
+        
+        RenderBackend::CullMode cullMode() {
+            std::string value = word();
+            if (value == "none") return RenderBackend::CullMode::None;
+            if (value == "back") return RenderBackend::CullMode::Back;
+            if (value == "front") return RenderBackend::CullMode::Front;
+            if (value == "both") return RenderBackend::CullMode::FrontAndBack;
+            throw error("expected none, back, front or both, got " + value);
+        }
+        
+        bool atEnd() {
+            line >> std::ws;
+            return line.eof();
+        }
+    };
+    
+    // A comment starts at a '#' that begins a word, so frame number
+    // placeholders in output patterns survive
+    static size_t commentStart(const std::string& line) {
+        for (size_t i = 0; i < line.size(); i++) {
+            if (line[i] == '#' && (i == 0 || std::isspace(static_cast<unsigned char>(line[i - 1])))) return i;
+        }
+        return line.size();
+    }
+    
+    struct FrameTask {
+        size_t job;
+        int frame;
+    };
+
+public:
+    static std::vector<RenderJob> parseJobs(const std::string& text, const std::string& source = "jobs") {
+        std::vector<RenderJob> jobs;
+        std::istringstream input(text);
+        std::string rawLine;
+        Parser parser;
+        parser.source = source;
+        parser.lineNumber = 0;
+        bool inJob = false;
+        
+        while (std::getline(input, rawLine)) {
+            parser.lineNumber++;
+            rawLine.erase(commentStart(rawLine));
+            parser.line.clear();
+            parser.line.str(rawLine);
+            if (parser.atEnd()) continue;
+            
+            std::string keyword = parser.word();
+            if (keyword == "job") {
+                if (inJob) throw parser.error("job inside job " + jobs.back().name);
+                jobs.push_back(RenderJob());
+                jobs.back().name = parser.word();
+                inJob = true;
+                continue;
+            }
+            if (!inJob) throw parser.error(keyword + " outside a job");
+            
+            RenderJob& job = jobs.back();
+            if (keyword == "end") {
+                if (job.output.empty()) throw parser.error("job " + job.name + " has no output");
+                if (job.frames > 1 && job.output.find('#') == std::string::npos) {
+                    throw parser.error("job " + job.name + " renders several frames to one file");
+                }
+                inJob = false;
+            } else if (keyword == "output") {
+                job.output = parser.word();
+                try {
+                    ImageIO::formatFor(job.output);
+                } catch (const std::runtime_error& e) {
+                    throw parser.error(e.what());
+                }
+            } else if (keyword == "size") {
+                job.width = parser.integer();
+                job.height = parser.integer();
+                if (job.width <= 0 || job.height <= 0) throw parser.error("size must be positive");
+            } else if (keyword == "frames") {
+                job.frames = parser.integer();
+                if (job.frames <= 0) throw parser.error("frames must be positive");
+            } else if (keyword == "wireframe") {
+                job.wireframe = parser.flag();
+            } else if (keyword == "lighting") {
+                job.lighting = parser.flag();
+            } else if (keyword == "textures") {
+                job.textures = parser.flag();
+            } else if (keyword == "depthtest") {
+                job.depthTest = parser.flag();
+            } else if (keyword == "cull") {
+                job.cullMode = parser.cullMode();
+            } else if (keyword == "background") {
+                Vector3 color = parser.vector();
+                job.background = {{ color.x, color.y, color.z }};
+            } else if (keyword == "camera") {
+                CameraKey key;
+                key.frame = parser.integer();
+                key.position = parser.vector();
+                key.target = parser.vector();
+                if (!job.camera.empty() && key.frame <= job.camera.back().frame) {
+                    throw parser.error("camera keys must be in increasing frame order");
+                }
+                job.camera.push_back(key);
+            } else if (keyword == "orbit") {
+                job.orbitRadius = parser.number();
+                job.orbitHeight = parser.number();
+                job.orbitDegreesPerFrame = parser.number();
+            } else if (keyword == "object") {
+                BatchObject object;
+                object.mesh = parser.word();
+                while (!parser.atEnd()) {
+                    std::string property = parser.word();
+                    if (property == "color") {
+                        Vector3 color = parser.vector();
+                        object.color = {{ color.x, color.y, color.z }};
+                    } else if (property == "texture") {
+                        object.texture = parser.word();
+                    } else if (property == "position") {
+                        object.position = parser.vector();
+                    } else if (property == "rotation") {
+                        object.rotation = parser.vector();
+                    } else if (property == "scale") {
+                        object.scale = parser.vector();
+                    } else if (property == "spin") {
+                        object.spin = parser.vector();
+                    } else {
+                        throw parser.error("unknown object property " + property);
+                    }
+                }
+                job.objects.push_back(object);
+                continue;
+            } else {
+                throw parser.error("unknown statement " + keyword);
+            }
+            if (!parser.atEnd()) throw parser.error("trailing arguments after " + keyword);
+        }
+        if (inJob) throw std::runtime_error(source + ": job " + jobs.back().name + " is missing end");
+        return jobs;
+    }
+    
+    static std::vector<RenderJob> loadJobs(const std::string& path) {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        if (!file) throw std::runtime_error("Cannot open " + path);
+        std::stringstream text;
+        text << file.rdbuf();
+        return parseJobs(text.str(), path);
+    }
+    
+    // Loads every mesh and texture the jobs use, each once
+    static void loadAssets(const std::vector<RenderJob>& jobs, AssetCache& assets) {
+        for (const auto& job : jobs) {
+            for (const auto& object : job.objects) {
+                assets.mesh(object.mesh);
+                if (job.textures && !object.texture.empty()) assets.texture(object.texture);
+            }
+        }
+    }
+    
+    // Renders one frame into the renderer, which must match the job's size
+    static void renderFrame(const RenderJob& job, int frame, const AssetCache& assets, SoftwareRenderer& renderer) {
+        Vector3 position, target;
+        job.cameraAt(frame, position, target);
+        renderer.setCameraPosition(position, target, Vector3(0.0f, 1.0f, 0.0f));
+        renderer.setClearColor(job.background[0], job.background[1], job.background[2]);
+        renderer.setLighting(job.lighting);
+        if (renderer.isWireframeMode() != job.wireframe) renderer.toggleWireframe();
+        if (renderer.isDepthTestEnabled() != job.depthTest) renderer.toggleDepthTest();
+        renderer.setCullMode(job.cullMode);
+        
+        // Objects are drawn as single instances so each gets its own color
+        // without copying the shared mesh; the array lives until endFrame
+        std::vector<InstanceData> instances;
+        instances.reserve(job.objects.size());
+        renderer.beginFrame();
+        for (const auto& object : job.objects) {
+            const Texture* texture = job.textures && !object.texture.empty() ? &assets.loadedTexture(object.texture) : nullptr;
+            renderer.bindTexture(texture);
+            renderer.setModelTransform(object.position, object.rotation + object.spin * static_cast<float>(frame), object.scale);
+            instances.push_back(InstanceData(Matrix4x4(), object.color[0], object.color[1], object.color[2]));
+            renderer.renderInstances(assets.loadedMesh(object.mesh), &instances.back(), 1);
+        }
+        renderer.endFrame();
+    }
+    
+    // Renders and writes every frame of every job. Returns the number of
+    // frames written.
+    static size_t render(const std::vector<RenderJob>& jobs, const AssetCache& assets,
+                         ThreadPool& pool = ThreadPool::shared()) {
+        std::vector<FrameTask> tasks;
+        for (size_t j = 0; j < jobs.size(); j++) {
+            for (int frame = 0; frame < jobs[j].frames; frame++) tasks.push_back({ j, frame });
+        }
+        
+        auto renderTask = [&](const FrameTask& task, ThreadPool& framePool) {
+            const RenderJob& job = jobs[task.job];
+            SoftwareRenderer renderer(job.width, job.height, framePool);
+            renderFrame(job, task.frame, assets, renderer);
+            ImageIO::write(job.framePath(task.frame), job.width, job.height,
+                           renderer.getColorBuffer().data(), renderer.getDepthBuffer().data());
+        };
+        
+        if (tasks.size() < pool.size()) {
+            for (const auto& task : tasks) renderTask(task, pool);
+            return tasks.size();
+        }
+        
+        // The pool is not reentrant, so frames render inline on their worker.
+        // The first failure is rethrown once all workers are done.
+        std::atomic<bool> failed(false);
+        std::string failure;
+        std::mutex failureMutex;
+        pool.parallelFor(tasks.size(), [&](size_t i) {
+            if (failed.load()) return;
+            try {
+                ThreadPool inlinePool(1);
+                renderTask(tasks[i], inlinePool);
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failed.exchange(true)) failure = e.what();
+            }
+        });
+        if (failed.load()) throw std::runtime_error(failure);
+        return tasks.size();
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef BOUNDING_VOLUME_H
+#define BOUNDING_VOLUME_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "Vector3.h"
+#include "Matrix4x4.h"
+
+// Axis-aligned bounding box. Default-constructed boxes are empty: min is
+// +infinity and max is -infinity, so the first expand() sets both.
+struct AABB {
+    Vector3 min;
+    Vector3 max;
+    
+    AABB() : min(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity()),
+             max(-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()) {}
+    
+    AABB(const Vector3& min, const Vector3& max) : min(min), max(max) {}
+    
+    bool isEmpty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+    
+    void expand(const Vector3& p) {
+        min = Vector3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+        max = Vector3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+    }
+    
+    void expand(const AABB& box) {
+        min = Vector3(std::min(min.x, box.min.x), std::min(min.y, box.min.y), std::min(min.z, box.min.z));
+        max = Vector3(std::max(max.x, box.max.x), std::max(max.y, box.max.y), std::max(max.z, box.max.z));
+    }
+    
+    Vector3 center() const {
+        return (min + max) * 0.5f;
+    }
+    
+    // Half the size along each axis
+    Vector3 extents() const {
+        return (max - min) * 0.5f;
+    }
+    
+    float surfaceArea() const {
+        if (isEmpty()) return 0.0f;
+        Vector3 size = max - min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+    
+    // Box around the transformed box (Arvo): the new half-extents are the old
+    // ones through the absolute values of the linear part
+    AABB transformed(const Matrix4x4& matrix) const {
+        if (isEmpty()) return *this;
+        Vector3 c = center();
+        Vector3 e = extents();
+        const float (&m)[4][4] = matrix.m;
+        Vector3 newCenter(m[0][0] * c.x + m[0][1] * c.y + m[0][2] * c.z + m[0][3],
+                          m[1][0] * c.x + m[1][1] * c.y + m[1][2] * c.z + m[1][3],
+                          m[2][0] * c.x + m[2][1] * c.y + m[2][2] * c.z + m[2][3]);
+        Vector3 newExtents(std::fabs(m[0][0]) * e.x + std::fabs(m[0][1]) * e.y + std::fabs(m[0][2]) * e.z,
+                           std::fabs(m[1][0]) * e.x + std::fabs(m[1][1]) * e.y + std::fabs(m[1][2]) * e.z,
+                           std::fabs(m[2][0]) * e.x + std::fabs(m[2][1]) * e.y + std::fabs(m[2][2]) * e.z);
+        return AABB(newCenter - newExtents, newCenter + newExtents);
+    }
+};
+
+struct BoundingSphere {
+    Vector3 center;
+    float radius;
+    
+    BoundingSphere() : radius(-1.0f) {}
+    BoundingSphere(const Vector3& center, float radius) : center(center), radius(radius) {}
+    
+    bool isEmpty() const {
+        return radius < 0.0f;
+    }
+    
+    // Conservative under non-uniform scale: the radius grows by the largest
+    // axis scale
+    BoundingSphere transformed(const Matrix4x4& matrix) const {
+        if (isEmpty()) return *this;
+        const float (&m)[4][4] = matrix.m;
+        float scale = 0.0f;
+        for (int j = 0; j < 3; j++) {
+            scale = std::max(scale, m[0][j] * m[0][j] + m[1][j] * m[1][j] + m[2][j] * m[2][j]);
+        }
+        Vector3 newCenter(m[0][0] * center.x + m[0][1] * center.y + m[0][2] * center.z + m[0][3],
+                          m[1][0] * center.x + m[1][1] * center.y + m[1][2] * center.z + m[1][3],
+                          m[2][0] * center.x + m[2][1] * center.y + m[2][2] * center.z + m[2][3]);
+        return BoundingSphere(newCenter, radius * std::sqrt(scale));
+    }
+};
+
+#endif
\ No newline at end of file
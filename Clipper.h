@@ -0,0 +1,145 @@
+#ifndef CLIPPER_H
+#define CLIPPER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Vector4.h"
+
+// Clipping in homogeneous clip space, before the perspective divide. The
+// near plane is always clipped, so nothing behind the camera is ever
+// divided by w. The side planes are only clipped at a guard band
+// GUARD_BAND times the width of the view: triangles that merely cross the
+// screen edges are left to the rasterizer's bounding-box clamp and never
+// reach the clipper. Primitives entirely outside one plane of the view
+// volume are rejected without clipping.
+class Clipper {
+public:
+    // Half-width of the guard band in normalized device coordinates
+    static constexpr float GUARD_BAND = 8.0f;
+    
+    // Smallest w a vertex may keep, so that the divide stays finite even
+    // for projections whose near plane does not bound w
+    static constexpr float MIN_W = 1e-5f;
+    
+    // Outcode bits: outside a plane of the view volume, beyond the guard
+    // band, or below MIN_W
+    enum : uint32_t {
+        OUTSIDE_LEFT = 1 << 0,
+        OUTSIDE_RIGHT = 1 << 1,
+        OUTSIDE_BOTTOM = 1 << 2,
+        OUTSIDE_TOP = 1 << 3,
+        OUTSIDE_NEAR = 1 << 4,
+        OUTSIDE_FAR = 1 << 5,
+        GUARD_LEFT = 1 << 6,
+        GUARD_RIGHT = 1 << 7,
+        GUARD_BOTTOM = 1 << 8,
+        GUARD_TOP = 1 << 9,
+        OUTSIDE_W = 1 << 10,
+        
+        // A primitive is rejected when all its vertices share one of these
+        REJECT_PLANES = OUTSIDE_LEFT | OUTSIDE_RIGHT | OUTSIDE_BOTTOM | OUTSIDE_TOP |
+                        OUTSIDE_NEAR | OUTSIDE_FAR | OUTSIDE_W,
+        GUARD_PLANES = GUARD_LEFT | GUARD_RIGHT | GUARD_BOTTOM | GUARD_TOP,
+        // and clipped when any of its vertices has one of these
+        CLIP_PLANES = OUTSIDE_W | OUTSIDE_NEAR | GUARD_PLANES
+    };
+    
+    // Clip-space position plus the attributes interpolated along with it
+    struct Vertex {
+        Vector4 position;
+        float u, v;
+    };
+    
+    static uint32_t outcode(const Vector4& c) {
+        float guard = GUARD_BAND * c.w;
+        uint32_t code = 0;
+        if (c.x < -c.w) code |= OUTSIDE_LEFT;
+        if (c.x > c.w) code |= OUTSIDE_RIGHT;
+        if (c.y < -c.w) code |= OUTSIDE_BOTTOM;
+        if (c.y > c.w) code |= OUTSIDE_TOP;
+        if (c.z < -c.w) code |= OUTSIDE_NEAR;
+        if (c.z > c.w) code |= OUTSIDE_FAR;
+        if (c.x < -guard) code |= GUARD_LEFT;
+        if (c.x > guard) code |= GUARD_RIGHT;
+        if (c.y < -guard) code |= GUARD_BOTTOM;
+        if (c.y > guard) code |= GUARD_TOP;
+        if (!(c.w >= MIN_W)) code |= OUTSIDE_W;
+        return code;
+    }
+    
+    // Sutherland-Hodgman clipping of a convex polygon against the planes in
+    // the given outcode bits (the OR of its vertices' outcodes). The result
+    // replaces polygon; scratch is working space. Returns the new vertex
+    // count, below 3 when nothing is left.
+    static size_t clipPolygon(std::vector<Vertex>& polygon, std::vector<Vertex>& scratch, uint32_t planes) {
+        planes = clipPlanes(planes);
+        for (uint32_t plane = 1; plane <= OUTSIDE_W && polygon.size() >= 3; plane <<= 1) {
+            if (!(planes & plane)) continue;
+            scratch.clear();
+            size_t count = polygon.size();
+            for (size_t i = 0; i < count; i++) {
+                const Vertex& a = polygon[i];
+                const Vertex& b = polygon[(i + 1) % count];
+                float da = distance(a.position, plane);
+                float db = distance(b.position, plane);
+                if (da >= 0.0f) scratch.push_back(a);
+                if ((da >= 0.0f) != (db >= 0.0f)) scratch.push_back(lerp(a, b, da / (da - db)));
+            }
+            polygon.swap(scratch);
+        }
+        return polygon.size() >= 3 ? polygon.size() : 0;
+    }
+    
+    // Parametric clipping of a segment; false when nothing is left
+    static bool clipLine(Vertex& a, Vertex& b, uint32_t planes) {
+        planes = clipPlanes(planes);
+        float t0 = 0.0f, t1 = 1.0f;
+        for (uint32_t plane = 1; plane <= OUTSIDE_W; plane <<= 1) {
+            if (!(planes & plane)) continue;
+            float da = distance(a.position, plane);
+            float db = distance(b.position, plane);
+            if (da < 0.0f && db < 0.0f) return false;
+            if (da < 0.0f) t0 = std::max(t0, da / (da - db));
+            if (db < 0.0f) t1 = std::min(t1, da / (da - db));
+        }
+        if (t0 > t1) return false;
+        Vertex start = lerp(a, b, t0);
+        b = lerp(a, b, t1);
+        a = start;
+        return true;
+    }
+
+private:
+    // Only the near, w and guard planes are clipped. Points behind the
+    // camera have meaningless guard bits, so clipping at the near plane
+    // brings in all guard planes too.
+    static uint32_t clipPlanes(uint32_t planes) {
+        planes &= CLIP_PLANES;
+        if (planes & (OUTSIDE_NEAR | OUTSIDE_W)) planes |= GUARD_PLANES;
+        return planes;
+    }
+    
+    // Signed distance to a clipping plane, non-negative inside
+    static float distance(const Vector4& c, uint32_t plane) {
+        switch (plane) {
+            case OUTSIDE_NEAR: return c.z + c.w;
+            case GUARD_LEFT: return c.x + GUARD_BAND * c.w;
+            case GUARD_RIGHT: return GUARD_BAND * c.w - c.x;
+            case GUARD_BOTTOM: return c.y + GUARD_BAND * c.w;
+            case GUARD_TOP: return GUARD_BAND * c.w - c.y;
+            default: return c.w - MIN_W;
+        }
+    }
+    
+    static Vertex lerp(const Vertex& a, const Vertex& b, float t) {
+        Vertex result;
+        result.position = Vector4::lerp(a.position, b.position, t);
+        result.u = a.u + (b.u - a.u) * t;
+        result.v = a.v + (b.v - a.v) * t;
+        return result;
+    }
+};
+
+#endif
\ No newline at end of file
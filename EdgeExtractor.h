@@ -0,0 +1,254 @@
+#ifndef EDGE_EXTRACTOR_H
+#define EDGE_EXTRACTOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Vector3.h"
+#include "ThreadPool.h"
+
+// Derives the unique undirected edges of a polygon mesh from its faces.
+// Every face side is a packed 64-bit key (lower index << bits | higher
+// index, with bits just wide enough for the vertex count), sorted by a
+// parallel MSD radix sort: the faces are walked twice, once to histogram
+// the top digit of every key and once to scatter the keys into their
+// buckets, keeping only the bits below the top digit (32 of them for
+// meshes up to 16M vertices). Each bucket is then sorted and deduplicated
+// on its own, in cache. Edges come out ordered by (first, second) with
+// first < second. Optionally each edge is tagged: boundary edges have one
+// adjacent face, non-manifold edges more than two, and feature edges two
+// faces whose normals differ by more than the feature angle.
+class EdgeExtractor {
+public:
+    enum EdgeFlags : uint8_t {
+        BOUNDARY = 1,
+        FEATURE = 2,
+        NON_MANIFOLD = 4
+    };
+
+private:
+    enum : int { DIGIT_BITS = 11, MAX_TOP_BITS = 16 };
+    enum : size_t { INSERTION_SORT_MAX = 32, MIN_CHUNK_FACES = 1 << 15 };
+    
+    static int bitWidth(uint64_t value) {
+        int bits = 1;
+        while (bits < 64 && (value >> bits) != 0) bits++;
+        return bits;
+    }
+    
+    // Unit normal of a polygon by Newell's method
+    static Vector3 faceNormal(const std::vector<Vector3>& vertices, const std::vector<int>& face) {
+        Vector3 sum(0.0f, 0.0f, 0.0f);
+        if (face.size() < 3) return sum;
+        const Vector3& origin = vertices[face[0]];
+        for (size_t i = 1; i + 1 < face.size(); i++) {
+            sum = sum + (vertices[face[i]] - origin).cross(vertices[face[i + 1]] - origin);
+        }
+        return sum.normalize();
+    }
+    
+    // Calls visit(key, face) for every side of faces [begin, end) that is
+    // not a self-loop
+    template <typename Visit>
+    static void forEachSide(const std::vector<std::vector<int>>& faces, size_t begin, size_t end, int bits, Visit visit) {
+        for (size_t f = begin; f < end; f++) {
+            const std::vector<int>& face = faces[f];
+            size_t n = face.size();
+            if (n < 2) continue;
+            uint64_t previous = static_cast<uint32_t>(face[n - 1]);
+            for (size_t k = 0; k < n; k++) {
+                uint64_t current = static_cast<uint32_t>(face[k]);
+                if (current != previous) {
+                    visit(current < previous ? (current << bits) | previous : (previous << bits) | current,
+                          static_cast<uint32_t>(f));
+                }
+                previous = current;
+            }
+        }
+    }
+    
+    template <typename Key>
+    static void insertionSort(Key* keys, uint32_t* values, size_t count) {
+        for (size_t i = 1; i < count; i++) {
+            Key key = keys[i];
+            uint32_t value = values ? values[i] : 0;
+            size_t j = i;
+            for (; j > 0 && keys[j - 1] > key; j--) {
+                keys[j] = keys[j - 1];
+                if (values) values[j] = values[j - 1];
+            }
+            keys[j] = key;
+            if (values) values[j] = value;
+        }
+    }
+    
+    // Sorts keys whose bits at and above `bits` are equal: distributes them
+    // on the next digit down through the scratch arrays and back, then
+    // recurses into each bucket
+    template <typename Key>
+    static void sortSegment(Key* keys, uint32_t* values, Key* keyScratch, uint32_t* valueScratch,
+                            size_t count, int bits) {
+        if (count <= INSERTION_SORT_MAX || bits == 0) {
+            insertionSort(keys, values, count);
+            return;
+        }
+        int shift = std::max(0, bits - DIGIT_BITS);
+        Key mask = (Key(1) << (bits - shift)) - 1;
+        size_t starts[(1 << DIGIT_BITS) + 1] = {};
+        size_t digits = size_t(mask) + 1;
+        for (size_t i = 0; i < count; i++) starts[((keys[i] >> shift) & mask) + 1]++;
+        for (size_t d = 0; d < digits; d++) starts[d + 1] += starts[d];
+        
+        size_t cursor[1 << DIGIT_BITS];
+        std::copy(starts, starts + digits, cursor);
+        for (size_t i = 0; i < count; i++) {
+            size_t slot = cursor[(keys[i] >> shift) & mask]++;
+            keyScratch[slot] = keys[i];
+            if (values) valueScratch[slot] = values[i];
+        }
+        std::copy(keyScratch, keyScratch + count, keys);
+        if (values) std::copy(valueScratch, valueScratch + count, values);
+        if (shift == 0) return;
+        
+        for (size_t d = 0; d < digits; d++) {
+            size_t n = starts[d + 1] - starts[d];
+            if (n > 1) {
+                sortSegment(keys + starts[d], values ? values + starts[d] : nullptr,
+                            keyScratch + starts[d], valueScratch ? valueScratch + starts[d] : nullptr, n, shift);
+            }
+        }
+    }
+    
+    // Key holds the bits of a packed key below the top digit
+    template <typename Key>
+    static void extractWith(const std::vector<Vector3>& vertices, const std::vector<std::vector<int>>& faces,
+                            std::vector<std::pair<int, int>>& edges, std::vector<uint8_t>* flags,
+                            float featureAngle, ThreadPool& pool, int bits, int topBits) {
+        size_t faceCount = faces.size();
+        int lowBits = 2 * bits - topBits;
+        size_t buckets = size_t(1) << topBits;
+        uint64_t lowMask = (uint64_t(1) << lowBits) - 1;
+        bool tagging = flags != nullptr;
+        
+        size_t chunkCount = std::max<size_t>(1, std::min(pool.size(), faceCount / MIN_CHUNK_FACES));
+        std::vector<size_t> chunkStarts(chunkCount + 1);
+        for (size_t c = 0; c <= chunkCount; c++) chunkStarts[c] = faceCount * c / chunkCount;
+        
+        std::vector<size_t> histograms(chunkCount * buckets, 0);
+        pool.parallelFor(chunkCount, [&](size_t c) {
+            size_t* histogram = &histograms[c * buckets];
+            forEachSide(faces, chunkStarts[c], chunkStarts[c + 1], bits, [&](uint64_t key, uint32_t) {
+                histogram[key >> lowBits]++;
+            });
+        });
+        
+        // Bucket-major prefix sum: chunk c's share of bucket b starts after
+        // all smaller buckets and after earlier chunks' share of b
+        std::vector<size_t> bucketStarts(buckets + 1, 0);
+        size_t keyCount = 0;
+        for (size_t b = 0; b < buckets; b++) {
+            bucketStarts[b] = keyCount;
+            for (size_t c = 0; c < chunkCount; c++) {
+                size_t n = histograms[c * buckets + b];
+                histograms[c * buckets + b] = keyCount;
+                keyCount += n;
+            }
+        }
+        bucketStarts[buckets] = keyCount;
+        
+        // Face of every key, needed only to tag feature edges
+        std::vector<Key> keys(keyCount);
+        std::vector<uint32_t> keyFaces(tagging ? keyCount : 0);
+        pool.parallelFor(chunkCount, [&](size_t c) {
+            size_t* cursor = &histograms[c * buckets];
+            forEachSide(faces, chunkStarts[c], chunkStarts[c + 1], bits, [&](uint64_t key, uint32_t face) {
+                size_t slot = cursor[key >> lowBits]++;
+                keys[slot] = static_cast<Key>(key & lowMask);
+                if (tagging) keyFaces[slot] = face;
+            });
+        });
+        
+        // Sort and count the unique keys of every bucket
+        std::vector<size_t> bucketEdges(buckets + 1, 0);
+        pool.parallelForRange(buckets, 64, [&](size_t begin, size_t end) {
+            std::vector<Key> keyScratch;
+            std::vector<uint32_t> valueScratch;
+            for (size_t b = begin; b < end; b++) {
+                size_t first = bucketStarts[b];
+                size_t count = bucketStarts[b + 1] - first;
+                if (count == 0) continue;
+                if (keyScratch.size() < count) keyScratch.resize(count);
+                if (tagging && valueScratch.size() < count) valueScratch.resize(count);
+                sortSegment(&keys[first], tagging ? &keyFaces[first] : nullptr,
+                            keyScratch.data(), tagging ? valueScratch.data() : nullptr, count, lowBits);
+                size_t unique = 1;
+                for (size_t i = first + 1; i < first + count; i++) unique += keys[i] != keys[i - 1];
+                bucketEdges[b + 1] = unique;
+            }
+        });
+        for (size_t b = 0; b < buckets; b++) bucketEdges[b + 1] += bucketEdges[b];
+        
+        std::vector<Vector3> faceNormals;
+        float featureCosine = std::cos(featureAngle * static_cast<float>(M_PI) / 180.0f);
+        if (tagging) {
+            faceNormals.resize(faceCount);
+            pool.parallelForRange(faceCount, 4096, [&](size_t begin, size_t end) {
+                for (size_t f = begin; f < end; f++) faceNormals[f] = faceNormal(vertices, faces[f]);
+            });
+            flags->assign(bucketEdges[buckets], 0);
+        }
+        
+        uint64_t vertexMask = (uint64_t(1) << bits) - 1;
+        edges.resize(bucketEdges[buckets]);
+        pool.parallelForRange(buckets, 64, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; b++) {
+                size_t edge = bucketEdges[b];
+                size_t last = bucketStarts[b + 1];
+                for (size_t i = bucketStarts[b]; i < last;) {
+                    size_t runEnd = i + 1;
+                    while (runEnd < last && keys[runEnd] == keys[i]) runEnd++;
+                    uint64_t key = (static_cast<uint64_t>(b) << lowBits) | keys[i];
+                    edges[edge] = std::make_pair(static_cast<int>(key >> bits), static_cast<int>(key & vertexMask));
+                    if (tagging) {
+                        size_t faceUses = runEnd - i;
+                        uint8_t flag = 0;
+                        if (faceUses == 1) {
+                            flag = BOUNDARY;
+                        } else if (faceUses > 2) {
+                            flag = NON_MANIFOLD;
+                        } else if (faceNormals[keyFaces[i]].dot(faceNormals[keyFaces[i + 1]]) < featureCosine) {
+                            flag = FEATURE;
+                        }
+                        (*flags)[edge] = flag;
+                    }
+                    edge++;
+                    i = runEnd;
+                }
+            }
+        });
+    }
+
+public:
+    // Replaces edges (and flags, when given) with the unique edges of the
+    // faces. Repeated vertices in a face contribute no self-loop edges.
+    static void extract(const std::vector<Vector3>& vertices, const std::vector<std::vector<int>>& faces,
+                        std::vector<std::pair<int, int>>& edges, std::vector<uint8_t>* flags = nullptr,
+                        float featureAngle = 30.0f, ThreadPool& pool = ThreadPool::shared()) {
+        int bits = bitWidth(vertices.empty() ? 0 : vertices.size() - 1);
+        int keyBits = 2 * bits;
+        
+        // At least one full digit on top so small meshes still spread over
+        // buckets, and as many more as keep the rest within 32 bits
+        int topBits = std::min(keyBits, std::max(static_cast<int>(DIGIT_BITS), keyBits - 32));
+        if (topBits <= MAX_TOP_BITS) {
+            extractWith<uint32_t>(vertices, faces, edges, flags, featureAngle, pool, bits, topBits);
+        } else {
+            extractWith<uint64_t>(vertices, faces, edges, flags, featureAngle, pool, bits, MAX_TOP_BITS);
+        }
+    }
+};
+
+#endif
\ No newline at end of file
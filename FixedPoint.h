@@ -0,0 +1,139 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <cstdint>
+#include <iostream>
+
+// Signed 16.16 fixed-point scalar for deterministic runs: every operation
+// is integer arithmetic, so Vector3T<Fixed> and Matrix4x4T<Fixed> give
+// bit-identical results on every compiler and CPU. The range is about
+// +-32768 at a resolution of 1/65536; sums wrap on overflow, products
+// truncate towards negative infinity and division by zero saturates.
+// sqrt, sin, cos, tan and abs are found through argument-dependent lookup.
+class Fixed {
+public:
+    enum : int { FRACTION_BITS = 16 };
+    
+    int32_t raw;
+    
+    constexpr Fixed() : raw(0) {}
+    constexpr explicit Fixed(int value) : raw(static_cast<int32_t>(static_cast<uint32_t>(value) << FRACTION_BITS)) {}
+    constexpr explicit Fixed(double value)
+        : raw(static_cast<int32_t>(value * ONE + (value < 0.0 ? -0.5 : 0.5))) {}
+    
+    static constexpr Fixed fromRaw(int32_t raw) {
+        return Fixed(raw, RawTag());
+    }
+    
+    constexpr explicit operator double() const {
+        return static_cast<double>(raw) / ONE;
+    }
+    
+    constexpr explicit operator float() const {
+        return static_cast<float>(static_cast<double>(raw) / ONE);
+    }
+    
+    constexpr Fixed operator-() const {
+        return fromRaw(static_cast<int32_t>(0u - static_cast<uint32_t>(raw)));
+    }
+    
+    constexpr Fixed operator+(Fixed b) const {
+        return fromRaw(static_cast<int32_t>(static_cast<uint32_t>(raw) + static_cast<uint32_t>(b.raw)));
+    }
+    
+    constexpr Fixed operator-(Fixed b) const {
+        return fromRaw(static_cast<int32_t>(static_cast<uint32_t>(raw) - static_cast<uint32_t>(b.raw)));
+    }
+    
+    constexpr Fixed operator*(Fixed b) const {
+        return fromRaw(static_cast<int32_t>((static_cast<int64_t>(raw) * b.raw) >> FRACTION_BITS));
+    }
+    
+    constexpr Fixed operator/(Fixed b) const {
+        return b.raw == 0 ? fromRaw(raw < 0 ? INT32_MIN : INT32_MAX)
+                          : fromRaw(static_cast<int32_t>(static_cast<int64_t>(raw) * ONE / b.raw));
+    }
+    
+    Fixed& operator+=(Fixed b) { return *this = *this + b; }
+    Fixed& operator-=(Fixed b) { return *this = *this - b; }
+    Fixed& operator*=(Fixed b) { return *this = *this * b; }
+    Fixed& operator/=(Fixed b) { return *this = *this / b; }
+    
+    constexpr bool operator==(Fixed b) const { return raw == b.raw; }
+    constexpr bool operator!=(Fixed b) const { return raw != b.raw; }
+    constexpr bool operator<(Fixed b) const { return raw < b.raw; }
+    constexpr bool operator<=(Fixed b) const { return raw <= b.raw; }
+    constexpr bool operator>(Fixed b) const { return raw > b.raw; }
+    constexpr bool operator>=(Fixed b) const { return raw >= b.raw; }
+    
+    friend constexpr Fixed abs(Fixed v) {
+        return v.raw < 0 ? -v : v;
+    }
+    
+    // Bit-by-bit integer square root; zero for negative arguments
+    friend Fixed sqrt(Fixed v) {
+        if (v.raw <= 0) return Fixed();
+        uint64_t value = static_cast<uint64_t>(v.raw) << FRACTION_BITS;
+        uint64_t result = 0;
+        uint64_t bit = uint64_t(1) << 62;
+        while (bit > value) bit >>= 2;
+        while (bit != 0) {
+            if (value >= result + bit) {
+                value -= result + bit;
+                result = (result >> 1) + bit;
+            } else {
+                result >>= 1;
+            }
+            bit >>= 2;
+        }
+        return fromRaw(static_cast<int32_t>(result));
+    }
+    
+    friend Fixed sin(Fixed v) {
+        return fromRaw(sinRaw(v.raw));
+    }
+    
+    friend Fixed cos(Fixed v) {
+        return fromRaw(sinRaw(static_cast<int64_t>(v.raw) + HALF_PI));
+    }
+    
+    friend Fixed tan(Fixed v) {
+        return sin(v) / cos(v);
+    }
+    
+    friend std::ostream& operator<<(std::ostream& os, Fixed v) {
+        return os << static_cast<double>(v);
+    }
+
+private:
+    struct RawTag {};
+    
+    // pi in 16.16 and the Taylor series' working precision
+    enum : int64_t { ONE = int64_t(1) << FRACTION_BITS, PI = 205887, HALF_PI = 102944, TWO_PI = 411775 };
+    enum : int { SERIES_BITS = 30 };
+    
+    constexpr Fixed(int32_t raw, RawTag) : raw(raw) {}
+    
+    // Reduced to [-pi/2, pi/2], then the Taylor series to x^11 in 2.30
+    // fixed point, which is accurate to well below the 16.16 resolution
+    static int32_t sinRaw(int64_t angle) {
+        int64_t x = angle % TWO_PI;
+        if (x > PI) x -= TWO_PI;
+        if (x < -PI) x += TWO_PI;
+        if (x > HALF_PI) x = PI - x;
+        if (x < -HALF_PI) x = -PI - x;
+        
+        const int64_t one = int64_t(1) << SERIES_BITS;
+        int64_t xs = x * (int64_t(1) << (SERIES_BITS - FRACTION_BITS));
+        int64_t x2 = (xs * xs) >> SERIES_BITS;
+        int64_t term = one;
+        const int divisors[] = { 110, 72, 42, 20, 6 };
+        for (int divisor : divisors) {
+            term = one - ((x2 * term) >> SERIES_BITS) / divisor;
+        }
+        int64_t result = (xs * term) >> SERIES_BITS;
+        return static_cast<int32_t>((result + (int64_t(1) << (SERIES_BITS - FRACTION_BITS - 1))) >> (SERIES_BITS - FRACTION_BITS));
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,178 @@
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for transient data that lives until the end of a frame:
+// allocation bumps an offset, and reset() releases everything at once.
+// When a frame overflows the current block, more blocks are chained on;
+// the next reset() replaces them with one block of the combined size, so
+// a frame in steady state allocates nothing from the heap. Memory is
+// uninitialized and only trivially destructible types may be placed in
+// it. Not thread-safe: allocate from one thread, then share the arrays.
+class FrameArena {
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> memory;
+        size_t size;
+    };
+    
+    enum : size_t { MIN_BLOCK_SIZE = 64 * 1024 };
+    
+    std::vector<Block> blocks;
+    size_t current = 0;
+    size_t offset = 0;
+    size_t used = 0;
+    size_t peak = 0;
+    size_t heapAllocations = 0;
+    
+    void addBlock(size_t size) {
+        Block block;
+        block.memory.reset(new unsigned char[size]);
+        block.size = size;
+        blocks.push_back(std::move(block));
+        heapAllocations++;
+    }
+
+public:
+    explicit FrameArena(size_t initialCapacity = 0) {
+        blocks.reserve(8);
+        if (initialCapacity > 0) addBlock(initialCapacity);
+    }
+    
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    
+    // Uninitialized memory, aligned to alignment (a power of two)
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        while (current < blocks.size()) {
+            Block& block = blocks[current];
+            uintptr_t base = reinterpret_cast<uintptr_t>(block.memory.get());
+            size_t start = ((base + offset + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base;
+            if (start + bytes <= block.size) {
+                offset = start + bytes;
+                used += bytes;
+                peak = std::max(peak, used);
+                return block.memory.get() + start;
+            }
+            current++;
+            offset = 0;
+        }
+        addBlock(std::max<size_t>(MIN_BLOCK_SIZE, bytes + alignment));
+        return allocate(bytes, alignment);
+    }
+    
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+    
+    // Releases every allocation. Chained blocks are merged into one.
+    void reset() {
+        if (blocks.size() > 1) {
+            size_t total = 0;
+            for (const auto& block : blocks) total += block.size;
+            blocks.clear();
+            addBlock(total);
+        }
+        current = 0;
+        offset = 0;
+        used = 0;
+    }
+    
+    size_t capacity() const {
+        size_t total = 0;
+        for (const auto& block : blocks) total += block.size;
+        return total;
+    }
+    
+    // Bytes handed out since the last reset()
+    size_t bytesUsed() const {
+        return used;
+    }
+    
+    // Most bytes ever in use between two resets
+    size_t peakBytesUsed() const {
+        return peak;
+    }
+    
+    // Blocks allocated from the heap so far; constant in steady state
+    size_t getHeapAllocations() const {
+        return heapAllocations;
+    }
+};
+
+// Pool of reusable objects, such as scratch buffers whose vectors keep their
+// capacity between uses. acquire() hands out a free object or creates one,
+// release() returns it, so a pool holds as many objects as were ever in
+// use at once. Thread-safe; objects live as long as the pool.
+template <typename T>
+class ObjectPool {
+private:
+    std::vector<std::unique_ptr<T>> objects;
+    std::vector<T*> available;
+    std::mutex mutex;
+
+public:
+    // Returns the object to its pool when it goes out of scope
+    class Handle {
+    private:
+        ObjectPool* pool;
+        T* object;
+    
+    public:
+        explicit Handle(ObjectPool& pool) : pool(&pool), object(pool.acquire()) {}
+        
+        ~Handle() {
+            pool->release(object);
+        }
+        
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        
+        T& operator*() const {
+            return *object;
+        }
+        
+        T* operator->() const {
+            return object;
+        }
+    };
+    
+    ObjectPool() = default;
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+    
+    T* acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (available.empty()) {
+            objects.push_back(std::unique_ptr<T>(new T()));
+            available.reserve(objects.size());
+            return objects.back().get();
+        }
+        T* object = available.back();
+        available.pop_back();
+        return object;
+    }
+    
+    void release(T* object) {
+        std::lock_guard<std::mutex> lock(mutex);
+        available.push_back(object);
+    }
+    
+    // Objects created so far
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return objects.size();
+    }
+};
+
+#endif
\ No newline at end of file
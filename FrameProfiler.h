@@ -0,0 +1,292 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(FRAME_PROFILER_STEADY_CLOCK)
+#include <x86intrin.h>
+#define FRAME_PROFILER_RDTSC 1
+#endif
+
+// Scoped timing zones for finding where frame time goes. Each thread
+// records into its own ring buffer, so recording takes no locks: a zone is
+// two timestamp reads and one 24-byte store. Timestamps come from RDTSC on
+// x86 (assumes an invariant TSC, as on all recent CPUs) and from
+// steady_clock elsewhere or with -DFRAME_PROFILER_STEADY_CLOCK.
+//
+// Recording is off until setEnabled(true). endFrame() closes a frame and
+// folds it into a rolling per-zone summary; writeChromeTrace() exports the
+// buffered events for chrome://tracing or Perfetto. Both read the other
+// threads' buffers, so call them between frames while workers are idle.
+//
+//     void display() {
+//         PROFILE_ZONE("frame");
+//         { PROFILE_ZONE("transform"); ... }
+//     }
+class FrameProfiler {
+public:
+    // Enumerators, not static members, so std::min/std::max can bind them
+    // by reference without an out-of-line definition
+    enum : size_t { RING_CAPACITY = 1 << 15, SUMMARY_FRAMES = 120 };
+    
+    struct Event {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+    };
+    
+    // Times its own lifetime
+    class Zone {
+    private:
+        const char* name;
+        uint64_t begin;
+    
+    public:
+        explicit Zone(const char* name) : name(FrameProfiler::isEnabled() ? name : nullptr), begin(0) {
+            if (this->name != nullptr) begin = FrameProfiler::now();
+        }
+        
+        ~Zone() {
+            if (name != nullptr) FrameProfiler::instance().record(name, begin, FrameProfiler::now());
+        }
+        
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+    };
+
+private:
+    struct ThreadBuffer {
+        std::vector<Event> events;
+        std::atomic<uint64_t> written;
+        uint64_t summarized = 0;
+        uint32_t threadId;
+        std::string threadName;
+        
+        explicit ThreadBuffer(uint32_t id) : events(RING_CAPACITY), written(0), threadId(id) {}
+    };
+    
+    // Per-frame totals of one zone over the last SUMMARY_FRAMES frames, in
+    // timer ticks; converted to milliseconds only when reported
+    struct ZoneStats {
+        std::string name;
+        uint64_t frameTicks[SUMMARY_FRAMES];
+        uint32_t frameCalls[SUMMARY_FRAMES];
+        uint64_t currentTicks = 0;
+        uint32_t currentCalls = 0;
+    };
+    
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::vector<ZoneStats> zones;
+    size_t frameCount = 0;
+    uint64_t lastFrameEnd = 0;
+    uint64_t frameIntervalTicks[SUMMARY_FRAMES];
+    
+    // Tick rate calibration against steady_clock, from construction onwards
+    uint64_t originTicks;
+    std::chrono::steady_clock::time_point originTime;
+    
+    static std::atomic<bool>& enabledFlag() {
+        static std::atomic<bool> enabled(false);
+        return enabled;
+    }
+    
+    static ThreadBuffer*& localBuffer() {
+        static thread_local ThreadBuffer* buffer = nullptr;
+        return buffer;
+    }
+    
+    FrameProfiler() : originTicks(now()), originTime(std::chrono::steady_clock::now()) {
+        std::fill(frameIntervalTicks, frameIntervalTicks + SUMMARY_FRAMES, uint64_t(0));
+    }
+    
+    ThreadBuffer& threadBuffer() {
+        ThreadBuffer*& buffer = localBuffer();
+        if (buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer(static_cast<uint32_t>(buffers.size()))));
+            buffer = buffers.back().get();
+        }
+        return *buffer;
+    }
+    
+    ZoneStats& statsFor(const char* name) {
+        for (auto& zone : zones) {
+            if (zone.name == name) return zone;
+        }
+        zones.push_back(ZoneStats());
+        ZoneStats& zone = zones.back();
+        zone.name = name;
+        std::fill(zone.frameTicks, zone.frameTicks + SUMMARY_FRAMES, uint64_t(0));
+        std::fill(zone.frameCalls, zone.frameCalls + SUMMARY_FRAMES, 0u);
+        return zone;
+    }
+
+public:
+    static FrameProfiler& instance() {
+        static FrameProfiler profiler;
+        return profiler;
+    }
+    
+    static bool isEnabled() {
+        return enabledFlag().load(std::memory_order_relaxed);
+    }
+    
+    static void setEnabled(bool enabled) {
+        // Fixes the trace time origin before the first event
+        instance();
+        enabledFlag().store(enabled, std::memory_order_relaxed);
+    }
+    
+    static uint64_t now() {
+#ifdef FRAME_PROFILER_RDTSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+    
+    // Timer ticks per microsecond, measured over everything since the
+    // profiler was created. Never waits: reports come after many frames,
+    // when the span is long enough for a precise rate.
+    double ticksPerMicrosecond() {
+#ifdef FRAME_PROFILER_RDTSC
+        double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - originTime).count();
+        uint64_t ticks = now();
+        return elapsedUs > 0.0 && ticks > originTicks ? (ticks - originTicks) / elapsedUs : 1000.0;
+#else
+        return 1000.0;
+#endif
+    }
+    
+    void record(const char* name, uint64_t begin, uint64_t end) {
+        ThreadBuffer& buffer = threadBuffer();
+        uint64_t index = buffer.written.load(std::memory_order_relaxed);
+        Event& event = buffer.events[index % RING_CAPACITY];
+        event.name = name;
+        event.begin = begin;
+        event.end = end;
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+    
+    // Label for the calling thread in exported traces
+    void setThreadName(const std::string& name) {
+        threadBuffer().threadName = name;
+    }
+    
+    // Closes the current frame: every event recorded since the previous call
+    // is added to its zone's totals for this frame
+    void endFrame() {
+        if (!isEnabled()) return;
+        uint64_t frameEnd = now();
+        size_t slot = frameCount % SUMMARY_FRAMES;
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& buffer : buffers) {
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            uint64_t first = std::max(buffer->summarized, written > RING_CAPACITY ? written - RING_CAPACITY : 0);
+            for (uint64_t i = first; i < written; i++) {
+                const Event& event = buffer->events[i % RING_CAPACITY];
+                ZoneStats& zone = statsFor(event.name);
+                zone.currentTicks += event.end - event.begin;
+                zone.currentCalls++;
+            }
+            buffer->summarized = written;
+        }
+        for (auto& zone : zones) {
+            zone.frameTicks[slot] = zone.currentTicks;
+            zone.frameCalls[slot] = zone.currentCalls;
+            zone.currentTicks = 0;
+            zone.currentCalls = 0;
+        }
+        frameIntervalTicks[slot] = lastFrameEnd != 0 ? frameEnd - lastFrameEnd : 0;
+        lastFrameEnd = frameEnd;
+        frameCount++;
+    }
+    
+    // Average and worst per-frame time of every zone over the last frames.
+    // Zones recorded on several threads add up across threads.
+    std::string summary() {
+        double ticksPerMs = ticksPerMicrosecond() * 1000.0;
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t frames = std::min<size_t>(frameCount, SUMMARY_FRAMES);
+        if (frames == 0) return "No profiled frames\n";
+        
+        char line[160];
+        std::string text;
+        double intervalSum = 0.0;
+        for (size_t f = 0; f < frames; f++) intervalSum += frameIntervalTicks[f] / ticksPerMs;
+        size_t intervals = frameCount > SUMMARY_FRAMES ? frames : frames - 1;
+        std::snprintf(line, sizeof(line), "Frame profile, last %zu frames, %.2f ms between frames\n",
+                      frames, intervals > 0 ? intervalSum / intervals : 0.0);
+        text += line;
+        std::snprintf(line, sizeof(line), "  %-24s %10s %10s %12s\n", "zone", "avg ms", "max ms", "calls/frame");
+        text += line;
+        
+        for (const auto& zone : zones) {
+            double sum = 0.0, worst = 0.0, calls = 0.0;
+            for (size_t f = 0; f < frames; f++) {
+                double ms = zone.frameTicks[f] / ticksPerMs;
+                sum += ms;
+                worst = std::max(worst, ms);
+                calls += zone.frameCalls[f];
+            }
+            std::snprintf(line, sizeof(line), "  %-24s %10.3f %10.3f %12.1f\n",
+                          zone.name.c_str(), sum / frames, worst, calls / frames);
+            text += line;
+        }
+        return text;
+    }
+    
+    // Writes the buffered events as Chrome trace_event JSON ("X" events)
+    bool writeChromeTrace(const std::string& path) {
+        double ticksPerUs = ticksPerMicrosecond();
+        std::lock_guard<std::mutex> lock(mutex);
+        FILE* out = std::fopen(path.c_str(), "w");
+        if (out == nullptr) return false;
+        
+        std::fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        bool first = true;
+        for (const auto& buffer : buffers) {
+            std::string threadName = buffer->threadName.empty()
+                ? "thread " + std::to_string(buffer->threadId) : buffer->threadName;
+            std::fprintf(out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+                         first ? "" : ",\n", buffer->threadId, threadName.c_str());
+            first = false;
+            
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            uint64_t begin = written > RING_CAPACITY ? written - RING_CAPACITY : 0;
+            for (uint64_t i = begin; i < written; i++) {
+                const Event& event = buffer->events[i % RING_CAPACITY];
+                std::fprintf(out, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                             event.name, buffer->threadId,
+                             (event.begin - originTicks) / ticksPerUs, (event.end - event.begin) / ticksPerUs);
+            }
+        }
+        std::fprintf(out, "\n]}\n");
+        return std::fclose(out) == 0;
+    }
+};
+
+#define FRAME_PROFILER_CONCAT_INNER(a, b) a##b
+#define FRAME_PROFILER_CONCAT(a, b) FRAME_PROFILER_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing scope under `name` (a string literal).
+// Compiled out entirely with -DFRAME_PROFILER_DISABLED.
+#ifdef FRAME_PROFILER_DISABLED
+#define PROFILE_ZONE(name) ((void)0)
+#else
+#define PROFILE_ZONE(name) FrameProfiler::Zone FRAME_PROFILER_CONCAT(profileZone, __LINE__)(name)
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,110 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "Vector3.h"
+#include "Matrix4x4.h"
+#include "BoundingVolume.h"
+
+// Visibility counters of one frame. Every submitted object is either culled
+// or drawn; tested counts the objects whose own bounds were checked, which
+// a BVH keeps below the total by rejecting or accepting whole subtrees.
+struct CullStats {
+    size_t objectsTested = 0;
+    size_t objectsCulled = 0;
+    size_t objectsDrawn = 0;
+    
+    // Part of objectsCulled rejected by occlusion rather than the frustum
+    size_t objectsOccluded = 0;
+    size_t nodesTested = 0;
+    
+    // Triangles of the drawn objects by clipping outcome: drawn as they
+    // are, cut at the near plane or guard band, or dropped without work
+    size_t trianglesAccepted = 0;
+    size_t trianglesClipped = 0;
+    size_t trianglesRejected = 0;
+    
+    // Triangles dropped at setup, after clipping: by the cull mode, or for
+    // having no area or covering no pixel center
+    size_t trianglesCulledFacing = 0;
+    size_t trianglesCulledSmall = 0;
+    
+    void reset() {
+        *this = CullStats();
+    }
+};
+
+// The six planes of a view volume, extracted from a combined projection *
+// view matrix (Gribb/Hartmann). Plane normals point inwards; a point p is
+// inside a plane when dot(normal, p) + distance >= 0. With a full
+// projection * view * model matrix the planes are in model space instead.
+class Frustum {
+public:
+    enum Plane { LEFT, RIGHT, BOTTOM, TOP, NEAR, FAR, PLANE_COUNT };
+    
+    // All planes still to be tested
+    static const uint32_t ALL_PLANES = (1u << PLANE_COUNT) - 1;
+    
+    enum Result { OUTSIDE, INTERSECTING, INSIDE };
+    
+    Vector3 normals[PLANE_COUNT];
+    float distances[PLANE_COUNT];
+    
+    Frustum() {
+        for (int i = 0; i < PLANE_COUNT; i++) distances[i] = 0.0f;
+    }
+    
+    static Frustum fromMatrix(const Matrix4x4& matrix) {
+        const float (&m)[4][4] = matrix.m;
+        Frustum frustum;
+        for (int i = 0; i < 3; i++) {
+            // Clip-space -w <= c_i <= w becomes (row3 + row_i) . p >= 0 and (row3 - row_i) . p >= 0
+            frustum.setPlane(2 * i, m[3][0] + m[i][0], m[3][1] + m[i][1], m[3][2] + m[i][2], m[3][3] + m[i][3]);
+            frustum.setPlane(2 * i + 1, m[3][0] - m[i][0], m[3][1] - m[i][1], m[3][2] - m[i][2], m[3][3] - m[i][3]);
+        }
+        return frustum;
+    }
+    
+    void setPlane(int index, float a, float b, float c, float d) {
+        float length = std::sqrt(a * a + b * b + c * c);
+        float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        normals[index] = Vector3(a * scale, b * scale, c * scale);
+        distances[index] = d * scale;
+    }
+    
+    // Tests the box against the planes in planeMask. Planes the box lies
+    // fully inside are cleared from the mask, so children of a box need not
+    // test them again.
+    Result classify(const AABB& box, uint32_t& planeMask) const {
+        if (box.isEmpty()) return OUTSIDE;
+        Vector3 c = box.center();
+        Vector3 e = box.extents();
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            uint32_t bit = 1u << i;
+            if ((planeMask & bit) == 0) continue;
+            const Vector3& n = normals[i];
+            float distance = n.dot(c) + distances[i];
+            float radius = std::fabs(n.x) * e.x + std::fabs(n.y) * e.y + std::fabs(n.z) * e.z;
+            if (distance < -radius) return OUTSIDE;
+            if (distance >= radius) planeMask &= ~bit;
+        }
+        return planeMask == 0 ? INSIDE : INTERSECTING;
+    }
+    
+    bool intersects(const AABB& box) const {
+        uint32_t planeMask = ALL_PLANES;
+        return classify(box, planeMask) != OUTSIDE;
+    }
+    
+    bool intersects(const BoundingSphere& sphere) const {
+        if (sphere.isEmpty()) return false;
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            if (normals[i].dot(sphere.center) + distances[i] < -sphere.radius) return false;
+        }
+        return true;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,288 @@
+#ifndef HIZ_BUFFER_H
+#define HIZ_BUFFER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "Vector3.h"
+#include "Matrix4x4.h"
+#include "MathKernels.h"
+#include "Object3D.h"
+#include "BoundingVolume.h"
+
+// Low-resolution CPU depth buffer for occlusion culling. A few large
+// occluders are rasterized into it each frame, then a pyramid keeps the
+// nearest and farthest depth of every 2x2 block level by level. An object
+// is occluded when the nearest depth of its projected bounding box lies
+// behind the farthest occluder depth everywhere under the box's screen
+// rectangle: the test starts at the level where the rectangle spans at
+// most 2x2 texels and only refines texels that are neither clearly hidden
+// nor clearly in front. Occluders are rasterized conservatively (only
+// fully covered pixels, at the farthest depth inside each pixel), so an
+// object is never culled wrongly. Depth is NDC z mapped to [0, 1].
+class HiZBuffer {
+private:
+    // Vertices closer than this in clip-space w are treated as behind the camera
+    static constexpr float NEAR_W = 1e-5f;
+    
+    struct Level {
+        int width;
+        int height;
+        std::vector<float> minDepth;
+        std::vector<float> maxDepth;
+    };
+    
+    // Level 0 is the full resolution; rasterization writes its maxDepth
+    std::vector<Level> levels;
+    bool pyramidDirty = false;
+    size_t occluderTriangles = 0;
+    
+    // Scratch storage for occluder vertices
+    std::vector<float> clip;
+    std::vector<Vector3> screen;
+    
+    void rasterizeTriangle(Vector3 a, Vector3 b, Vector3 c) {
+        Level& base = levels[0];
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (area == 0.0f || std::isnan(area)) return;
+        if (area < 0.0f) {
+            std::swap(b, c);
+            area = -area;
+        }
+        
+        int minX = std::max(0, static_cast<int>(std::floor(std::min(a.x, std::min(b.x, c.x)))));
+        int minY = std::max(0, static_cast<int>(std::floor(std::min(a.y, std::min(b.y, c.y)))));
+        int maxX = std::min(base.width - 1, static_cast<int>(std::floor(std::max(a.x, std::max(b.x, c.x)))));
+        int maxY = std::min(base.height - 1, static_cast<int>(std::floor(std::max(a.y, std::max(b.y, c.y)))));
+        if (minX > maxX || minY > maxY) return;
+        
+        // Depth plane, raised to its farthest value within each pixel
+        float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+        float dzdy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+        float slack = 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+        
+        // Edge functions, positive inside; a pixel is fully covered when its
+        // center is at least half its extent along each edge normal inside
+        const Vector3* corners[3] = { &a, &b, &c };
+        float stepX[3], stepY[3], rowStart[3], margin[3];
+        float px = minX + 0.5f, py = minY + 0.5f;
+        for (int e = 0; e < 3; e++) {
+            const Vector3& p = *corners[e];
+            const Vector3& q = *corners[(e + 1) % 3];
+            stepX[e] = -(q.y - p.y);
+            stepY[e] = q.x - p.x;
+            rowStart[e] = (q.x - p.x) * (py - p.y) - (q.y - p.y) * (px - p.x);
+            margin[e] = 0.5f * (std::fabs(stepX[e]) + std::fabs(stepY[e]));
+        }
+        float depthRow = a.z + dzdx * (px - a.x) + dzdy * (py - a.y) + slack;
+        
+        for (int y = minY; y <= maxY; y++) {
+            float w0 = rowStart[0], w1 = rowStart[1], w2 = rowStart[2];
+            float depth = depthRow;
+            float* row = &base.maxDepth[static_cast<size_t>(y) * base.width];
+            for (int x = minX; x <= maxX; x++) {
+                if (w0 >= margin[0] && w1 >= margin[1] && w2 >= margin[2] && depth < row[x]) {
+                    row[x] = std::max(depth, 0.0f);
+                }
+                w0 += stepX[0];
+                w1 += stepX[1];
+                w2 += stepX[2];
+                depth += dzdx;
+            }
+            for (int e = 0; e < 3; e++) rowStart[e] += stepY[e];
+            depthRow += dzdy;
+        }
+    }
+    
+    // True when everything under the part of the level-0 rectangle covered
+    // by this texel lies in front of nearDepth
+    bool texelOccluded(size_t level, int tx, int ty, int x0, int y0, int x1, int y1, float nearDepth) const {
+        const Level& l = levels[level];
+        size_t i = static_cast<size_t>(ty) * l.width + tx;
+        if (nearDepth > l.maxDepth[i]) return true;
+        if (level == 0 || nearDepth <= l.minDepth[i]) return false;
+        
+        int shift = static_cast<int>(level) - 1;
+        const Level& finer = levels[level - 1];
+        for (int cy = std::max(ty * 2, y0 >> shift); cy <= std::min(std::min(ty * 2 + 1, finer.height - 1), y1 >> shift); cy++) {
+            for (int cx = std::max(tx * 2, x0 >> shift); cx <= std::min(std::min(tx * 2 + 1, finer.width - 1), x1 >> shift); cx++) {
+                if (!texelOccluded(level - 1, cx, cy, x0, y0, x1, y1, nearDepth)) return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    HiZBuffer(int width = 1, int height = 1) {
+        resize(width, height);
+    }
+    
+    void resize(int width, int height) {
+        levels.clear();
+        width = std::max(1, width);
+        height = std::max(1, height);
+        while (true) {
+            Level level;
+            level.width = width;
+            level.height = height;
+            level.minDepth.assign(static_cast<size_t>(width) * height, 1.0f);
+            level.maxDepth.assign(static_cast<size_t>(width) * height, 1.0f);
+            levels.push_back(level);
+            if (width == 1 && height == 1) break;
+            width = (width + 1) / 2;
+            height = (height + 1) / 2;
+        }
+        pyramidDirty = false;
+        occluderTriangles = 0;
+    }
+    
+    int getWidth() const {
+        return levels[0].width;
+    }
+    
+    int getHeight() const {
+        return levels[0].height;
+    }
+    
+    size_t levelCount() const {
+        return levels.size();
+    }
+    
+    const std::vector<float>& minDepth(size_t level) const {
+        return levels[level].minDepth;
+    }
+    
+    const std::vector<float>& maxDepth(size_t level) const {
+        return levels[level].maxDepth;
+    }
+    
+    // Triangles rasterized since the last clear()
+    size_t getOccluderTriangles() const {
+        return occluderTriangles;
+    }
+    
+    // Everything at the far plane. Free when nothing was rasterized.
+    void clear() {
+        if (occluderTriangles == 0) return;
+        for (auto& level : levels) {
+            std::fill(level.minDepth.begin(), level.minDepth.end(), 1.0f);
+            std::fill(level.maxDepth.begin(), level.maxDepth.end(), 1.0f);
+        }
+        pyramidDirty = false;
+        occluderTriangles = 0;
+    }
+    
+    // Rasterizes the faces of the object under the given model-view-projection
+    // matrix. Faces with a vertex in front of the near plane are skipped: the
+    // renderer clips those parts away, so they must not occlude anything.
+    void addOccluder(const Object3D& object, const Matrix4x4& mvp) {
+        size_t count = object.vertices.size();
+        clip.resize(count * 4);
+        screen.resize(count);
+        MathKernels::transformPointsToClip(&mvp.m[0][0], object.vertices.data(), count, clip.data());
+        
+        const Level& base = levels[0];
+        for (size_t i = 0; i < count; i++) {
+            const float* c = &clip[i * 4];
+            if (c[3] <= NEAR_W || c[2] < -c[3]) {
+                screen[i] = Vector3(0.0f, 0.0f, std::numeric_limits<float>::quiet_NaN());
+                continue;
+            }
+            float invW = 1.0f / c[3];
+            screen[i] = Vector3((c[0] * invW + 1.0f) * 0.5f * base.width,
+                                (1.0f - c[1] * invW) * 0.5f * base.height,
+                                c[2] * invW * 0.5f + 0.5f);
+        }
+        
+        for (const auto& face : object.faces) {
+            bool nearClipped = false;
+            for (int v : face) nearClipped = nearClipped || std::isnan(screen[v].z);
+            if (nearClipped) continue;
+            for (size_t i = 1; i + 1 < face.size(); i++) {
+                rasterizeTriangle(screen[face[0]], screen[face[i]], screen[face[i + 1]]);
+                occluderTriangles++;
+            }
+        }
+        pyramidDirty = true;
+    }
+    
+    void buildPyramid() {
+        Level& base = levels[0];
+        base.minDepth = base.maxDepth;
+        for (size_t l = 1; l < levels.size(); l++) {
+            const Level& finer = levels[l - 1];
+            Level& level = levels[l];
+            for (int y = 0; y < level.height; y++) {
+                for (int x = 0; x < level.width; x++) {
+                    float nearest = std::numeric_limits<float>::infinity();
+                    float farthest = 0.0f;
+                    for (int cy = y * 2; cy <= std::min(y * 2 + 1, finer.height - 1); cy++) {
+                        for (int cx = x * 2; cx <= std::min(x * 2 + 1, finer.width - 1); cx++) {
+                            size_t i = static_cast<size_t>(cy) * finer.width + cx;
+                            nearest = std::min(nearest, finer.minDepth[i]);
+                            farthest = std::max(farthest, finer.maxDepth[i]);
+                        }
+                    }
+                    size_t i = static_cast<size_t>(y) * level.width + x;
+                    level.minDepth[i] = nearest;
+                    level.maxDepth[i] = farthest;
+                }
+            }
+        }
+        pyramidDirty = false;
+    }
+    
+    // Rebuilds the pyramid if occluders were added since the last build
+    void update() {
+        if (pyramidDirty) buildPyramid();
+    }
+    
+    // True when the box under the model-view-projection matrix is hidden
+    // behind the occluders. Boxes reaching behind the near plane or off
+    // screen are never occluded. Needs an up-to-date pyramid (update()).
+    bool isOccluded(const AABB& box, const Matrix4x4& mvp) const {
+        if (box.isEmpty()) return false;
+        const Level& base = levels[0];
+        float minX = std::numeric_limits<float>::infinity(), minY = minX, nearDepth = minX;
+        float maxX = -minX, maxY = -minX;
+        for (int corner = 0; corner < 8; corner++) {
+            Vector3 p((corner & 1) ? box.max.x : box.min.x,
+                      (corner & 2) ? box.max.y : box.min.y,
+                      (corner & 4) ? box.max.z : box.min.z);
+            const float (&m)[4][4] = mvp.m;
+            float w = m[3][0] * p.x + m[3][1] * p.y + m[3][2] * p.z + m[3][3];
+            if (w <= NEAR_W) return false;
+            float invW = 1.0f / w;
+            float x = ((m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3]) * invW + 1.0f) * 0.5f * base.width;
+            float y = (1.0f - (m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3]) * invW) * 0.5f * base.height;
+            float z = (m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]) * invW * 0.5f + 0.5f;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            nearDepth = std::min(nearDepth, z);
+        }
+        
+        int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+        int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+        int x1 = std::min(base.width - 1, static_cast<int>(std::floor(maxX)));
+        int y1 = std::min(base.height - 1, static_cast<int>(std::floor(maxY)));
+        if (x0 > x1 || y0 > y1) return false;
+        
+        size_t level = 0;
+        while (level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+            level++;
+        }
+        int shift = static_cast<int>(level);
+        for (int ty = y0 >> shift; ty <= y1 >> shift; ty++) {
+            for (int tx = x0 >> shift; tx <= x1 >> shift; tx++) {
+                if (!texelOccluded(level, tx, ty, x0, y0, x1, y1, nearDepth)) return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif
\ No newline at end of file
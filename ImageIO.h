@@ -0,0 +1,292 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Writes rendered frames as PPM, PNG or OpenEXR and reads PPM images for
+// textures, without any image library. Pixels are RGBA8 packed like
+// SoftwareRenderer and Texture texels (red in the low byte), row 0 at the
+// top. PNGs are 8-bit RGB in stored (uncompressed) deflate blocks; EXRs
+// are uncompressed 32-bit float scanlines with R, G, B and, when given, the
+// window-space depth as Z. Throws std::runtime_error on I/O failures.
+class ImageIO {
+public:
+    enum class Format { PPM, PNG, EXR };
+
+private:
+    class File {
+    public:
+        FILE* handle;
+        std::string path;
+        
+        File(const std::string& path, const char* mode) : handle(std::fopen(path.c_str(), mode)), path(path) {
+            if (handle == nullptr) throw std::runtime_error("Cannot open " + path);
+        }
+        
+        ~File() {
+            if (handle != nullptr) std::fclose(handle);
+        }
+        
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+        
+        void write(const void* data, size_t bytes) {
+            if (bytes != 0 && std::fwrite(data, 1, bytes, handle) != bytes) {
+                throw std::runtime_error("Cannot write " + path);
+            }
+        }
+        
+        void close() {
+            int result = std::fclose(handle);
+            handle = nullptr;
+            if (result != 0) throw std::runtime_error("Cannot write " + path);
+        }
+    };
+    
+    static void appendU32BigEndian(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+    
+    template <typename T>
+    static void appendLittleEndian(std::vector<uint8_t>& out, T value) {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+    
+    static std::array<uint32_t, 256> crcTable() {
+        std::array<uint32_t, 256> table;
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return table;
+    }
+    
+    // Frames are written from several threads; the table's one-time
+    // initialization is thread-safe
+    static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+        static const std::array<uint32_t, 256> table = crcTable();
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+    
+    static void appendPngChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+        appendU32BigEndian(out, static_cast<uint32_t>(data.size()));
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        appendU32BigEndian(out, crc32(&out[start], out.size() - start));
+    }
+    
+    static void appendExrAttribute(std::vector<uint8_t>& out, const char* name, const char* type,
+                                   const std::vector<uint8_t>& value) {
+        out.insert(out.end(), name, name + std::strlen(name) + 1);
+        out.insert(out.end(), type, type + std::strlen(type) + 1);
+        appendLittleEndian(out, static_cast<int32_t>(value.size()));
+        out.insert(out.end(), value.begin(), value.end());
+    }
+    
+    static bool hostIsLittleEndian() {
+        uint32_t probe = 1;
+        uint8_t first;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+    
+    static uint8_t channel(uint32_t pixel, int shift) {
+        return static_cast<uint8_t>(pixel >> shift);
+    }
+
+public:
+    // From the file extension, case-sensitive; throws for anything else
+    static Format formatFor(const std::string& path) {
+        size_t dot = path.rfind('.');
+        std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+        if (extension == "ppm") return Format::PPM;
+        if (extension == "png") return Format::PNG;
+        if (extension == "exr") return Format::EXR;
+        throw std::runtime_error("Unknown image format: " + path);
+    }
+    
+    static void writePPM(const std::string& path, int width, int height, const uint32_t* pixels) {
+        std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+        std::vector<uint8_t> data(static_cast<size_t>(width) * height * 3);
+        for (size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
+            data[i * 3] = channel(pixels[i], 0);
+            data[i * 3 + 1] = channel(pixels[i], 8);
+            data[i * 3 + 2] = channel(pixels[i], 16);
+        }
+        File file(path, "wb");
+        file.write(header.data(), header.size());
+        file.write(data.data(), data.size());
+        file.close();
+    }
+    
+    static void writePNG(const std::string& path, int width, int height, const uint32_t* pixels) {
+        // Filter type 0 before every row, then zlib with stored blocks
+        size_t rowBytes = static_cast<size_t>(width) * 3 + 1;
+        std::vector<uint8_t> raw(rowBytes * height);
+        for (int y = 0; y < height; y++) {
+            uint8_t* row = &raw[y * rowBytes];
+            row[0] = 0;
+            for (int x = 0; x < width; x++) {
+                uint32_t pixel = pixels[static_cast<size_t>(y) * width + x];
+                row[1 + x * 3] = channel(pixel, 0);
+                row[2 + x * 3] = channel(pixel, 8);
+                row[3 + x * 3] = channel(pixel, 16);
+            }
+        }
+        
+        std::vector<uint8_t> zlib = { 0x78, 0x01 };
+        const size_t maxBlock = 65535;
+        size_t offset = 0;
+        do {
+            size_t length = std::min(maxBlock, raw.size() - offset);
+            zlib.push_back(offset + length == raw.size() ? 1 : 0);
+            zlib.push_back(static_cast<uint8_t>(length));
+            zlib.push_back(static_cast<uint8_t>(length >> 8));
+            zlib.push_back(static_cast<uint8_t>(~length));
+            zlib.push_back(static_cast<uint8_t>(~length >> 8));
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+            offset += length;
+        } while (offset < raw.size());
+        uint32_t a = 1, b = 0;
+        for (uint8_t byte : raw) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        appendU32BigEndian(zlib, (b << 16) | a);
+        
+        std::vector<uint8_t> header;
+        appendU32BigEndian(header, static_cast<uint32_t>(width));
+        appendU32BigEndian(header, static_cast<uint32_t>(height));
+        header.push_back(8);  // bit depth
+        header.push_back(2);  // truecolor
+        header.push_back(0);
+        header.push_back(0);
+        header.push_back(0);
+        
+        std::vector<uint8_t> out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        appendPngChunk(out, "IHDR", header);
+        appendPngChunk(out, "IDAT", zlib);
+        appendPngChunk(out, "IEND", std::vector<uint8_t>());
+        
+        File file(path, "wb");
+        file.write(out.data(), out.size());
+        file.close();
+    }
+    
+    // depth may be null; otherwise it becomes the Z channel
+    static void writeEXR(const std::string& path, int width, int height, const uint32_t* pixels,
+                         const float* depth = nullptr) {
+        if (!hostIsLittleEndian()) throw std::runtime_error("EXR output needs a little-endian host: " + path);
+        
+        // Channels in alphabetical order, as the format requires
+        const char* names[] = { "B", "G", "R", "Z" };
+        const int shifts[] = { 16, 8, 0 };
+        int channelCount = depth ? 4 : 3;
+        
+        std::vector<uint8_t> channels;
+        for (int c = 0; c < channelCount; c++) {
+            channels.insert(channels.end(), names[c], names[c] + 2);
+            appendLittleEndian(channels, static_cast<int32_t>(2));  // FLOAT
+            appendLittleEndian(channels, static_cast<int32_t>(0));  // pLinear and reserved
+            appendLittleEndian(channels, static_cast<int32_t>(1));  // xSampling
+            appendLittleEndian(channels, static_cast<int32_t>(1));  // ySampling
+        }
+        channels.push_back(0);
+        
+        std::vector<uint8_t> window;
+        appendLittleEndian(window, static_cast<int32_t>(0));
+        appendLittleEndian(window, static_cast<int32_t>(0));
+        appendLittleEndian(window, static_cast<int32_t>(width - 1));
+        appendLittleEndian(window, static_cast<int32_t>(height - 1));
+        std::vector<uint8_t> center;
+        appendLittleEndian(center, 0.0f);
+        appendLittleEndian(center, 0.0f);
+        std::vector<uint8_t> one;
+        appendLittleEndian(one, 1.0f);
+        
+        std::vector<uint8_t> out;
+        appendLittleEndian(out, static_cast<int32_t>(20000630));
+        appendLittleEndian(out, static_cast<int32_t>(2));
+        appendExrAttribute(out, "channels", "chlist", channels);
+        appendExrAttribute(out, "compression", "compression", std::vector<uint8_t>(1, 0));
+        appendExrAttribute(out, "dataWindow", "box2i", window);
+        appendExrAttribute(out, "displayWindow", "box2i", window);
+        appendExrAttribute(out, "lineOrder", "lineOrder", std::vector<uint8_t>(1, 0));
+        appendExrAttribute(out, "pixelAspectRatio", "float", one);
+        appendExrAttribute(out, "screenWindowCenter", "v2f", center);
+        appendExrAttribute(out, "screenWindowWidth", "float", one);
+        out.push_back(0);
+        
+        // One scanline per block: y, byte count, then each channel's row
+        uint64_t lineBytes = static_cast<uint64_t>(width) * channelCount * sizeof(float);
+        uint64_t blockStart = out.size() + static_cast<uint64_t>(height) * sizeof(uint64_t);
+        for (int y = 0; y < height; y++) {
+            appendLittleEndian(out, blockStart + y * (lineBytes + 8));
+        }
+        for (int y = 0; y < height; y++) {
+            appendLittleEndian(out, static_cast<int32_t>(y));
+            appendLittleEndian(out, static_cast<int32_t>(lineBytes));
+            const uint32_t* row = pixels + static_cast<size_t>(y) * width;
+            for (int c = 0; c < channelCount; c++) {
+                for (int x = 0; x < width; x++) {
+                    float value = c < 3 ? channel(row[x], shifts[c]) / 255.0f : depth[static_cast<size_t>(y) * width + x];
+                    appendLittleEndian(out, value);
+                }
+            }
+        }
+        
+        File file(path, "wb");
+        file.write(out.data(), out.size());
+        file.close();
+    }
+    
+    static void write(const std::string& path, int width, int height, const uint32_t* pixels,
+                      const float* depth = nullptr) {
+        switch (formatFor(path)) {
+            case Format::PPM: writePPM(path, width, height, pixels); break;
+            case Format::PNG: writePNG(path, width, height, pixels); break;
+            case Format::EXR: writeEXR(path, width, height, pixels, depth); break;
+        }
+    }
+    
+    // Binary (P6) 8-bit PPM into RGBA8 pixels with full alpha
+    static std::vector<uint32_t> readPPM(const std::string& path, int& width, int& height) {
+        File file(path, "rb");
+        int maxValue = 0;
+        char magic[3] = {};
+        if (std::fscanf(file.handle, "%2s %d %d %d", magic, &width, &height, &maxValue) != 4 ||
+            std::strcmp(magic, "P6") != 0 || width <= 0 || height <= 0 || maxValue != 255) {
+            throw std::runtime_error("Not an 8-bit binary PPM: " + path);
+        }
+        std::fgetc(file.handle);
+        
+        std::vector<uint8_t> data(static_cast<size_t>(width) * height * 3);
+        if (std::fread(data.data(), 1, data.size(), file.handle) != data.size()) {
+            throw std::runtime_error("Truncated PPM: " + path);
+        }
+        std::vector<uint32_t> pixels(static_cast<size_t>(width) * height);
+        for (size_t i = 0; i < pixels.size(); i++) {
+            pixels[i] = data[i * 3] | (data[i * 3 + 1] << 8) | (data[i * 3 + 2] << 16) | 0xFF000000u;
+        }
+        return pixels;
+    }
+};
+
+#endif
\ No newline at end of file
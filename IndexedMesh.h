@@ -0,0 +1,279 @@
+#ifndef INDEXED_MESH_H
+#define INDEXED_MESH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Vector3.h"
+#include "Object3D.h"
+
+// Compact, triangulated form of Object3D for drawing and bulk processing.
+// All faces live in one uint32_t index buffer (three per triangle) instead of
+// one heap allocation per face. Vertex attributes are stored either as
+// separate float streams (structure of arrays, the default) or as one
+// interleaved array when built with -DINDEXED_MESH_INTERLEAVED.
+class IndexedMesh {
+public:
+#ifdef INDEXED_MESH_INTERLEAVED
+    static const bool interleaved = true;
+    
+    struct Vertex {
+        float px, py, pz;
+        float nx, ny, nz;
+        float u, v;
+    };
+#else
+    static const bool interleaved = false;
+#endif
+
+private:
+#ifdef INDEXED_MESH_INTERLEAVED
+    std::vector<Vertex> vertexData;
+#else
+    std::vector<float> px, py, pz;
+    std::vector<float> nx, ny, nz;
+    std::vector<float> u, v;
+#endif
+    size_t count = 0;
+
+public:
+    bool hasNormals = false;
+    bool hasTexCoords = false;
+    
+    // Three vertex indices per triangle
+    std::vector<uint32_t> indices;
+    
+    // Optional: source polygon p covers triangles [polygonOffsets[p], polygonOffsets[p + 1]).
+    // Empty when the polygon structure was not kept.
+    std::vector<uint32_t> polygonOffsets;
+    
+    // Two vertex indices per wireframe edge
+    std::vector<uint32_t> edgeIndices;
+    
+    std::array<float, 3> color;
+    std::string texturePath;
+    
+    IndexedMesh() : color({1.0f, 1.0f, 1.0f}) {}
+    
+    size_t vertexCount() const {
+        return count;
+    }
+    
+    size_t triangleCount() const {
+        return indices.size() / 3;
+    }
+    
+    size_t polygonCount() const {
+        return polygonOffsets.empty() ? triangleCount() : polygonOffsets.size() - 1;
+    }
+    
+    void resize(size_t vertexCount) {
+        count = vertexCount;
+#ifdef INDEXED_MESH_INTERLEAVED
+        vertexData.resize(vertexCount);
+#else
+        px.resize(vertexCount);
+        py.resize(vertexCount);
+        pz.resize(vertexCount);
+        nx.resize(hasNormals ? vertexCount : 0);
+        ny.resize(hasNormals ? vertexCount : 0);
+        nz.resize(hasNormals ? vertexCount : 0);
+        u.resize(hasTexCoords ? vertexCount : 0);
+        v.resize(hasTexCoords ? vertexCount : 0);
+#endif
+    }
+
+#ifdef INDEXED_MESH_INTERLEAVED
+    Vector3 position(size_t i) const {
+        const Vertex& vertex = vertexData[i];
+        return Vector3(vertex.px, vertex.py, vertex.pz);
+    }
+    
+    Vector3 normal(size_t i) const {
+        const Vertex& vertex = vertexData[i];
+        return Vector3(vertex.nx, vertex.ny, vertex.nz);
+    }
+    
+    std::pair<float, float> texCoord(size_t i) const {
+        return std::make_pair(vertexData[i].u, vertexData[i].v);
+    }
+    
+    void setPosition(size_t i, const Vector3& p) {
+        vertexData[i].px = p.x;
+        vertexData[i].py = p.y;
+        vertexData[i].pz = p.z;
+    }
+    
+    void setNormal(size_t i, const Vector3& n) {
+        vertexData[i].nx = n.x;
+        vertexData[i].ny = n.y;
+        vertexData[i].nz = n.z;
+    }
+    
+    void setTexCoord(size_t i, float s, float t) {
+        vertexData[i].u = s;
+        vertexData[i].v = t;
+    }
+    
+    const Vertex* vertices() const {
+        return vertexData.data();
+    }
+#else
+    Vector3 position(size_t i) const {
+        return Vector3(px[i], py[i], pz[i]);
+    }
+    
+    Vector3 normal(size_t i) const {
+        return Vector3(nx[i], ny[i], nz[i]);
+    }
+    
+    std::pair<float, float> texCoord(size_t i) const {
+        return std::make_pair(u[i], v[i]);
+    }
+    
+    void setPosition(size_t i, const Vector3& p) {
+        px[i] = p.x;
+        py[i] = p.y;
+        pz[i] = p.z;
+    }
+    
+    void setNormal(size_t i, const Vector3& n) {
+        nx[i] = n.x;
+        ny[i] = n.y;
+        nz[i] = n.z;
+    }
+    
+    void setTexCoord(size_t i, float s, float t) {
+        u[i] = s;
+        v[i] = t;
+    }
+    
+    const float* positionX() const { return px.data(); }
+    const float* positionY() const { return py.data(); }
+    const float* positionZ() const { return pz.data(); }
+    const float* normalX() const { return nx.data(); }
+    const float* normalY() const { return ny.data(); }
+    const float* normalZ() const { return nz.data(); }
+    const float* texCoordU() const { return u.data(); }
+    const float* texCoordV() const { return v.data(); }
+#endif
+
+    // Heap bytes held by the vertex streams and index buffers
+    size_t memoryBytes() const {
+        size_t bytes = indices.capacity() * sizeof(uint32_t)
+                     + polygonOffsets.capacity() * sizeof(uint32_t)
+                     + edgeIndices.capacity() * sizeof(uint32_t);
+#ifdef INDEXED_MESH_INTERLEAVED
+        bytes += vertexData.capacity() * sizeof(Vertex);
+#else
+        bytes += (px.capacity() + py.capacity() + pz.capacity()
+                + nx.capacity() + ny.capacity() + nz.capacity()
+                + u.capacity() + v.capacity()) * sizeof(float);
+#endif
+        return bytes;
+    }
+    
+    // Fan-triangulates every face. With keepPolygons the offset table is
+    // filled so toObject3D can rebuild the original polygons.
+    static IndexedMesh fromObject3D(const Object3D& object, bool keepPolygons = true) {
+        IndexedMesh mesh;
+        size_t vertexCount = object.vertices.size();
+        mesh.hasNormals = object.normals.size() == vertexCount && vertexCount > 0;
+        mesh.hasTexCoords = object.texCoords.size() == vertexCount && vertexCount > 0;
+        mesh.color = object.color;
+        mesh.texturePath = object.texturePath;
+        mesh.resize(vertexCount);
+        
+        for (size_t i = 0; i < vertexCount; i++) {
+            mesh.setPosition(i, object.vertices[i]);
+            if (mesh.hasNormals) mesh.setNormal(i, object.normals[i]);
+            if (mesh.hasTexCoords) mesh.setTexCoord(i, object.texCoords[i].first, object.texCoords[i].second);
+        }
+        
+        size_t triangleTotal = 0;
+        for (const auto& face : object.faces) {
+            if (face.size() >= 3) triangleTotal += face.size() - 2;
+        }
+        mesh.indices.reserve(triangleTotal * 3);
+        if (keepPolygons) {
+            mesh.polygonOffsets.reserve(object.faces.size() + 1);
+            mesh.polygonOffsets.push_back(0);
+        }
+        
+        for (const auto& face : object.faces) {
+            for (size_t i = 1; i + 1 < face.size(); i++) {
+                mesh.indices.push_back(static_cast<uint32_t>(face[0]));
+                mesh.indices.push_back(static_cast<uint32_t>(face[i]));
+                mesh.indices.push_back(static_cast<uint32_t>(face[i + 1]));
+            }
+            if (keepPolygons) {
+                mesh.polygonOffsets.push_back(static_cast<uint32_t>(mesh.indices.size() / 3));
+            }
+        }
+        
+        mesh.edgeIndices.reserve(object.edges.size() * 2);
+        for (const auto& edge : object.edges) {
+            mesh.edgeIndices.push_back(static_cast<uint32_t>(edge.first));
+            mesh.edgeIndices.push_back(static_cast<uint32_t>(edge.second));
+        }
+        
+        return mesh;
+    }
+    
+    // Rebuilds the original polygons when the offset table is present,
+    // otherwise every triangle becomes its own face. Faces with fewer than
+    // three vertices do not survive the round trip.
+    Object3D toObject3D() const {
+        Object3D object;
+        object.color = color;
+        object.texturePath = texturePath;
+        object.vertices.resize(count);
+        if (hasNormals) object.normals.resize(count);
+        if (hasTexCoords) object.texCoords.resize(count);
+        
+        for (size_t i = 0; i < count; i++) {
+            object.vertices[i] = position(i);
+            if (hasNormals) object.normals[i] = normal(i);
+            if (hasTexCoords) object.texCoords[i] = texCoord(i);
+        }
+        
+        if (polygonOffsets.empty()) {
+            object.faces.reserve(triangleCount());
+            for (size_t t = 0; t < triangleCount(); t++) {
+                object.faces.push_back({ static_cast<int>(indices[t * 3]),
+                                         static_cast<int>(indices[t * 3 + 1]),
+                                         static_cast<int>(indices[t * 3 + 2]) });
+            }
+        } else {
+            object.faces.reserve(polygonOffsets.size() - 1);
+            for (size_t p = 0; p + 1 < polygonOffsets.size(); p++) {
+                uint32_t first = polygonOffsets[p];
+                uint32_t last = polygonOffsets[p + 1];
+                if (first == last) continue;
+                
+                // Fan triangles share corner 0; each one adds a single new vertex
+                std::vector<int> face;
+                face.reserve(last - first + 2);
+                face.push_back(static_cast<int>(indices[first * 3]));
+                face.push_back(static_cast<int>(indices[first * 3 + 1]));
+                for (uint32_t t = first; t < last; t++) {
+                    face.push_back(static_cast<int>(indices[t * 3 + 2]));
+                }
+                object.faces.push_back(face);
+            }
+        }
+        
+        object.edges.reserve(edgeIndices.size() / 2);
+        for (size_t i = 0; i + 1 < edgeIndices.size(); i += 2) {
+            object.edges.push_back({ static_cast<int>(edgeIndices[i]), static_cast<int>(edgeIndices[i + 1]) });
+        }
+        
+        object.markModified();
+        return object;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef INSTANCE_DATA_H
+#define INSTANCE_DATA_H
+
+#include "Vector3.h"
+#include "Matrix4x4.h"
+#include "Quaternion.h"
+#include "TransformationPipeline.h"
+
+// One copy of an instanced object, packed into 64 bytes: the top three rows
+// of an affine model matrix (the bottom row is always 0 0 0 1) and an RGBA
+// color that replaces the object's color. Renderers ignore alpha; it pads
+// the color to 16 bytes.
+struct InstanceData {
+    float transform[3][4];
+    float color[4];
+    
+    InstanceData() {
+        setMatrix(Matrix4x4());
+        setColor(1.0f, 1.0f, 1.0f);
+    }
+    
+    InstanceData(const Matrix4x4& matrix, float r, float g, float b) {
+        setMatrix(matrix);
+        setColor(r, g, b);
+    }
+    
+    InstanceData(const Vector3& translation, const Vector3& rotation, const Vector3& scale,
+                 float r, float g, float b) {
+        setMatrix(TransformationPipeline::composeModelMatrix(translation, rotation, scale));
+        setColor(r, g, b);
+    }
+    
+    InstanceData(const Vector3& translation, const Quaternion& rotation, const Vector3& scale,
+                 float r, float g, float b) {
+        setMatrix(TransformationPipeline::composeModelMatrix(translation, rotation, scale));
+        setColor(r, g, b);
+    }
+    
+    void setMatrix(const Matrix4x4& matrix) {
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 4; j++) {
+                transform[i][j] = matrix.m[i][j];
+            }
+        }
+    }
+    
+    void setColor(float r, float g, float b) {
+        color[0] = r;
+        color[1] = g;
+        color[2] = b;
+        color[3] = 1.0f;
+    }
+    
+    Matrix4x4 matrix() const {
+        Matrix4x4 result;
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 4; j++) {
+                result.m[i][j] = transform[i][j];
+            }
+        }
+        return result;
+    }
+};
+
+#endif
\ No newline at end of file
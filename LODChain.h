@@ -0,0 +1,110 @@
+#ifndef LOD_CHAIN_H
+#define LOD_CHAIN_H
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "Matrix4x4.h"
+#include "Object3D.h"
+#include "BoundingVolume.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+// Levels of detail of one object, finest first, built offline by quadric
+// simplification. Level i is meant for objects whose projected diameter is
+// at least minScreenSize pixels; thresholds follow from a target screen
+// area per triangle, so a level with a quarter of the triangles takes over
+// at half the size. select() adds hysteresis around the thresholds so an
+// object hovering at a boundary does not pop between two levels. Simplified
+// levels are reordered for the vertex cache, since collapses leave their
+// triangles in no useful order.
+class LODChain {
+public:
+    struct Level {
+        Object3D mesh;
+        size_t triangleCount;
+        float minScreenSize;
+    };
+    
+    std::vector<Level> levels;
+    
+    // Relative margin a size must cross past a threshold before the level
+    // changes, in both directions
+    float hysteresis = 0.15f;
+    
+    // Each level keeps about reduction times the triangles of the previous
+    // one, down to minTriangles or maxLevels levels
+    static LODChain build(const Object3D& object, size_t maxLevels = 5, float reduction = 0.25f,
+                          float pixelsPerTriangle = 16.0f, size_t minTriangles = 16) {
+        LODChain chain;
+        Level finest;
+        finest.mesh = object;
+        finest.triangleCount = MeshSimplifier::triangleCount(object);
+        chain.levels.push_back(finest);
+        
+        while (chain.levels.size() < maxLevels) {
+            const Level& previous = chain.levels.back();
+            size_t target = static_cast<size_t>(previous.triangleCount * reduction);
+            if (target < minTriangles) break;
+            
+            Level level;
+            level.mesh = MeshSimplifier::simplify(previous.mesh, target);
+            level.triangleCount = MeshSimplifier::triangleCount(level.mesh);
+            
+            // Stuck on boundaries or flips: another level would not be coarser
+            if (level.triangleCount * 10 > previous.triangleCount * 9) break;
+            MeshOptimizer::optimize(level.mesh);
+            chain.levels.push_back(level);
+        }
+        
+        for (size_t i = 0; i < chain.levels.size(); i++) {
+            bool coarsest = i + 1 == chain.levels.size();
+            chain.levels[i].minScreenSize = coarsest ? 0.0f : std::sqrt(chain.levels[i].triangleCount * pixelsPerTriangle);
+        }
+        return chain;
+    }
+    
+    size_t levelCount() const {
+        return levels.size();
+    }
+    
+    const Object3D& level(size_t index) const {
+        return levels[index].mesh;
+    }
+    
+    // Projected diameter in pixels of an object-space sphere under the given
+    // model-view and projection matrices, for a viewport viewportHeight
+    // pixels tall. Infinite when the camera is inside the sphere.
+    static float screenSize(const BoundingSphere& sphere, const Matrix4x4& modelView,
+                            const Matrix4x4& projection, int viewportHeight) {
+        if (sphere.isEmpty()) return 0.0f;
+        BoundingSphere viewSphere = sphere.transformed(modelView);
+        float focal = projection.m[1][1] * viewportHeight;
+        
+        // Orthographic projections have no perspective divide
+        if (projection.m[3][2] == 0.0f) return viewSphere.radius * focal;
+        
+        float depth = -viewSphere.center.z;
+        if (depth <= viewSphere.radius) return std::numeric_limits<float>::infinity();
+        return viewSphere.radius * focal / depth;
+    }
+    
+    // Level for an object of the given screen size that is currently drawn
+    // at level current. Finer levels must be exceeded by the hysteresis
+    // margin; the current level is kept until the size drops the margin
+    // below its threshold.
+    size_t select(float size, size_t current) const {
+        if (levels.empty()) return 0;
+        if (current >= levels.size()) current = levels.size() - 1;
+        for (size_t i = 0; i < levels.size(); i++) {
+            float threshold = levels[i].minScreenSize;
+            if (i < current) threshold *= 1.0f + hysteresis;
+            else if (i == current) threshold *= 1.0f - hysteresis;
+            if (size >= threshold) return i;
+        }
+        return levels.size() - 1;
+    }
+};
+
+#endif
\ No newline at end of file
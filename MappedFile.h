@@ -0,0 +1,105 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only memory mapping of a whole file (POSIX). Throws on failure.
+class MappedFile {
+private:
+    int fd = -1;
+    void* mapping = nullptr;
+    size_t length = 0;
+    int64_t modificationTime = 0;
+    
+    void close() {
+        if (mapping != nullptr) munmap(mapping, length);
+        if (fd >= 0) ::close(fd);
+        mapping = nullptr;
+        fd = -1;
+        length = 0;
+    }
+
+public:
+    MappedFile() {}
+    
+    explicit MappedFile(const std::string& path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open file: " + path);
+        }
+        
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close();
+            throw std::runtime_error("Cannot stat file: " + path);
+        }
+        length = static_cast<size_t>(info.st_size);
+#ifdef __APPLE__
+        modificationTime = static_cast<int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+        modificationTime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+
+        if (length > 0) {
+            mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                mapping = nullptr;
+                close();
+                throw std::runtime_error("Cannot map file: " + path);
+            }
+            madvise(mapping, length, MADV_SEQUENTIAL);
+            madvise(mapping, length, MADV_WILLNEED);
+        }
+    }
+    
+    ~MappedFile() {
+        close();
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    MappedFile(MappedFile&& other) : fd(other.fd), mapping(other.mapping), length(other.length),
+                                     modificationTime(other.modificationTime) {
+        other.fd = -1;
+        other.mapping = nullptr;
+        other.length = 0;
+    }
+    
+    MappedFile& operator=(MappedFile&& other) {
+        if (this != &other) {
+            close();
+            fd = other.fd;
+            mapping = other.mapping;
+            length = other.length;
+            modificationTime = other.modificationTime;
+            other.fd = -1;
+            other.mapping = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+    
+    const char* data() const {
+        return static_cast<const char*>(mapping);
+    }
+    
+    size_t size() const {
+        return length;
+    }
+    
+    // Nanoseconds since the epoch
+    int64_t modifiedAt() const {
+        return modificationTime;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,950 @@
+#ifndef MATH_KERNELS_H
+#define MATH_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+#include "Vector3.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MATH_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+// Batched float kernels for the math types, with SSE2, AVX2 and AVX-512
+// versions picked at runtime from what the CPU supports. Every SIMD kernel
+// performs the same IEEE operations in the same order as its scalar version,
+// so all instruction sets give bit-identical results as long as the compiler
+// does not contract a * b + c into FMA. GCC contracts whenever the target
+// has FMA (e.g. -march=native), and clang 14 and later contract by default,
+// so contraction is turned off for this file below.
+//
+// Matrices are 16 floats in the row-major layout of Matrix4x4::m.
+// Output arrays may be the same as the input arrays.
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC fuses a * b + c into FMA inside the AVX-512 kernels even in ISO mode,
+// which would break bit-identity with the scalar path. GCC 12 also reports
+// its own _mm512_undefined_ps() as uninitialized.
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#elif defined(__clang__) && __clang_major__ >= 13
+// Older clang versions do not contract unless asked to with -ffp-contract
+#pragma float_control(push)
+#pragma clang fp contract(off)
+#endif
+
+class MathKernels {
+public:
+    enum class Isa { Scalar, SSE2, AVX2, AVX512 };
+
+private:
+    struct Table {
+        Isa isa;
+        void (*multiply4x4)(const float*, const float*, float*);
+        float (*inverse4x4)(const float*, float*);
+        void (*transformPoints)(const float*, const Vector3*, size_t, Vector3*);
+        void (*transformPointsToClip)(const float*, const Vector3*, size_t, float*);
+        void (*transformDirections)(const float*, const Vector3*, size_t, Vector3*);
+        void (*dot)(const Vector3*, const Vector3*, size_t, float*);
+        void (*cross)(const Vector3*, const Vector3*, size_t, Vector3*);
+        void (*normalize)(const Vector3*, size_t, Vector3*);
+        void (*triangleAreas)(const Vector3*, const Vector3*, size_t, float*);
+    };
+    
+    // ---- Scalar reference kernels ----
+    //
+    // Templated on the scalar so that Matrix4x4T over double or Fixed shares
+    // them; the table holds the float instances.
+    
+    template <typename T>
+    static void multiply4x4Scalar(const T* a, const T* b, T* out) {
+        T result[16];
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                T sum = T(0);
+                for (int k = 0; k < 4; k++) {
+                    sum += a[i * 4 + k] * b[k * 4 + j];
+                }
+                result[i * 4 + j] = sum;
+            }
+        }
+        for (int i = 0; i < 16; i++) out[i] = result[i];
+    }
+    
+    // Inverse by 2x2 minors: s* pair up rows 0 and 1, c* rows 2 and 3. Each
+    // adjugate entry is sign * ((P * X - Q * Y) + R * Z) over one column of
+    // the matrix and three minors, the determinant the dot product of row 0
+    // with adjugate column 0. Writes adjugate / determinant and returns the
+    // determinant; the output is not finite when it is zero.
+    template <typename T>
+    static T inverse4x4Scalar(const T* m, T* out) {
+        T s0 = m[0] * m[5] - m[4] * m[1];
+        T s3 = m[1] * m[6] - m[5] * m[2];
+        T s5 = m[2] * m[7] - m[6] * m[3];
+        T s2 = -(m[3] * m[4] - m[7] * m[0]);
+        T s1 = m[0] * m[6] - m[4] * m[2];
+        T s4 = m[1] * m[7] - m[5] * m[3];
+        T c0 = m[8] * m[13] - m[12] * m[9];
+        T c3 = m[9] * m[14] - m[13] * m[10];
+        T c5 = m[10] * m[15] - m[14] * m[11];
+        T c2 = -(m[11] * m[12] - m[15] * m[8]);
+        T c1 = m[8] * m[14] - m[12] * m[10];
+        T c4 = m[9] * m[15] - m[13] * m[11];
+        
+        T a[16] = {
+            (m[5] * c5 - m[6] * c4) + m[7] * c3,
+            -((m[1] * c5 - m[2] * c4) + m[3] * c3),
+            (m[13] * s5 - m[14] * s4) + m[15] * s3,
+            -((m[9] * s5 - m[10] * s4) + m[11] * s3),
+            -((m[4] * c5 - m[6] * c2) + m[7] * c1),
+            (m[0] * c5 - m[2] * c2) + m[3] * c1,
+            -((m[12] * s5 - m[14] * s2) + m[15] * s1),
+            (m[8] * s5 - m[10] * s2) + m[11] * s1,
+            (m[4] * c4 - m[5] * c2) + m[7] * c0,
+            -((m[0] * c4 - m[1] * c2) + m[3] * c0),
+            (m[12] * s4 - m[13] * s2) + m[15] * s0,
+            -((m[8] * s4 - m[9] * s2) + m[11] * s0),
+            -((m[4] * c3 - m[5] * c1) + m[6] * c0),
+            (m[0] * c3 - m[1] * c1) + m[2] * c0,
+            -((m[12] * s3 - m[13] * s1) + m[14] * s0),
+            (m[8] * s3 - m[9] * s1) + m[10] * s0
+        };
+        T det = ((m[0] * a[0] + m[1] * a[4]) + m[2] * a[8]) + m[3] * a[12];
+        T invDet = T(1) / det;
+        for (int i = 0; i < 16; i++) out[i] = a[i] * invDet;
+        return det;
+    }
+    
+    // Same arithmetic as Matrix4x4::transform, including the conditional w divide
+    template <typename T>
+    static void transformPointsScalar(const T* m, const Vector3T<T>* in, size_t count, Vector3T<T>* out) {
+        for (size_t i = 0; i < count; i++) {
+            Vector3T<T> v = in[i];
+            T x = v.x * m[0] + v.y * m[1] + v.z * m[2] + m[3];
+            T y = v.x * m[4] + v.y * m[5] + v.z * m[6] + m[7];
+            T z = v.x * m[8] + v.y * m[9] + v.z * m[10] + m[11];
+            T w = v.x * m[12] + v.y * m[13] + v.z * m[14] + m[15];
+            if (w != T(0) && w != T(1)) {
+                out[i] = Vector3T<T>(x / w, y / w, z / w);
+            } else {
+                out[i] = Vector3T<T>(x, y, z);
+            }
+        }
+    }
+    
+    template <typename T>
+    static void transformPointsToClipScalar(const T* m, const Vector3T<T>* in, size_t count, T* out) {
+        for (size_t i = 0; i < count; i++) {
+            Vector3T<T> v = in[i];
+            out[i * 4 + 0] = v.x * m[0] + v.y * m[1] + v.z * m[2] + m[3];
+            out[i * 4 + 1] = v.x * m[4] + v.y * m[5] + v.z * m[6] + m[7];
+            out[i * 4 + 2] = v.x * m[8] + v.y * m[9] + v.z * m[10] + m[11];
+            out[i * 4 + 3] = v.x * m[12] + v.y * m[13] + v.z * m[14] + m[15];
+        }
+    }
+    
+    template <typename T>
+    static void transformDirectionsScalar(const T* m, const Vector3T<T>* in, size_t count, Vector3T<T>* out) {
+        for (size_t i = 0; i < count; i++) {
+            Vector3T<T> v = in[i];
+            out[i] = Vector3T<T>(v.x * m[0] + v.y * m[1] + v.z * m[2],
+                                 v.x * m[4] + v.y * m[5] + v.z * m[6],
+                                 v.x * m[8] + v.y * m[9] + v.z * m[10]);
+        }
+    }
+    
+    static void dotScalar(const Vector3* a, const Vector3* b, size_t count, float* out) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = a[i].dot(b[i]);
+        }
+    }
+    
+    static void crossScalar(const Vector3* a, const Vector3* b, size_t count, Vector3* out) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = a[i].cross(b[i]);
+        }
+    }
+    
+    static void normalizeScalar(const Vector3* in, size_t count, Vector3* out) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = in[i].normalize();
+        }
+    }
+    
+    static void triangleAreasScalar(const Vector3* x, const Vector3* y, size_t count, float* out) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = (x[i].y - x[i].x) * (y[i].z - y[i].x) - (y[i].y - y[i].x) * (x[i].z - x[i].x);
+        }
+    }
+
+#ifdef MATH_KERNELS_X86
+    // ---- SSE2: 4 vectors per iteration ----
+    //
+    // Four packed Vector3 (12 floats) are split into x, y and z registers
+    // with shuffles and merged back the same way before storing.
+    
+    __attribute__((target("sse2")))
+    static void load3SSE2(const float* p, __m128& x, __m128& y, __m128& z) {
+        __m128 a = _mm_loadu_ps(p);
+        __m128 b = _mm_loadu_ps(p + 4);
+        __m128 c = _mm_loadu_ps(p + 8);
+        __m128 xy = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+        __m128 yz = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+        x = _mm_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+        y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+        z = _mm_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+    }
+    
+    __attribute__((target("sse2")))
+    static void store3SSE2(float* p, __m128 x, __m128 y, __m128 z) {
+        __m128 xy = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_ps(p, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(p + 4, _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm_storeu_ps(p + 8, _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    
+    __attribute__((target("sse2")))
+    static __m128 rowSSE2(const float* r, __m128 x, __m128 y, __m128 z) {
+        __m128 sum = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(r[0])), _mm_mul_ps(y, _mm_set1_ps(r[1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(z, _mm_set1_ps(r[2])));
+        return _mm_add_ps(sum, _mm_set1_ps(r[3]));
+    }
+    
+    __attribute__((target("sse2")))
+    static __m128 rowDirectionSSE2(const float* r, __m128 x, __m128 y, __m128 z) {
+        __m128 sum = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(r[0])), _mm_mul_ps(y, _mm_set1_ps(r[1])));
+        return _mm_add_ps(sum, _mm_mul_ps(z, _mm_set1_ps(r[2])));
+    }
+    
+    __attribute__((target("sse2")))
+    static void multiply4x4SSE2(const float* a, const float* b, float* out) {
+        __m128 b0 = _mm_loadu_ps(b);
+        __m128 b1 = _mm_loadu_ps(b + 4);
+        __m128 b2 = _mm_loadu_ps(b + 8);
+        __m128 b3 = _mm_loadu_ps(b + 12);
+        __m128 rows[4];
+        for (int i = 0; i < 4; i++) {
+            __m128 sum = _mm_setzero_ps();
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[i * 4 + 0]), b0));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[i * 4 + 1]), b1));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[i * 4 + 2]), b2));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[i * 4 + 3]), b3));
+            rows[i] = sum;
+        }
+        for (int i = 0; i < 4; i++) _mm_storeu_ps(out + i * 4, rows[i]);
+    }
+    
+    // The whole matrix fits four registers, so the wider instruction sets
+    // use this kernel too
+    __attribute__((target("sse2")))
+    static float inverse4x4SSE2(const float* m, float* out) {
+        __m128 r0 = _mm_loadu_ps(m);
+        __m128 r1 = _mm_loadu_ps(m + 4);
+        __m128 r2 = _mm_loadu_ps(m + 8);
+        __m128 r3 = _mm_loadu_ps(m + 12);
+        
+        // Columns with their lanes in row order 1, 0, 3, 2
+        __m128 t0 = _mm_unpacklo_ps(r1, r0);
+        __m128 t1 = _mm_unpackhi_ps(r1, r0);
+        __m128 t2 = _mm_unpacklo_ps(r3, r2);
+        __m128 t3 = _mm_unpackhi_ps(r3, r2);
+        __m128 col0 = _mm_movelh_ps(t0, t2);
+        __m128 col1 = _mm_movehl_ps(t2, t0);
+        __m128 col2 = _mm_movelh_ps(t1, t3);
+        __m128 col3 = _mm_movehl_ps(t3, t1);
+        
+        // (s0, s3, s5, -s2), (s1, s4, -s1, -s4) and the same for c*
+        __m128 s03 = _mm_sub_ps(_mm_mul_ps(r0, _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(0, 3, 2, 1))),
+                                _mm_mul_ps(r1, _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(0, 3, 2, 1))));
+        __m128 s14 = _mm_sub_ps(_mm_mul_ps(r0, _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(1, 0, 3, 2))),
+                                _mm_mul_ps(r1, _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(1, 0, 3, 2))));
+        __m128 c03 = _mm_sub_ps(_mm_mul_ps(r2, _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(0, 3, 2, 1))),
+                                _mm_mul_ps(r3, _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(0, 3, 2, 1))));
+        __m128 c14 = _mm_sub_ps(_mm_mul_ps(r2, _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(1, 0, 3, 2))),
+                                _mm_mul_ps(r3, _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(1, 0, 3, 2))));
+        
+        // (ck, ck, sk, sk): adjugate columns 0 and 1 use c*, 2 and 3 use s*
+        const __m128 negate = _mm_set1_ps(-0.0f);
+        __m128 k0 = _mm_shuffle_ps(c03, s03, _MM_SHUFFLE(0, 0, 0, 0));
+        __m128 k3 = _mm_shuffle_ps(c03, s03, _MM_SHUFFLE(1, 1, 1, 1));
+        __m128 k5 = _mm_shuffle_ps(c03, s03, _MM_SHUFFLE(2, 2, 2, 2));
+        __m128 k2 = _mm_xor_ps(_mm_shuffle_ps(c03, s03, _MM_SHUFFLE(3, 3, 3, 3)), negate);
+        __m128 k1 = _mm_shuffle_ps(c14, s14, _MM_SHUFFLE(0, 0, 0, 0));
+        __m128 k4 = _mm_shuffle_ps(c14, s14, _MM_SHUFFLE(1, 1, 1, 1));
+        
+        const __m128 negateOdd = _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+        const __m128 negateEven = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+        __m128 a0 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(col1, k5), _mm_mul_ps(col2, k4)), _mm_mul_ps(col3, k3));
+        __m128 a1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(col0, k5), _mm_mul_ps(col2, k2)), _mm_mul_ps(col3, k1));
+        __m128 a2 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(col0, k4), _mm_mul_ps(col1, k2)), _mm_mul_ps(col3, k0));
+        __m128 a3 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(col0, k3), _mm_mul_ps(col1, k1)), _mm_mul_ps(col2, k0));
+        a0 = _mm_xor_ps(a0, negateOdd);
+        a1 = _mm_xor_ps(a1, negateEven);
+        a2 = _mm_xor_ps(a2, negateOdd);
+        a3 = _mm_xor_ps(a3, negateEven);
+        
+        __m128 column = _mm_movelh_ps(_mm_unpacklo_ps(a0, a1), _mm_unpacklo_ps(a2, a3));
+        __m128 terms = _mm_mul_ps(r0, column);
+        float p[4];
+        _mm_storeu_ps(p, terms);
+        float det = ((p[0] + p[1]) + p[2]) + p[3];
+        __m128 invDet = _mm_set1_ps(1.0f / det);
+        _mm_storeu_ps(out, _mm_mul_ps(a0, invDet));
+        _mm_storeu_ps(out + 4, _mm_mul_ps(a1, invDet));
+        _mm_storeu_ps(out + 8, _mm_mul_ps(a2, invDet));
+        _mm_storeu_ps(out + 12, _mm_mul_ps(a3, invDet));
+        return det;
+    }
+    
+    __attribute__((target("sse2")))
+    static void transformPointsSSE2(const float* m, const Vector3* in, size_t count, Vector3* out) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 x, y, z;
+            load3SSE2(&in[i].x, x, y, z);
+            __m128 tx = rowSSE2(m, x, y, z);
+            __m128 ty = rowSSE2(m + 4, x, y, z);
+            __m128 tz = rowSSE2(m + 8, x, y, z);
+            __m128 tw = rowSSE2(m + 12, x, y, z);
+            __m128 divide = _mm_and_ps(_mm_cmpneq_ps(tw, zero), _mm_cmpneq_ps(tw, one));
+            tx = _mm_or_ps(_mm_and_ps(divide, _mm_div_ps(tx, tw)), _mm_andnot_ps(divide, tx));
+            ty = _mm_or_ps(_mm_and_ps(divide, _mm_div_ps(ty, tw)), _mm_andnot_ps(divide, ty));
+            tz = _mm_or_ps(_mm_and_ps(divide, _mm_div_ps(tz, tw)), _mm_andnot_ps(divide, tz));
+            store3SSE2(&out[i].x, tx, ty, tz);
+        }
+        transformPointsScalar(m, in + i, count - i, out + i);
+    }
+    
+    __attribute__((target("sse2")))
+    static void transformPointsToClipSSE2(const float* m, const Vector3* in, size_t count, float* out) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 x, y, z;
+            load3SSE2(&in[i].x, x, y, z);
+            __m128 tx = rowSSE2(m, x, y, z);
+            __m128 ty = rowSSE2(m + 4, x, y, z);
+            __m128 tz = rowSSE2(m + 8, x, y, z);
+            __m128 tw = rowSSE2(m + 12, x, y, z);
+            _MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+            _mm_storeu_ps(out + i * 4, tx);
+            _mm_storeu_ps(out + i * 4 + 4, ty);
+            _mm_storeu_ps(out + i * 4 + 8, tz);
+            _mm_storeu_ps(out + i * 4 + 12, tw);
+        }
+        transformPointsToClipScalar(m, in + i, count - i, out + i * 4);
+    }
+    
+    __attribute__((target("sse2")))
+    static void transformDirectionsSSE2(const float* m, const Vector3* in, size_t count, Vector3* out) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 x, y, z;
+            load3SSE2(&in[i].x, x, y, z);
+            __m128 tx = rowDirectionSSE2(m, x, y, z);
+            __m128 ty = rowDirectionSSE2(m + 4, x, y, z);
+            __m128 tz = rowDirectionSSE2(m + 8, x, y, z);
+            store3SSE2(&out[i].x, tx, ty, tz);
+        }
+        transformDirectionsScalar(m, in + i, count - i, out + i);
+    }
+    
+    __attribute__((target("sse2")))
+    static void dotSSE2(const Vector3* a, const Vector3* b, size_t count, float* out) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 ax, ay, az, bx, by, bz;
+            load3SSE2(&a[i].x, ax, ay, az);
+            load3SSE2(&b[i].x, bx, by, bz);
+            __m128 sum = _mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by));
+            _mm_storeu_ps(out + i, _mm_add_ps(sum, _mm_mul_ps(az, bz)));
+        }
+        dotScalar(a + i, b + i, count - i, out + i);
+    }
+    
+    __attribute__((target("sse2")))
+    static void crossSSE2(const Vector3* a, const Vector3* b, size_t count, Vector3* out) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 ax, ay, az, bx, by, bz;
+            load3SSE2(&a[i].x, ax, ay, az);
+            load3SSE2(&b[i].x, bx, by, bz);
+            __m128 cx = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+            __m128 cy = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+            __m128 cz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+            store3SSE2(&out[i].x, cx, cy, cz);
+        }
+        crossScalar(a + i, b + i, count - i, out + i);
+    }
+    
+    __attribute__((target("sse2")))
+    static void normalizeSSE2(const Vector3* in, size_t count, Vector3* out) {
+        const __m128 zero = _mm_setzero_ps();
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 x, y, z;
+            load3SSE2(&in[i].x, x, y, z);
+            __m128 sum = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+            __m128 mag = _mm_sqrt_ps(_mm_add_ps(sum, _mm_mul_ps(z, z)));
+            __m128 nonZero = _mm_cmpneq_ps(mag, zero);
+            store3SSE2(&out[i].x,
+                       _mm_and_ps(nonZero, _mm_div_ps(x, mag)),
+                       _mm_and_ps(nonZero, _mm_div_ps(y, mag)),
+                       _mm_and_ps(nonZero, _mm_div_ps(z, mag)));
+        }
+        normalizeScalar(in + i, count - i, out + i);
+    }
+    
+    __attribute__((target("sse2")))
+    static void triangleAreasSSE2(const Vector3* x, const Vector3* y, size_t count, float* out) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 ax, bx, cx, ay, by, cy;
+            load3SSE2(&x[i].x, ax, bx, cx);
+            load3SSE2(&y[i].x, ay, by, cy);
+            _mm_storeu_ps(out + i, _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(bx, ax), _mm_sub_ps(cy, ay)),
+                                              _mm_mul_ps(_mm_sub_ps(by, ay), _mm_sub_ps(cx, ax))));
+        }
+        triangleAreasScalar(x + i, y + i, count - i, out + i);
+    }
+    
+    // ---- AVX2: 8 vectors per iteration ----
+    //
+    // Same shuffles as SSE2; each 128-bit lane holds four of the eight vectors.
+    
+    __attribute__((target("avx2")))
+    static void load3AVX2(const float* p, __m256& x, __m256& y, __m256& z) {
+        __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1);
+        __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+        __m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+        __m256 xy = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+        __m256 yz = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+        x = _mm256_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+        y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+        z = _mm256_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+    }
+    
+    __attribute__((target("avx2")))
+    static void store3AVX2(float* p, __m256 x, __m256 y, __m256 z) {
+        __m256 xy = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 yz = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+        __m256 zx = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+        __m256 a = _mm256_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 b = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+        __m256 c = _mm256_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(p, _mm256_castps256_ps128(a));
+        _mm_storeu_ps(p + 4, _mm256_castps256_ps128(b));
+        _mm_storeu_ps(p + 8, _mm256_castps256_ps128(c));
+        _mm_storeu_ps(p + 12, _mm256_extractf128_ps(a, 1));
+        _mm_storeu_ps(p + 16, _mm256_extractf128_ps(b, 1));
+        _mm_storeu_ps(p + 20, _mm256_extractf128_ps(c, 1));
+    }
+    
+    __attribute__((target("avx2")))
+    static __m256 rowAVX2(const float* r, __m256 x, __m256 y, __m256 z) {
+        __m256 sum = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(r[0])), _mm256_mul_ps(y, _mm256_set1_ps(r[1])));
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(z, _mm256_set1_ps(r[2])));
+        return _mm256_add_ps(sum, _mm256_set1_ps(r[3]));
+    }
+    
+    __attribute__((target("avx2")))
+    static __m256 rowDirectionAVX2(const float* r, __m256 x, __m256 y, __m256 z) {
+        __m256 sum = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(r[0])), _mm256_mul_ps(y, _mm256_set1_ps(r[1])));
+        return _mm256_add_ps(sum, _mm256_mul_ps(z, _mm256_set1_ps(r[2])));
+    }
+    
+    // Two result rows per register: lane 0 holds row i, lane 1 row i + 1
+    __attribute__((target("avx2")))
+    static void multiply4x4AVX2(const float* a, const float* b, float* out) {
+        __m256 bRows[4];
+        for (int k = 0; k < 4; k++) {
+            bRows[k] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + k * 4));
+        }
+        __m256 rows[2];
+        for (int i = 0; i < 2; i++) {
+            __m256 sum = _mm256_setzero_ps();
+            for (int k = 0; k < 4; k++) {
+                __m256 ak = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(a[i * 8 + k])),
+                                                 _mm_set1_ps(a[i * 8 + 4 + k]), 1);
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(ak, bRows[k]));
+            }
+            rows[i] = sum;
+        }
+        _mm256_storeu_ps(out, rows[0]);
+        _mm256_storeu_ps(out + 8, rows[1]);
+    }
+    
+    __attribute__((target("avx2")))
+    static void transformPointsAVX2(const float* m, const Vector3* in, size_t count, Vector3* out) {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 x, y, z;
+            load3AVX2(&in[i].x, x, y, z);
+            __m256 tx = rowAVX2(m, x, y, z);
+            __m256 ty = rowAVX2(m + 4, x, y, z);
+            __m256 tz = rowAVX2(m + 8, x, y, z);
+            __m256 tw = rowAVX2(m + 12, x, y, z);
+            __m256 divide = _mm256_and_ps(_mm256_cmp_ps(tw, zero, _CMP_NEQ_UQ), _mm256_cmp_ps(tw, one, _CMP_NEQ_UQ));
+            tx = _mm256_blendv_ps(tx, _mm256_div_ps(tx, tw), divide);
+            ty = _mm256_blendv_ps(ty, _mm256_div_ps(ty, tw), divide);
+            tz = _mm256_blendv_ps(tz, _mm256_div_ps(tz, tw), divide);
+            store3AVX2(&out[i].x, tx, ty, tz);
+        }
+        transformPointsSSE2(m, in + i, count - i, out + i);
+    }
+    
+    __attribute__((target("avx2")))
+    static void transformPointsToClipAVX2(const float* m, const Vector3* in, size_t count, float* out) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 x, y, z;
+            load3AVX2(&in[i].x, x, y, z);
+            __m256 tx = rowAVX2(m, x, y, z);
+            __m256 ty = rowAVX2(m + 4, x, y, z);
+            __m256 tz = rowAVX2(m + 8, x, y, z);
+            __m256 tw = rowAVX2(m + 12, x, y, z);
+            // 4x4 transpose inside each lane, then lane 0 holds vectors 0-3 and lane 1 vectors 4-7
+            __m256 t0 = _mm256_unpacklo_ps(tx, ty);
+            __m256 t1 = _mm256_unpackhi_ps(tx, ty);
+            __m256 t2 = _mm256_unpacklo_ps(tz, tw);
+            __m256 t3 = _mm256_unpackhi_ps(tz, tw);
+            __m256 v0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 v1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 v2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 v3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+            float* o = out + i * 4;
+            _mm256_storeu_ps(o, _mm256_permute2f128_ps(v0, v1, 0x20));
+            _mm256_storeu_ps(o + 8, _mm256_permute2f128_ps(v2, v3, 0x20));
+            _mm256_storeu_ps(o + 16, _mm256_permute2f128_ps(v0, v1, 0x31));
+            _mm256_storeu_ps(o + 24, _mm256_permute2f128_ps(v2, v3, 0x31));
+        }
+        transformPointsToClipSSE2(m, in + i, count - i, out + i * 4);
+    }
+    
+    __attribute__((target("avx2")))
+    static void transformDirectionsAVX2(const float* m, const Vector3* in, size_t count, Vector3* out) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 x, y, z;
+            load3AVX2(&in[i].x, x, y, z);
+            __m256 tx = rowDirectionAVX2(m, x, y, z);
+            __m256 ty = rowDirectionAVX2(m + 4, x, y, z);
+            __m256 tz = rowDirectionAVX2(m + 8, x, y, z);
+            store3AVX2(&out[i].x, tx, ty, tz);
+        }
+        transformDirectionsSSE2(m, in + i, count - i, out + i);
+    }
+    
+    __attribute__((target("avx2")))
+    static void dotAVX2(const Vector3* a, const Vector3* b, size_t count, float* out) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 ax, ay, az, bx, by, bz;
+            load3AVX2(&a[i].x, ax, ay, az);
+            load3AVX2(&b[i].x, bx, by, bz);
+            __m256 sum = _mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by));
+            _mm256_storeu_ps(out + i, _mm256_add_ps(sum, _mm256_mul_ps(az, bz)));
+        }
+        dotSSE2(a + i, b + i, count - i, out + i);
+    }
+    
+    __attribute__((target("avx2")))
+    static void crossAVX2(const Vector3* a, const Vector3* b, size_t count, Vector3* out) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 ax, ay, az, bx, by, bz;
+            load3AVX2(&a[i].x, ax, ay, az);
+            load3AVX2(&b[i].x, bx, by, bz);
+            __m256 cx = _mm256_sub_ps(_mm256_mul_ps(ay, bz), _mm256_mul_ps(az, by));
+            __m256 cy = _mm256_sub_ps(_mm256_mul_ps(az, bx), _mm256_mul_ps(ax, bz));
+            __m256 cz = _mm256_sub_ps(_mm256_mul_ps(ax, by), _mm256_mul_ps(ay, bx));
+            store3AVX2(&out[i].x, cx, cy, cz);
+        }
+        crossSSE2(a + i, b + i, count - i, out + i);
+    }
+    
+    __attribute__((target("avx2")))
+    static void normalizeAVX2(const Vector3* in, size_t count, Vector3* out) {
+        const __m256 zero = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 x, y, z;
+            load3AVX2(&in[i].x, x, y, z);
+            __m256 sum = _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y));
+            __m256 mag = _mm256_sqrt_ps(_mm256_add_ps(sum, _mm256_mul_ps(z, z)));
+            __m256 nonZero = _mm256_cmp_ps(mag, zero, _CMP_NEQ_UQ);
+            store3AVX2(&out[i].x,
+                       _mm256_and_ps(nonZero, _mm256_div_ps(x, mag)),
+                       _mm256_and_ps(nonZero, _mm256_div_ps(y, mag)),
+                       _mm256_and_ps(nonZero, _mm256_div_ps(z, mag)));
+        }
+        normalizeSSE2(in + i, count - i, out + i);
+    }
+    
+    __attribute__((target("avx2")))
+    static void triangleAreasAVX2(const Vector3* x, const Vector3* y, size_t count, float* out) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 ax, bx, cx, ay, by, cy;
+            load3AVX2(&x[i].x, ax, bx, cx);
+            load3AVX2(&y[i].x, ay, by, cy);
+            _mm256_storeu_ps(out + i, _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(bx, ax), _mm256_sub_ps(cy, ay)),
+                                                    _mm256_mul_ps(_mm256_sub_ps(by, ay), _mm256_sub_ps(cx, ax))));
+        }
+        triangleAreasSSE2(x + i, y + i, count - i, out + i);
+    }
+    
+    // ---- AVX-512: 16 vectors per iteration ----
+    
+    __attribute__((target("avx512f")))
+    static __m512 load4Lanes(const float* p0, const float* p1, const float* p2, const float* p3) {
+        __m512 v = _mm512_castps128_ps512(_mm_loadu_ps(p0));
+        v = _mm512_insertf32x4(v, _mm_loadu_ps(p1), 1);
+        v = _mm512_insertf32x4(v, _mm_loadu_ps(p2), 2);
+        return _mm512_insertf32x4(v, _mm_loadu_ps(p3), 3);
+    }
+    
+    __attribute__((target("avx512f")))
+    static void store4Lanes(__m512 v, float* p0, float* p1, float* p2, float* p3) {
+        _mm_storeu_ps(p0, _mm512_castps512_ps128(v));
+        _mm_storeu_ps(p1, _mm512_extractf32x4_ps(v, 1));
+        _mm_storeu_ps(p2, _mm512_extractf32x4_ps(v, 2));
+        _mm_storeu_ps(p3, _mm512_extractf32x4_ps(v, 3));
+    }
+    
+    __attribute__((target("avx512f")))
+    static void load3AVX512(const float* p, __m512& x, __m512& y, __m512& z) {
+        __m512 a = load4Lanes(p, p + 12, p + 24, p + 36);
+        __m512 b = load4Lanes(p + 4, p + 16, p + 28, p + 40);
+        __m512 c = load4Lanes(p + 8, p + 20, p + 32, p + 44);
+        __m512 xy = _mm512_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+        __m512 yz = _mm512_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+        x = _mm512_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+        y = _mm512_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+        z = _mm512_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+    }
+    
+    __attribute__((target("avx512f")))
+    static void store3AVX512(float* p, __m512 x, __m512 y, __m512 z) {
+        __m512 xy = _mm512_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+        __m512 yz = _mm512_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+        __m512 zx = _mm512_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+        store4Lanes(_mm512_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)), p, p + 12, p + 24, p + 36);
+        store4Lanes(_mm512_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)), p + 4, p + 16, p + 28, p + 40);
+        store4Lanes(_mm512_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1)), p + 8, p + 20, p + 32, p + 44);
+    }
+    
+    __attribute__((target("avx512f")))
+    static __m512 rowAVX512(const float* r, __m512 x, __m512 y, __m512 z) {
+        __m512 sum = _mm512_add_ps(_mm512_mul_ps(x, _mm512_set1_ps(r[0])), _mm512_mul_ps(y, _mm512_set1_ps(r[1])));
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(z, _mm512_set1_ps(r[2])));
+        return _mm512_add_ps(sum, _mm512_set1_ps(r[3]));
+    }
+    
+    __attribute__((target("avx512f")))
+    static __m512 rowDirectionAVX512(const float* r, __m512 x, __m512 y, __m512 z) {
+        __m512 sum = _mm512_add_ps(_mm512_mul_ps(x, _mm512_set1_ps(r[0])), _mm512_mul_ps(y, _mm512_set1_ps(r[1])));
+        return _mm512_add_ps(sum, _mm512_mul_ps(z, _mm512_set1_ps(r[2])));
+    }
+    
+    // All four result rows in one register, one row per 128-bit lane
+    __attribute__((target("avx512f")))
+    static void multiply4x4AVX512(const float* a, const float* b, float* out) {
+        __m512 aRows = _mm512_loadu_ps(a);
+        __m512 sum = _mm512_setzero_ps();
+        for (int k = 0; k < 4; k++) {
+            __m512i column = _mm512_set_epi32(12 + k, 12 + k, 12 + k, 12 + k, 8 + k, 8 + k, 8 + k, 8 + k,
+                                              4 + k, 4 + k, 4 + k, 4 + k, k, k, k, k);
+            __m512 ak = _mm512_permutexvar_ps(column, aRows);
+            __m512 bk = _mm512_broadcast_f32x4(_mm_loadu_ps(b + k * 4));
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(ak, bk));
+        }
+        _mm512_storeu_ps(out, sum);
+    }
+    
+    __attribute__((target("avx512f")))
+    static void transformPointsAVX512(const float* m, const Vector3* in, size_t count, Vector3* out) {
+        const __m512 zero = _mm512_setzero_ps();
+        const __m512 one = _mm512_set1_ps(1.0f);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m512 x, y, z;
+            load3AVX512(&in[i].x, x, y, z);
+            __m512 tx = rowAVX512(m, x, y, z);
+            __m512 ty = rowAVX512(m + 4, x, y, z);
+            __m512 tz = rowAVX512(m + 8, x, y, z);
+            __m512 tw = rowAVX512(m + 12, x, y, z);
+            __mmask16 divide = _mm512_cmp_ps_mask(tw, zero, _CMP_NEQ_UQ) & _mm512_cmp_ps_mask(tw, one, _CMP_NEQ_UQ);
+            tx = _mm512_mask_div_ps(tx, divide, tx, tw);
+            ty = _mm512_mask_div_ps(ty, divide, ty, tw);
+            tz = _mm512_mask_div_ps(tz, divide, tz, tw);
+            store3AVX512(&out[i].x, tx, ty, tz);
+        }
+        transformPointsAVX2(m, in + i, count - i, out + i);
+    }
+    
+    __attribute__((target("avx512f")))
+    static void transformPointsToClipAVX512(const float* m, const Vector3* in, size_t count, float* out) {
+        // Per quad of output lanes: x and y of one vector from the first
+        // permute, z and w from the second
+        const __m512i xyLanes = _mm512_set_epi32(0, 0, 19, 3, 0, 0, 18, 2, 0, 0, 17, 1, 0, 0, 16, 0);
+        const __m512i zwLanes = _mm512_set_epi32(19, 3, 0, 0, 18, 2, 0, 0, 17, 1, 0, 0, 16, 0, 0, 0);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m512 x, y, z;
+            load3AVX512(&in[i].x, x, y, z);
+            __m512 tx = rowAVX512(m, x, y, z);
+            __m512 ty = rowAVX512(m + 4, x, y, z);
+            __m512 tz = rowAVX512(m + 8, x, y, z);
+            __m512 tw = rowAVX512(m + 12, x, y, z);
+            for (int block = 0; block < 4; block++) {
+                __m512i offset = _mm512_set1_epi32(block * 4);
+                __m512 xy = _mm512_permutex2var_ps(tx, _mm512_add_epi32(xyLanes, offset), ty);
+                __m512 zw = _mm512_permutex2var_ps(tz, _mm512_add_epi32(zwLanes, offset), tw);
+                _mm512_storeu_ps(out + (i + block * 4) * 4, _mm512_mask_blend_ps(0xCCCC, xy, zw));
+            }
+        }
+        transformPointsToClipAVX2(m, in + i, count - i, out + i * 4);
+    }
+    
+    __attribute__((target("avx512f")))
+    static void transformDirectionsAVX512(const float* m, const Vector3* in, size_t count, Vector3* out) {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m512 x, y, z;
+            load3AVX512(&in[i].x, x, y, z);
+            __m512 tx = rowDirectionAVX512(m, x, y, z);
+            __m512 ty = rowDirectionAVX512(m + 4, x, y, z);
+            __m512 tz = rowDirectionAVX512(m + 8, x, y, z);
+            store3AVX512(&out[i].x, tx, ty, tz);
+        }
+        transformDirectionsAVX2(m, in + i, count - i, out + i);
+    }
+    
+    __attribute__((target("avx512f")))
+    static void dotAVX512(const Vector3* a, const Vector3* b, size_t count, float* out) {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m512 ax, ay, az, bx, by, bz;
+            load3AVX512(&a[i].x, ax, ay, az);
+            load3AVX512(&b[i].x, bx, by, bz);
+            __m512 sum = _mm512_add_ps(_mm512_mul_ps(ax, bx), _mm512_mul_ps(ay, by));
+            _mm512_storeu_ps(out + i, _mm512_add_ps(sum, _mm512_mul_ps(az, bz)));
+        }
+        dotAVX2(a + i, b + i, count - i, out + i);
+    }
+    
+    __attribute__((target("avx512f")))
+    static void crossAVX512(const Vector3* a, const Vector3* b, size_t count, Vector3* out) {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m512 ax, ay, az, bx, by, bz;
+            load3AVX512(&a[i].x, ax, ay, az);
+            load3AVX512(&b[i].x, bx, by, bz);
+            __m512 cx = _mm512_sub_ps(_mm512_mul_ps(ay, bz), _mm512_mul_ps(az, by));
+            __m512 cy = _mm512_sub_ps(_mm512_mul_ps(az, bx), _mm512_mul_ps(ax, bz));
+            __m512 cz = _mm512_sub_ps(_mm512_mul_ps(ax, by), _mm512_mul_ps(ay, bx));
+            store3AVX512(&out[i].x, cx, cy, cz);
+        }
+        crossAVX2(a + i, b + i, count - i, out + i);
+    }
+    
+    __attribute__((target("avx512f")))
+    static void normalizeAVX512(const Vector3* in, size_t count, Vector3* out) {
+        const __m512 zero = _mm512_setzero_ps();
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m512 x, y, z;
+            load3AVX512(&in[i].x, x, y, z);
+            __m512 sum = _mm512_add_ps(_mm512_mul_ps(x, x), _mm512_mul_ps(y, y));
+            __m512 mag = _mm512_sqrt_ps(_mm512_add_ps(sum, _mm512_mul_ps(z, z)));
+            __mmask16 nonZero = _mm512_cmp_ps_mask(mag, zero, _CMP_NEQ_UQ);
+            store3AVX512(&out[i].x,
+                         _mm512_maskz_div_ps(nonZero, x, mag),
+                         _mm512_maskz_div_ps(nonZero, y, mag),
+                         _mm512_maskz_div_ps(nonZero, z, mag));
+        }
+        normalizeAVX2(in + i, count - i, out + i);
+    }
+    
+    __attribute__((target("avx512f")))
+    static void triangleAreasAVX512(const Vector3* x, const Vector3* y, size_t count, float* out) {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m512 ax, bx, cx, ay, by, cy;
+            load3AVX512(&x[i].x, ax, bx, cx);
+            load3AVX512(&y[i].x, ay, by, cy);
+            _mm512_storeu_ps(out + i, _mm512_sub_ps(_mm512_mul_ps(_mm512_sub_ps(bx, ax), _mm512_sub_ps(cy, ay)),
+                                                    _mm512_mul_ps(_mm512_sub_ps(by, ay), _mm512_sub_ps(cx, ax))));
+        }
+        triangleAreasAVX2(x + i, y + i, count - i, out + i);
+    }
+#endif
+
+    static Table makeTable(Isa isa) {
+        Table t = { Isa::Scalar, multiply4x4Scalar, inverse4x4Scalar, transformPointsScalar, transformPointsToClipScalar,
+                    transformDirectionsScalar, dotScalar, crossScalar, normalizeScalar, triangleAreasScalar };
+#ifdef MATH_KERNELS_X86
+        if (isa == Isa::SSE2) {
+            t = { Isa::SSE2, multiply4x4SSE2, inverse4x4SSE2, transformPointsSSE2, transformPointsToClipSSE2,
+                  transformDirectionsSSE2, dotSSE2, crossSSE2, normalizeSSE2, triangleAreasSSE2 };
+        } else if (isa == Isa::AVX2) {
+            t = { Isa::AVX2, multiply4x4AVX2, inverse4x4SSE2, transformPointsAVX2, transformPointsToClipAVX2,
+                  transformDirectionsAVX2, dotAVX2, crossAVX2, normalizeAVX2, triangleAreasAVX2 };
+        } else if (isa == Isa::AVX512) {
+            t = { Isa::AVX512, multiply4x4AVX512, inverse4x4SSE2, transformPointsAVX512, transformPointsToClipAVX512,
+                  transformDirectionsAVX512, dotAVX512, crossAVX512, normalizeAVX512, triangleAreasAVX512 };
+        }
+#else
+        (void)isa;
+#endif
+        return t;
+    }
+    
+    static Table& table() {
+        static Table activeTable = makeTable(supportedIsa());
+        return activeTable;
+    }
+
+public:
+    // Best instruction set the CPU and operating system support
+    static Isa supportedIsa() {
+#ifdef MATH_KERNELS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return Isa::AVX512;
+        if (__builtin_cpu_supports("avx2")) return Isa::AVX2;
+        if (__builtin_cpu_supports("sse2")) return Isa::SSE2;
+#endif
+        return Isa::Scalar;
+    }
+    
+    static Isa activeIsa() {
+        return table().isa;
+    }
+    
+    // Forces a specific instruction set, e.g. to compare results against the
+    // scalar kernels. Fails for sets the CPU lacks. Not thread-safe with
+    // respect to kernels running concurrently.
+    static bool setIsa(Isa isa) {
+        if (static_cast<int>(isa) > static_cast<int>(supportedIsa())) {
+            return false;
+        }
+        table() = makeTable(isa);
+        return true;
+    }
+    
+    static const char* isaName(Isa isa) {
+        switch (isa) {
+            case Isa::SSE2: return "SSE2";
+            case Isa::AVX2: return "AVX2";
+            case Isa::AVX512: return "AVX-512";
+            default: return "scalar";
+        }
+    }
+    
+    static void multiply4x4(const float* a, const float* b, float* out) {
+        table().multiply4x4(a, b, out);
+    }
+    
+    // General inverse; returns the determinant, and out is not finite when
+    // it is zero
+    static float inverse4x4(const float* m, float* out) {
+        return table().inverse4x4(m, out);
+    }
+    
+    // Matrix4x4::transform over an array, w divide included
+    static void transformPoints(const float* m, const Vector3* in, size_t count, Vector3* out) {
+        table().transformPoints(m, in, count, out);
+    }
+    
+    // Homogeneous (x, y, z, w) per point without the divide; out holds 4 * count floats
+    static void transformPointsToClip(const float* m, const Vector3* in, size_t count, float* out) {
+        table().transformPointsToClip(m, in, count, out);
+    }
+    
+    // Upper 3x3 only: no translation, no projection
+    static void transformDirections(const float* m, const Vector3* in, size_t count, Vector3* out) {
+        table().transformDirections(m, in, count, out);
+    }
+    
+    // Product of two affine matrices (bottom row 0 0 0 1) in 36 multiplies:
+    // the bottom-row terms are skipped and the bottom row is written as
+    // 0 0 0 1. Scalar for every type; it is here so that it is compiled
+    // without FMA contraction like the other kernels.
+    template <typename T>
+    static void multiplyAffine4x4(const T* a, const T* b, T* out) {
+        T result[16];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 4; j++) {
+                result[i * 4 + j] = a[i * 4] * b[j] + a[i * 4 + 1] * b[4 + j] + a[i * 4 + 2] * b[8 + j];
+            }
+            result[i * 4 + 3] = result[i * 4 + 3] + a[i * 4 + 3];
+        }
+        result[12] = T(0);
+        result[13] = T(0);
+        result[14] = T(0);
+        result[15] = T(1);
+        for (int i = 0; i < 16; i++) out[i] = result[i];
+    }
+    
+    // Other scalar types always take the scalar kernels
+    template <typename T>
+    static void multiply4x4(const T* a, const T* b, T* out) {
+        multiply4x4Scalar(a, b, out);
+    }
+    
+    template <typename T>
+    static T inverse4x4(const T* m, T* out) {
+        return inverse4x4Scalar(m, out);
+    }
+    
+    template <typename T>
+    static void transformPoints(const T* m, const Vector3T<T>* in, size_t count, Vector3T<T>* out) {
+        transformPointsScalar(m, in, count, out);
+    }
+    
+    template <typename T>
+    static void transformPointsToClip(const T* m, const Vector3T<T>* in, size_t count, T* out) {
+        transformPointsToClipScalar(m, in, count, out);
+    }
+    
+    template <typename T>
+    static void transformDirections(const T* m, const Vector3T<T>* in, size_t count, Vector3T<T>* out) {
+        transformDirectionsScalar(m, in, count, out);
+    }
+    
+    static void dot(const Vector3* a, const Vector3* b, size_t count, float* out) {
+        table().dot(a, b, count, out);
+    }
+    
+    static void cross(const Vector3* a, const Vector3* b, size_t count, Vector3* out) {
+        table().cross(a, b, count, out);
+    }
+    
+    static void normalize(const Vector3* in, size_t count, Vector3* out) {
+        table().normalize(in, count, out);
+    }
+    
+    // Twice the signed area of each triangle, positive for counter-clockwise
+    // corners in a y-up frame; x[i] and y[i] hold the x and y coordinates of
+    // triangle i's three corners
+    static void triangleAreas(const Vector3* x, const Vector3* y, size_t count, float* out) {
+        table().triangleAreas(x, y, count, out);
+    }
+};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#elif defined(__clang__) && __clang_major__ >= 13
+#pragma float_control(pop)
+#endif
+
+#endif
\ No newline at end of file
@@ -5,20 +5,45 @@
 #include <iostream>
 #include <stdexcept>
 #include "Vector3.h"
+#include "Vector4.h"
+#include "MathKernels.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-class Matrix4x4 {
+// Converted through double, so float results match float(degrees * M_PI / 180)
+template <typename T>
+T degreesToRadians(T degrees) {
+    return T(static_cast<double>(degrees) * M_PI / 180.0);
+}
+
+// Row-major 4x4 matrix over a scalar type, like Vector3T. Float matrices
+// multiply, invert and transform arrays through the SIMD MathKernels, other
+// scalars through the same kernels' scalar versions. Constant matrices can
+// be built at compile time from the element constructor, translation() and
+// scaling().
+template <typename T>
+class Matrix4x4T {
 public:
-    float m[4][4];
+    T m[4][4];
     
-    Matrix4x4() {
-        identity();
-    }
+    constexpr Matrix4x4T() : m{ { T(1), T(0), T(0), T(0) },
+                                { T(0), T(1), T(0), T(0) },
+                                { T(0), T(0), T(1), T(0) },
+                                { T(0), T(0), T(0), T(1) } } {}
     
-    Matrix4x4(const float values[4][4]) {
+    // Elements in row order
+    constexpr Matrix4x4T(T m00, T m01, T m02, T m03,
+                         T m10, T m11, T m12, T m13,
+                         T m20, T m21, T m22, T m23,
+                         T m30, T m31, T m32, T m33)
+        : m{ { m00, m01, m02, m03 },
+             { m10, m11, m12, m13 },
+             { m20, m21, m22, m23 },
+             { m30, m31, m32, m33 } } {}
+    
+    Matrix4x4T(const T values[4][4]) {
         for (int i = 0; i < 4; i++) {
             for (int j = 0; j < 4; j++) {
                 m[i][j] = values[i][j];
@@ -29,42 +54,50 @@ public:
     void identity() {
         for (int i = 0; i < 4; i++) {
             for (int j = 0; j < 4; j++) {
-                m[i][j] = (i == j) ? 1.0f : 0.0f;
+                m[i][j] = (i == j) ? T(1) : T(0);
             }
         }
     }
     
-    Matrix4x4 operator*(const Matrix4x4& other) const {
-        Matrix4x4 result;
-        for (int i = 0; i < 4; i++) {
-            for (int j = 0; j < 4; j++) {
-                result.m[i][j] = 0;
-                for (int k = 0; k < 4; k++) {
-                    result.m[i][j] += m[i][k] * other.m[k][j];
-                }
-            }
+    // Products of two affine matrices, such as model, view and instance
+    // transforms, skip the known bottom row (MathKernels::multiplyAffine4x4).
+    // For finite inputs every entry equals the general product's, and is
+    // bit-identical to it except that a zero may differ in sign: the skipped
+    // m[i][3] * 0 terms would have turned a -0 sum into +0. Infinities and
+    // NaNs do not spread through those terms either.
+    Matrix4x4T operator*(const Matrix4x4T& other) const {
+        if (isAffine() && other.isAffine()) {
+            return multiplyAffine(other);
         }
+        Matrix4x4T result;
+        MathKernels::multiply4x4(&m[0][0], &other.m[0][0], &result.m[0][0]);
         return result;
     }
     
-    Matrix4x4 transpose() const {
-        Matrix4x4 result;
-        for (int i = 0; i < 4; i++) {
-            for (int j = 0; j < 4; j++) {
-                result.m[i][j] = m[j][i];
-            }
-        }
+    // Product of two affine matrices (see isAffine): 36 multiplies instead
+    // of 64, with the differences from the general product described at
+    // operator*
+    Matrix4x4T multiplyAffine(const Matrix4x4T& other) const {
+        Matrix4x4T result;
+        MathKernels::multiplyAffine4x4(&m[0][0], &other.m[0][0], &result.m[0][0]);
         return result;
     }
     
-    float det3x3(float a, float b, float c,
-                 float d, float e, float f,
-                 float g, float h, float i) const {
+    constexpr Matrix4x4T transpose() const {
+        return Matrix4x4T(m[0][0], m[1][0], m[2][0], m[3][0],
+                          m[0][1], m[1][1], m[2][1], m[3][1],
+                          m[0][2], m[1][2], m[2][2], m[3][2],
+                          m[0][3], m[1][3], m[2][3], m[3][3]);
+    }
+    
+    constexpr T det3x3(T a, T b, T c,
+                       T d, T e, T f,
+                       T g, T h, T i) const {
         return a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
     }
     
-    float determinant() const {
-        float det = 0;
+    T determinant() const {
+        T det = T(0);
         det += m[0][0] * det3x3(m[1][1], m[1][2], m[1][3],
                                 m[2][1], m[2][2], m[2][3],
                                 m[3][1], m[3][2], m[3][3]);
@@ -80,70 +113,145 @@ public:
         return det;
     }
     
-    Matrix4x4 inverse() const {
-        Matrix4x4 result;
-        float det = determinant();
-        
-        if (std::abs(det) < 1e-6f) {
+    // True when the bottom row is exactly 0 0 0 1, as for every model, view
+    // and normal matrix; false for projections
+    constexpr bool isAffine() const {
+        return m[3][0] == T(0) && m[3][1] == T(0) && m[3][2] == T(0) && m[3][3] == T(1);
+    }
+    
+    // Writes the inverse to result and returns true, or returns false and
+    // leaves result alone when the determinant's magnitude is below 1e-6.
+    // Affine matrices take the cheaper affineInverse path.
+    bool tryInverse(Matrix4x4T& result) const {
+        if (isAffine()) {
+            return tryAffineInverse(result);
+        }
+        T inverse[16];
+        T det = MathKernels::inverse4x4(&m[0][0], inverse);
+        if (!invertible(det)) {
+            return false;
+        }
+        for (int i = 0; i < 16; i++) {
+            result.m[i / 4][i % 4] = inverse[i];
+        }
+        return true;
+    }
+    
+    Matrix4x4T inverse() const {
+        Matrix4x4T result;
+        if (!tryInverse(result)) {
             throw std::runtime_error("Matrix is not invertible");
         }
-        
-        float invDet = 1.0f / det;
-        
-        for (int i = 0; i < 4; i++) {
-            for (int j = 0; j < 4; j++) {
-                int sign = ((i + j) % 2 == 0) ? 1 : -1;
-                
-                float submatrix[9];
-                int idx = 0;
-                for (int k = 0; k < 4; k++) {
-                    if (k == i) continue;
-                    for (int l = 0; l < 4; l++) {
-                        if (l == j) continue;
-                        submatrix[idx++] = m[k][l];
-                    }
-                }
-                
-                float cofactor = sign * det3x3(
-                    submatrix[0], submatrix[1], submatrix[2],
-                    submatrix[3], submatrix[4], submatrix[5],
-                    submatrix[6], submatrix[7], submatrix[8]
-                );
-                
-                result.m[j][i] = cofactor * invDet;
+        return result;
+    }
+    
+    // Inverse of an affine matrix: the upper 3x3 inverted through its
+    // cofactors and the translation mapped back through it. The bottom row
+    // is assumed to be 0 0 0 1.
+    bool tryAffineInverse(Matrix4x4T& result) const {
+        T c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+        T c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+        T c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+        T det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+        if (!invertible(det)) {
+            return false;
+        }
+        T invDet = T(1) / det;
+        T r[3][3] = {
+            { c00 * invDet, (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet, (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet },
+            { c01 * invDet, (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet, (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet },
+            { c02 * invDet, (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet, (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet }
+        };
+        T tx = m[0][3], ty = m[1][3], tz = m[2][3];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                result.m[i][j] = r[i][j];
             }
+            result.m[i][3] = -(r[i][0] * tx + r[i][1] * ty + r[i][2] * tz);
+        }
+        result.m[3][0] = T(0);
+        result.m[3][1] = T(0);
+        result.m[3][2] = T(0);
+        result.m[3][3] = T(1);
+        return true;
+    }
+    
+    Matrix4x4T affineInverse() const {
+        Matrix4x4T result;
+        if (!tryAffineInverse(result)) {
+            throw std::runtime_error("Matrix is not invertible");
+        }
+        return result;
+    }
+    
+    // Inverse of a rotation plus translation, such as a view matrix from
+    // lookAt: the transposed rotation and the translation mapped back
+    // through it. Wrong for matrices with scale or shear; never fails.
+    Matrix4x4T rigidInverse() const {
+        Matrix4x4T result;
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                result.m[i][j] = m[j][i];
+            }
+            result.m[i][3] = -(m[0][i] * m[0][3] + m[1][i] * m[1][3] + m[2][i] * m[2][3]);
         }
-        
         return result;
     }
     
-    Vector3 transform(const Vector3& v) const {
-        float x = v.x * m[0][0] + v.y * m[0][1] + v.z * m[0][2] + m[0][3];
-        float y = v.x * m[1][0] + v.y * m[1][1] + v.z * m[1][2] + m[1][3];
-        float z = v.x * m[2][0] + v.y * m[2][1] + v.z * m[2][2] + m[2][3];
-        float w = v.x * m[3][0] + v.y * m[3][1] + v.z * m[3][2] + m[3][3];
+    // The point (v, 1), divided by the resulting w unless that is 0 or 1.
+    // Use the Vector4 overload to keep clip-space w.
+    Vector3T<T> transform(const Vector3T<T>& v) const {
+        T x = v.x * m[0][0] + v.y * m[0][1] + v.z * m[0][2] + m[0][3];
+        T y = v.x * m[1][0] + v.y * m[1][1] + v.z * m[1][2] + m[1][3];
+        T z = v.x * m[2][0] + v.y * m[2][1] + v.z * m[2][2] + m[2][3];
+        T w = v.x * m[3][0] + v.y * m[3][1] + v.z * m[3][2] + m[3][3];
         
-        if (w != 0.0f && w != 1.0f) {
-            return Vector3(x / w, y / w, z / w);
+        if (w != T(0) && w != T(1)) {
+            return Vector3T<T>(x / w, y / w, z / w);
         }
         
-        return Vector3(x, y, z);
+        return Vector3T<T>(x, y, z);
     }
     
-    static Matrix4x4 translation(float tx, float ty, float tz) {
-        Matrix4x4 result;
-        result.m[0][3] = tx;
-        result.m[1][3] = ty;
-        result.m[2][3] = tz;
-        return result;
+    // Full 4x4 product, no divide
+    constexpr Vector4T<T> transform(const Vector4T<T>& v) const {
+        return Vector4T<T>(v.x * m[0][0] + v.y * m[0][1] + v.z * m[0][2] + v.w * m[0][3],
+                           v.x * m[1][0] + v.y * m[1][1] + v.z * m[1][2] + v.w * m[1][3],
+                           v.x * m[2][0] + v.y * m[2][1] + v.z * m[2][2] + v.w * m[2][3],
+                           v.x * m[3][0] + v.y * m[3][1] + v.z * m[3][2] + v.w * m[3][3]);
+    }
+    
+    // Batched transform(Vector4(point)): homogeneous results, no divide
+    void transformPointsToClip(const Vector3T<T>* in, size_t count, Vector4T<T>* out) const {
+        static_assert(sizeof(Vector4T<T>) == 4 * sizeof(T), "Vector4T must be four packed scalars");
+        MathKernels::transformPointsToClip(&m[0][0], in, count, reinterpret_cast<T*>(out));
+    }
+    
+    // Batched transform(): same results, vectorized over the whole array
+    void transformPoints(const Vector3T<T>* in, size_t count, Vector3T<T>* out) const {
+        MathKernels::transformPoints(&m[0][0], in, count, out);
+    }
+    
+    // Upper 3x3 only, for directions and normals under rigid transforms
+    void transformDirections(const Vector3T<T>* in, size_t count, Vector3T<T>* out) const {
+        MathKernels::transformDirections(&m[0][0], in, count, out);
     }
     
-    static Matrix4x4 rotationX(float angleDegrees) {
-        float angleRadians = angleDegrees * M_PI / 180.0f;
-        float c = std::cos(angleRadians);
-        float s = std::sin(angleRadians);
+    static constexpr Matrix4x4T translation(T tx, T ty, T tz) {
+        return Matrix4x4T(T(1), T(0), T(0), tx,
+                          T(0), T(1), T(0), ty,
+                          T(0), T(0), T(1), tz,
+                          T(0), T(0), T(0), T(1));
+    }
+    
+    static Matrix4x4T rotationX(T angleDegrees) {
+        using std::cos;
+        using std::sin;
+        T angleRadians = degreesToRadians(angleDegrees);
+        T c = cos(angleRadians);
+        T s = sin(angleRadians);
         
-        Matrix4x4 result;
+        Matrix4x4T result;
         result.m[1][1] = c;
         result.m[1][2] = -s;
         result.m[2][1] = s;
@@ -151,12 +259,14 @@ public:
         return result;
     }
     
-    static Matrix4x4 rotationY(float angleDegrees) {
-        float angleRadians = angleDegrees * M_PI / 180.0f;
-        float c = std::cos(angleRadians);
-        float s = std::sin(angleRadians);
+    static Matrix4x4T rotationY(T angleDegrees) {
+        using std::cos;
+        using std::sin;
+        T angleRadians = degreesToRadians(angleDegrees);
+        T c = cos(angleRadians);
+        T s = sin(angleRadians);
         
-        Matrix4x4 result;
+        Matrix4x4T result;
         result.m[0][0] = c;
         result.m[0][2] = s;
         result.m[2][0] = -s;
@@ -164,12 +274,14 @@ public:
         return result;
     }
     
-    static Matrix4x4 rotationZ(float angleDegrees) {
-        float angleRadians = angleDegrees * M_PI / 180.0f;
-        float c = std::cos(angleRadians);
-        float s = std::sin(angleRadians);
+    static Matrix4x4T rotationZ(T angleDegrees) {
+        using std::cos;
+        using std::sin;
+        T angleRadians = degreesToRadians(angleDegrees);
+        T c = cos(angleRadians);
+        T s = sin(angleRadians);
         
-        Matrix4x4 result;
+        Matrix4x4T result;
         result.m[0][0] = c;
         result.m[0][1] = -s;
         result.m[1][0] = s;
@@ -177,37 +289,37 @@ public:
         return result;
     }
     
-    static Matrix4x4 scaling(float sx, float sy, float sz) {
-        Matrix4x4 result;
-        result.m[0][0] = sx;
-        result.m[1][1] = sy;
-        result.m[2][2] = sz;
-        return result;
+    static constexpr Matrix4x4T scaling(T sx, T sy, T sz) {
+        return Matrix4x4T(sx, T(0), T(0), T(0),
+                          T(0), sy, T(0), T(0),
+                          T(0), T(0), sz, T(0),
+                          T(0), T(0), T(0), T(1));
     }
     
-    static Matrix4x4 perspective(float fovDegrees, float aspectRatio, float near, float far) {
-        float fovRadians = fovDegrees * M_PI / 180.0f;
-        float f = 1.0f / std::tan(fovRadians / 2.0f);
+    static Matrix4x4T perspective(T fovDegrees, T aspectRatio, T near, T far) {
+        using std::tan;
+        T fovRadians = degreesToRadians(fovDegrees);
+        T f = T(1) / tan(fovRadians / T(2));
         
-        Matrix4x4 result;
+        Matrix4x4T result;
         result.identity();
         
         result.m[0][0] = f / aspectRatio;
         result.m[1][1] = f;
         result.m[2][2] = (far + near) / (near - far);
-        result.m[2][3] = (2.0f * far * near) / (near - far);
-        result.m[3][2] = -1.0f;
-        result.m[3][3] = 0.0f;
+        result.m[2][3] = (T(2) * far * near) / (near - far);
+        result.m[3][2] = T(-1);
+        result.m[3][3] = T(0);
         
         return result;
     }
     
-    static Matrix4x4 lookAt(const Vector3& eye, const Vector3& target, const Vector3& up) {
-        Vector3 forward = (target - eye).normalize();
-        Vector3 right = forward.cross(up).normalize();
-        Vector3 newUp = right.cross(forward);
+    static Matrix4x4T lookAt(const Vector3T<T>& eye, const Vector3T<T>& target, const Vector3T<T>& up) {
+        Vector3T<T> forward = (target - eye).normalize();
+        Vector3T<T> right = forward.cross(up).normalize();
+        Vector3T<T> newUp = right.cross(forward);
         
-        Matrix4x4 result;
+        Matrix4x4T result;
         result.identity();
         
         result.m[0][0] = right.x;
@@ -228,7 +340,7 @@ public:
         return result;
     }
     
-    friend std::ostream& operator<<(std::ostream& os, const Matrix4x4& matrix) {
+    friend std::ostream& operator<<(std::ostream& os, const Matrix4x4T& matrix) {
         for (int i = 0; i < 4; i++) {
             os << "[ ";
             for (int j = 0; j < 4; j++) {
@@ -238,6 +350,17 @@ public:
         }
         return os;
     }
+
+private:
+    // Determinants below 1e-6 in magnitude count as singular. The zero test
+    // matters for scalars like Fixed, where 1e-6 rounds to zero.
+    static bool invertible(T det) {
+        using std::abs;
+        return abs(det) >= T(1e-6f) && det != T(0);
+    }
 };
 
+typedef Matrix4x4T<float> Matrix4x4;
+typedef Matrix4x4T<double> Matrix4x4d;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#ifndef MESH_BUFFERS_H
+#define MESH_BUFFERS_H
+
+// OpenGL from the macOS framework, or Mesa elsewhere
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#include <OpenGL/gl.h>
+#else
+// Buffer object entry points are prototypes only with this on Mesa
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Object3D.h"
+
+// An Object3D uploaded into retained vertex and index buffer objects, so a
+// draw is one glDrawElements call instead of a glBegin/glEnd pair per face.
+// Vertices are interleaved position/normal/texcoord; one index buffer holds
+// the fan-triangulated faces followed by the wireframe edges. update()
+// re-uploads only when the object's revision differs from the uploaded one.
+// Needs a current GL context (buffer objects are core since GL 1.5).
+class MeshBuffers {
+public:
+    struct Vertex {
+        float position[3];
+        float normal[3];
+        float texCoord[2];
+    };
+
+private:
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLsizei triangleIndexCount = 0;
+    GLsizei edgeIndexCount = 0;
+    bool hasNormals = false;
+    bool hasTexCoords = false;
+    uint64_t uploadedRevision = 0;
+    
+    // Staging storage kept between uploads
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    
+    void bindVertexArrays(bool useNormals, bool useTexCoords) const {
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(3, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, position)));
+        if (useNormals) {
+            glEnableClientState(GL_NORMAL_ARRAY);
+            glNormalPointer(GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, normal)));
+        }
+        if (useTexCoords) {
+            glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+            glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, texCoord)));
+        }
+    }
+    
+    static void unbindVertexArrays() {
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisableClientState(GL_NORMAL_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+public:
+    MeshBuffers() {}
+    
+    ~MeshBuffers() {
+        release();
+    }
+    
+    MeshBuffers(const MeshBuffers&) = delete;
+    MeshBuffers& operator=(const MeshBuffers&) = delete;
+    
+    MeshBuffers(MeshBuffers&& other) noexcept {
+        *this = std::move(other);
+    }
+    
+    MeshBuffers& operator=(MeshBuffers&& other) noexcept {
+        if (this != &other) {
+            release();
+            vertexBuffer = other.vertexBuffer;
+            indexBuffer = other.indexBuffer;
+            triangleIndexCount = other.triangleIndexCount;
+            edgeIndexCount = other.edgeIndexCount;
+            hasNormals = other.hasNormals;
+            hasTexCoords = other.hasTexCoords;
+            uploadedRevision = other.uploadedRevision;
+            vertices = std::move(other.vertices);
+            indices = std::move(other.indices);
+            other.vertexBuffer = 0;
+            other.indexBuffer = 0;
+            other.uploadedRevision = 0;
+        }
+        return *this;
+    }
+    
+    // Uploads the object if it changed since the last upload. Returns true
+    // when buffers were (re)written.
+    bool update(const Object3D& object) {
+        if (vertexBuffer != 0 && object.revision == uploadedRevision) return false;
+        
+        size_t vertexCount = object.vertices.size();
+        hasNormals = !object.normals.empty();
+        hasTexCoords = !object.texCoords.empty();
+        
+        // Missing attributes are zero, as if never specified for that vertex
+        vertices.assign(vertexCount, Vertex());
+        for (size_t i = 0; i < vertexCount; i++) {
+            Vertex& vertex = vertices[i];
+            const Vector3& p = object.vertices[i];
+            vertex.position[0] = p.x;
+            vertex.position[1] = p.y;
+            vertex.position[2] = p.z;
+            if (i < object.normals.size()) {
+                const Vector3& n = object.normals[i];
+                vertex.normal[0] = n.x;
+                vertex.normal[1] = n.y;
+                vertex.normal[2] = n.z;
+            }
+            if (i < object.texCoords.size()) {
+                vertex.texCoord[0] = object.texCoords[i].first;
+                vertex.texCoord[1] = object.texCoords[i].second;
+            }
+        }
+        
+        indices.clear();
+        for (const auto& face : object.faces) {
+            for (size_t i = 1; i + 1 < face.size(); i++) {
+                indices.push_back(static_cast<uint32_t>(face[0]));
+                indices.push_back(static_cast<uint32_t>(face[i]));
+                indices.push_back(static_cast<uint32_t>(face[i + 1]));
+            }
+        }
+        triangleIndexCount = static_cast<GLsizei>(indices.size());
+        for (const auto& edge : object.edges) {
+            indices.push_back(static_cast<uint32_t>(edge.first));
+            indices.push_back(static_cast<uint32_t>(edge.second));
+        }
+        edgeIndexCount = static_cast<GLsizei>(indices.size()) - triangleIndexCount;
+        
+        if (vertexBuffer == 0) glGenBuffers(1, &vertexBuffer);
+        if (indexBuffer == 0) glGenBuffers(1, &indexBuffer);
+        
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        
+        uploadedRevision = object.revision;
+        return true;
+    }
+    
+    // Filled faces; normals and texture coordinates are sent only when asked
+    // for and present
+    void drawTriangles(bool useNormals, bool useTexCoords) const {
+        if (triangleIndexCount == 0) return;
+        bindVertexArrays(useNormals && hasNormals, useTexCoords && hasTexCoords);
+        glDrawElements(GL_TRIANGLES, triangleIndexCount, GL_UNSIGNED_INT, nullptr);
+        unbindVertexArrays();
+    }
+    
+    void drawEdges() const {
+        if (edgeIndexCount == 0) return;
+        bindVertexArrays(false, false);
+        glDrawElements(GL_LINES, edgeIndexCount, GL_UNSIGNED_INT,
+                       reinterpret_cast<const void*>(triangleIndexCount * sizeof(uint32_t)));
+        unbindVertexArrays();
+    }
+    
+    void release() {
+        if (vertexBuffer != 0) glDeleteBuffers(1, &vertexBuffer);
+        if (indexBuffer != 0) glDeleteBuffers(1, &indexBuffer);
+        vertexBuffer = 0;
+        indexBuffer = 0;
+        uploadedRevision = 0;
+    }
+    
+    GLsizei triangleCount() const {
+        return triangleIndexCount / 3;
+    }
+    
+    GLsizei edgeCount() const {
+        return edgeIndexCount / 2;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,451 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Vector3.h"
+#include "Object3D.h"
+#include "IndexedMesh.h"
+#include "MappedFile.h"
+#include "MeshLoader.h"
+#include "ThreadPool.h"
+
+// Binary cache of an imported mesh. The file is a fixed header followed by
+// 64-byte aligned sections (positions, normals, texture coordinates,
+// triangle indices, polygon offsets, edges) laid out exactly as they are
+// used in memory, so an opened cache is read in place from the mapping
+// without any deserialization.
+//
+// MeshCache::load(source) imports a mesh through the cache: "model.obj" is
+// cached next to the source as "model.obj.meshcache". The cache is rebuilt
+// when the source's size or content hash no longer matches, or when it was
+// written by a different format version.
+//
+// VERSION must be bumped whenever the file layout or what MeshLoader
+// produces for a given source changes (normal weighting, edge extraction,
+// ...): the fast path trusts any cache with the source's size and time, so
+// only a version mismatch retires caches holding the old loader's output.
+class MeshCache {
+public:
+    // 2: edges extracted from faces, angle-weighted normals
+    static const uint32_t VERSION = 2;
+    static const size_t ALIGNMENT = 64;
+    
+    enum Section { POSITIONS, NORMALS, TEX_COORDS, INDICES, POLYGON_OFFSETS, EDGES, SECTION_COUNT };
+    
+    struct SectionEntry {
+        uint64_t offset;
+        uint64_t bytes;
+    };
+    
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t fileSize;
+        
+        // Source the cache was built from
+        uint64_t sourceSize;
+        int64_t sourceModifiedAt;
+        uint64_t sourceHash;
+        
+        uint64_t vertexCount;
+        uint64_t indexCount;
+        uint64_t polygonOffsetCount;
+        uint64_t edgeCount;
+        uint32_t hasNormals;
+        uint32_t hasTexCoords;
+        float boundsMin[3];
+        float boundsMax[3];
+        float color[3];
+        uint32_t reserved;
+        
+        SectionEntry sections[SECTION_COUNT];
+    };
+    
+    // Identifies the source file a cache belongs to
+    struct SourceInfo {
+        uint64_t size;
+        int64_t modifiedAt;
+        uint64_t hash;
+        
+        SourceInfo() : size(0), modifiedAt(0), hash(0) {}
+    };
+
+private:
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+    
+    MappedFile file;
+    std::vector<uint64_t> ownedImage;
+    const char* base = nullptr;
+    size_t imageSize = 0;
+    
+    template <typename T>
+    const T* section(Section s) const {
+        const SectionEntry& entry = header().sections[s];
+        return entry.bytes == 0 ? nullptr : reinterpret_cast<const T*>(base + entry.offset);
+    }
+    
+    static size_t alignUp(size_t value) {
+        return (value + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+    
+    static uint64_t mix(uint64_t h, uint64_t value) {
+        h ^= value;
+        h *= 0x9E3779B97F4A7C15ull;
+        return h ^ (h >> 29);
+    }
+    
+    // Checks the header and section table; the payload itself is trusted
+    static bool isValidImage(const char* data, size_t size) {
+        if (size < sizeof(Header)) return false;
+        const Header* h = reinterpret_cast<const Header*>(data);
+        if (std::memcmp(h->magic, "MESHCACH", 8) != 0 || h->version != VERSION ||
+            h->byteOrder != BYTE_ORDER_MARK || h->fileSize != size) {
+            return false;
+        }
+        
+        const uint64_t expected[SECTION_COUNT] = {
+            h->vertexCount * sizeof(Vector3),
+            h->hasNormals ? h->vertexCount * sizeof(Vector3) : 0,
+            h->hasTexCoords ? h->vertexCount * 2 * sizeof(float) : 0,
+            h->indexCount * sizeof(uint32_t),
+            h->polygonOffsetCount * sizeof(uint32_t),
+            h->edgeCount * 2 * sizeof(uint32_t)
+        };
+        for (int s = 0; s < SECTION_COUNT; s++) {
+            const SectionEntry& entry = h->sections[s];
+            if (entry.bytes != expected[s] || entry.offset % ALIGNMENT != 0 ||
+                entry.offset > size || entry.bytes > size - entry.offset) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    void attach(const char* data, size_t size) {
+        base = data;
+        imageSize = size;
+    }
+
+public:
+    static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 must be three packed floats");
+    
+    MeshCache() {}
+    
+    // Hash of the file content, computed in 1 MB blocks on the pool
+    static uint64_t hashBytes(const char* data, size_t size, ThreadPool& pool = ThreadPool::shared()) {
+        const size_t blockSize = 1 << 20;
+        size_t blocks = (size + blockSize - 1) / blockSize;
+        std::vector<uint64_t> blockHashes(blocks);
+        
+        pool.parallelFor(blocks, [&](size_t b) {
+            const char* p = data + b * blockSize;
+            size_t length = std::min(blockSize, size - b * blockSize);
+            uint64_t h = 0xCBF29CE484222325ull ^ b;
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8) {
+                uint64_t word;
+                std::memcpy(&word, p + i, 8);
+                h = mix(h, word);
+            }
+            uint64_t tail = 0;
+            std::memcpy(&tail, p + i, length - i);
+            blockHashes[b] = mix(h, tail ^ (static_cast<uint64_t>(length - i) << 56));
+        });
+        
+        uint64_t h = mix(0, size);
+        for (uint64_t blockHash : blockHashes) h = mix(h, blockHash);
+        return h;
+    }
+    
+    static SourceInfo describeSource(const MappedFile& source, ThreadPool& pool = ThreadPool::shared()) {
+        SourceInfo info;
+        info.size = source.size();
+        info.modifiedAt = source.modifiedAt();
+        info.hash = hashBytes(source.data(), source.size(), pool);
+        return info;
+    }
+    
+    static std::string cachePathFor(const std::string& sourcePath) {
+        return sourcePath + ".meshcache";
+    }
+    
+    // Serializes an object into a cache image (8-byte aligned storage)
+    static std::vector<uint64_t> buildImage(const Object3D& object, const SourceInfo& source) {
+        IndexedMesh mesh = IndexedMesh::fromObject3D(object, true);
+        
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "MESHCACH", 8);
+        header.version = VERSION;
+        header.byteOrder = BYTE_ORDER_MARK;
+        header.sourceSize = source.size;
+        header.sourceModifiedAt = source.modifiedAt;
+        header.sourceHash = source.hash;
+        header.vertexCount = object.vertices.size();
+        header.indexCount = mesh.indices.size();
+        header.polygonOffsetCount = mesh.polygonOffsets.size();
+        header.edgeCount = object.edges.size();
+        header.hasNormals = mesh.hasNormals;
+        header.hasTexCoords = mesh.hasTexCoords;
+        for (int i = 0; i < 3; i++) header.color[i] = object.color[i];
+        
+        Vector3 boundsMin, boundsMax;
+        if (!object.vertices.empty()) {
+            boundsMin = boundsMax = object.vertices[0];
+            for (const auto& v : object.vertices) {
+                boundsMin = Vector3(std::min(boundsMin.x, v.x), std::min(boundsMin.y, v.y), std::min(boundsMin.z, v.z));
+                boundsMax = Vector3(std::max(boundsMax.x, v.x), std::max(boundsMax.y, v.y), std::max(boundsMax.z, v.z));
+            }
+        }
+        std::memcpy(header.boundsMin, &boundsMin, sizeof(header.boundsMin));
+        std::memcpy(header.boundsMax, &boundsMax, sizeof(header.boundsMax));
+        
+        const uint64_t bytes[SECTION_COUNT] = {
+            header.vertexCount * sizeof(Vector3),
+            header.hasNormals ? header.vertexCount * sizeof(Vector3) : 0,
+            header.hasTexCoords ? header.vertexCount * 2 * sizeof(float) : 0,
+            header.indexCount * sizeof(uint32_t),
+            header.polygonOffsetCount * sizeof(uint32_t),
+            header.edgeCount * 2 * sizeof(uint32_t)
+        };
+        size_t offset = alignUp(sizeof(Header));
+        for (int s = 0; s < SECTION_COUNT; s++) {
+            header.sections[s].offset = offset;
+            header.sections[s].bytes = bytes[s];
+            offset = alignUp(offset + bytes[s]);
+        }
+        header.fileSize = offset;
+        
+        std::vector<uint64_t> image(offset / sizeof(uint64_t), 0);
+        char* out = reinterpret_cast<char*>(image.data());
+        std::memcpy(out, &header, sizeof(header));
+        
+        if (!object.vertices.empty()) {
+            std::memcpy(out + header.sections[POSITIONS].offset, object.vertices.data(), bytes[POSITIONS]);
+        }
+        if (header.hasNormals) {
+            std::memcpy(out + header.sections[NORMALS].offset, object.normals.data(), bytes[NORMALS]);
+        }
+        if (header.hasTexCoords) {
+            float* texCoords = reinterpret_cast<float*>(out + header.sections[TEX_COORDS].offset);
+            for (size_t i = 0; i < object.texCoords.size(); i++) {
+                texCoords[i * 2] = object.texCoords[i].first;
+                texCoords[i * 2 + 1] = object.texCoords[i].second;
+            }
+        }
+        if (!mesh.indices.empty()) {
+            std::memcpy(out + header.sections[INDICES].offset, mesh.indices.data(), bytes[INDICES]);
+        }
+        if (!mesh.polygonOffsets.empty()) {
+            std::memcpy(out + header.sections[POLYGON_OFFSETS].offset, mesh.polygonOffsets.data(), bytes[POLYGON_OFFSETS]);
+        }
+        if (!mesh.edgeIndices.empty()) {
+            std::memcpy(out + header.sections[EDGES].offset, mesh.edgeIndices.data(), bytes[EDGES]);
+        }
+        return image;
+    }
+    
+    // Writes through a temporary file and a rename, so readers never see a
+    // partially written cache
+    static void writeImage(const std::vector<uint64_t>& image, const std::string& cachePath) {
+        std::string temporaryPath = cachePath + ".tmp";
+        FILE* out = std::fopen(temporaryPath.c_str(), "wb");
+        if (out == nullptr) {
+            throw std::runtime_error("Cannot write mesh cache: " + cachePath);
+        }
+        size_t bytes = image.size() * sizeof(uint64_t);
+        bool written = std::fwrite(image.data(), 1, bytes, out) == bytes;
+        written = std::fclose(out) == 0 && written;
+        if (!written || std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+            std::remove(temporaryPath.c_str());
+            throw std::runtime_error("Cannot write mesh cache: " + cachePath);
+        }
+    }
+    
+    static void write(const Object3D& object, const std::string& cachePath, const SourceInfo& source = SourceInfo()) {
+        writeImage(buildImage(object, source), cachePath);
+    }
+    
+    // Records a new source modification time in an existing cache's header,
+    // in place: a torn or failed write only costs the next load a rehash
+    static bool writeSourceModifiedAt(const std::string& cachePath, int64_t modifiedAt) {
+        FILE* out = std::fopen(cachePath.c_str(), "r+b");
+        if (out == nullptr) return false;
+        bool written = std::fseek(out, static_cast<long>(offsetof(Header, sourceModifiedAt)), SEEK_SET) == 0 &&
+                       std::fwrite(&modifiedAt, sizeof(modifiedAt), 1, out) == 1;
+        return std::fclose(out) == 0 && written;
+    }
+    
+    // Maps an existing cache file. Throws if it is missing or not a valid
+    // cache of this version.
+    static MeshCache open(const std::string& cachePath) {
+        MeshCache cache;
+        cache.file = MappedFile(cachePath);
+        if (!isValidImage(cache.file.data(), cache.file.size())) {
+            throw std::runtime_error("Invalid or outdated mesh cache: " + cachePath);
+        }
+        cache.attach(cache.file.data(), cache.file.size());
+        return cache;
+    }
+    
+    // Wraps an in-memory image, e.g. when the cache could not be written
+    static MeshCache fromImage(std::vector<uint64_t> image) {
+        MeshCache cache;
+        cache.ownedImage = std::move(image);
+        const char* data = reinterpret_cast<const char*>(cache.ownedImage.data());
+        size_t size = cache.ownedImage.size() * sizeof(uint64_t);
+        if (!isValidImage(data, size)) {
+            throw std::runtime_error("Invalid mesh cache image");
+        }
+        cache.attach(data, size);
+        return cache;
+    }
+    
+    // Imports a mesh file through its cache. A cache whose recorded size and
+    // modification time match the source is used without reading the
+    // source; otherwise the source is hashed and the cache is reused if the
+    // content is unchanged, with its recorded time updated so the next load
+    // takes the fast path again, or rebuilt and rewritten if it is not. When
+    // the cache cannot be written the freshly built image is used from memory.
+    static MeshCache load(const std::string& sourcePath, ThreadPool& pool = ThreadPool::shared()) {
+        std::string cachePath = cachePathFor(sourcePath);
+        MappedFile source(sourcePath);
+        
+        MeshCache cache;
+        bool haveCache = false;
+        try {
+            cache = open(cachePath);
+            haveCache = cache.header().sourceSize == source.size();
+        } catch (const std::runtime_error&) {
+        }
+        if (haveCache && cache.header().sourceModifiedAt == source.modifiedAt()) {
+            return cache;
+        }
+        
+        SourceInfo info = describeSource(source, pool);
+        if (haveCache && cache.header().sourceHash == info.hash) {
+            writeSourceModifiedAt(cachePath, info.modifiedAt);
+            return cache;
+        }
+        
+        std::vector<uint64_t> image = buildImage(MeshLoader::load(sourcePath, pool), info);
+        try {
+            writeImage(image, cachePath);
+        } catch (const std::runtime_error&) {
+        }
+        return fromImage(std::move(image));
+    }
+    
+    bool isMapped() const {
+        return file.data() != nullptr;
+    }
+    
+    const Header& header() const {
+        return *reinterpret_cast<const Header*>(base);
+    }
+    
+    size_t sizeBytes() const {
+        return imageSize;
+    }
+    
+    size_t vertexCount() const {
+        return static_cast<size_t>(header().vertexCount);
+    }
+    
+    size_t triangleCount() const {
+        return static_cast<size_t>(header().indexCount / 3);
+    }
+    
+    size_t edgeCount() const {
+        return static_cast<size_t>(header().edgeCount);
+    }
+    
+    bool hasNormals() const {
+        return header().hasNormals != 0;
+    }
+    
+    bool hasTexCoords() const {
+        return header().hasTexCoords != 0;
+    }
+    
+    Vector3 boundsMin() const {
+        return Vector3(header().boundsMin[0], header().boundsMin[1], header().boundsMin[2]);
+    }
+    
+    Vector3 boundsMax() const {
+        return Vector3(header().boundsMax[0], header().boundsMax[1], header().boundsMax[2]);
+    }
+    
+    // Views into the cache; valid as long as this object lives
+    const Vector3* positions() const { return section<Vector3>(POSITIONS); }
+    const Vector3* normals() const { return section<Vector3>(NORMALS); }
+    const float* texCoords() const { return section<float>(TEX_COORDS); }
+    const uint32_t* indices() const { return section<uint32_t>(INDICES); }
+    const uint32_t* polygonOffsets() const { return section<uint32_t>(POLYGON_OFFSETS); }
+    const uint32_t* edgeIndices() const { return section<uint32_t>(EDGES); }
+    
+    size_t indexCount() const {
+        return static_cast<size_t>(header().indexCount);
+    }
+    
+    size_t polygonOffsetCount() const {
+        return static_cast<size_t>(header().polygonOffsetCount);
+    }
+    
+    // Copies the cached mesh into an Object3D, restoring the original polygons
+    Object3D toObject3D() const {
+        Object3D object;
+        object.color = { header().color[0], header().color[1], header().color[2] };
+        
+        size_t count = vertexCount();
+        if (count > 0) object.vertices.assign(positions(), positions() + count);
+        if (hasNormals()) object.normals.assign(normals(), normals() + count);
+        if (hasTexCoords()) {
+            const float* uv = texCoords();
+            object.texCoords.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                object.texCoords[i] = std::make_pair(uv[i * 2], uv[i * 2 + 1]);
+            }
+        }
+        
+        const uint32_t* triangles = indices();
+        const uint32_t* offsets = polygonOffsets();
+        size_t polygons = polygonOffsetCount() > 0 ? polygonOffsetCount() - 1 : 0;
+        object.faces.reserve(polygons);
+        for (size_t p = 0; p < polygons; p++) {
+            uint32_t first = offsets[p];
+            uint32_t last = offsets[p + 1];
+            if (first == last) continue;
+            
+            // Fan triangles share corner 0; each one adds a single new vertex
+            std::vector<int> face;
+            face.reserve(last - first + 2);
+            face.push_back(static_cast<int>(triangles[first * 3]));
+            face.push_back(static_cast<int>(triangles[first * 3 + 1]));
+            for (uint32_t t = first; t < last; t++) {
+                face.push_back(static_cast<int>(triangles[t * 3 + 2]));
+            }
+            object.faces.push_back(face);
+        }
+        
+        const uint32_t* edges = edgeIndices();
+        object.edges.reserve(edgeCount());
+        for (size_t e = 0; e < edgeCount(); e++) {
+            object.edges.push_back({ static_cast<int>(edges[e * 2]), static_cast<int>(edges[e * 2 + 1]) });
+        }
+        object.markModified();
+        return object;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,931 @@
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Vector3.h"
+#include "Object3D.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "EdgeExtractor.h"
+
+// Loads OBJ, STL (ASCII and binary) and PLY (ASCII and binary) files into
+// Object3D. The file is memory-mapped and cut into chunks that are parsed
+// on the thread pool: a first pass counts the elements of every chunk, a
+// second pass parses each chunk straight into its slice of the output
+// arrays. Text is parsed by hand, without iostreams or locale lookups.
+// Wireframe edges are extracted from the faces. Throws std::runtime_error on unreadable or
+// malformed files.
+class MeshLoader {
+private:
+    static const size_t MIN_CHUNK_BYTES = 256 * 1024;
+    
+    // ---- Text parsing ----
+    
+    static bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+    
+    static bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+    
+    static const char* skipSpaces(const char* p, const char* end) {
+        while (p < end && isSpace(*p)) p++;
+        return p;
+    }
+    
+    static const char* skipToken(const char* p, const char* end) {
+        while (p < end && !isSpace(*p) && *p != '\n') p++;
+        return p;
+    }
+    
+    static const char* lineEnd(const char* p, const char* end) {
+        const void* newline = std::memchr(p, '\n', end - p);
+        return newline ? static_cast<const char*>(newline) : end;
+    }
+    
+    static bool startsWith(const char* p, const char* end, const char* word) {
+        size_t length = std::strlen(word);
+        return static_cast<size_t>(end - p) >= length && std::memcmp(p, word, length) == 0;
+    }
+    
+    // Decimal float with optional sign, fraction and exponent. Up to 19
+    // significant digits are accumulated exactly and scaled once by an exact
+    // power of ten, which is correctly rounded for typical mesh data.
+    static bool parseFloat(const char*& p, const char* end, float& out) {
+        static const double powersOfTen[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        
+        const char* s = skipSpaces(p, end);
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+')) {
+            negative = *s == '-';
+            s++;
+        }
+        
+        uint64_t mantissa = 0;
+        int significantDigits = 0;
+        int exponent = 0;
+        bool anyDigits = false;
+        
+        for (; s < end && isDigit(*s); s++) {
+            anyDigits = true;
+            if (significantDigits < 19) {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa != 0) significantDigits++;
+            } else {
+                exponent++;
+            }
+        }
+        if (s < end && *s == '.') {
+            s++;
+            for (; s < end && isDigit(*s); s++) {
+                anyDigits = true;
+                if (significantDigits < 19) {
+                    mantissa = mantissa * 10 + (*s - '0');
+                    if (mantissa != 0) significantDigits++;
+                    exponent--;
+                }
+            }
+        }
+        if (!anyDigits) {
+            if (startsWith(s, end, "inf") || startsWith(s, end, "nan")) {
+                out = startsWith(s, end, "inf") ? (negative ? -INFINITY : INFINITY) : NAN;
+                p = skipToken(s, end);
+                return true;
+            }
+            return false;
+        }
+        
+        if (s < end && (*s == 'e' || *s == 'E')) {
+            const char* e = s + 1;
+            bool negativeExponent = false;
+            if (e < end && (*e == '-' || *e == '+')) {
+                negativeExponent = *e == '-';
+                e++;
+            }
+            if (e < end && isDigit(*e)) {
+                int value = 0;
+                for (; e < end && isDigit(*e); e++) {
+                    if (value < 100000) value = value * 10 + (*e - '0');
+                }
+                exponent += negativeExponent ? -value : value;
+                s = e;
+            }
+        }
+        
+        double value = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            value = exponent >= -22 ? value / powersOfTen[-exponent] : value * std::pow(10.0, exponent);
+        } else if (exponent > 0) {
+            value = exponent <= 22 ? value * powersOfTen[exponent] : value * std::pow(10.0, exponent);
+        }
+        
+        out = static_cast<float>(negative ? -value : value);
+        p = s;
+        return true;
+    }
+    
+    static bool parseInt(const char*& p, const char* end, long& out) {
+        const char* s = skipSpaces(p, end);
+        bool negative = false;
+        if (s < end && (*s == '-' || *s == '+')) {
+            negative = *s == '-';
+            s++;
+        }
+        if (s >= end || !isDigit(*s)) return false;
+        
+        // Values beyond long are malformed rather than overflowing
+        const long limit = std::numeric_limits<long>::max();
+        long value = 0;
+        for (; s < end && isDigit(*s); s++) {
+            int digit = *s - '0';
+            if (value > (limit - digit) / 10) return false;
+            value = value * 10 + digit;
+        }
+        out = negative ? -value : value;
+        p = s;
+        return true;
+    }
+    
+    // Splits text into about `parts` ranges that each end after a newline
+    static std::vector<std::pair<const char*, const char*>> splitLines(const char* begin, const char* end, size_t parts) {
+        std::vector<std::pair<const char*, const char*>> ranges;
+        size_t size = end - begin;
+        parts = std::max<size_t>(1, std::min(parts, size / MIN_CHUNK_BYTES + 1));
+        
+        const char* start = begin;
+        for (size_t i = 1; i <= parts && start < end; i++) {
+            const char* stop = i == parts ? end : begin + size * i / parts;
+            if (stop < start) stop = start;
+            if (stop < end) {
+                stop = lineEnd(stop, end);
+                if (stop < end) stop++;
+            }
+            if (stop > start) ranges.push_back(std::make_pair(start, stop));
+            start = stop;
+        }
+        return ranges;
+    }
+    
+    static size_t chunkCountFor(ThreadPool& pool) {
+        return pool.size() * 4;
+    }
+    
+    static void throwFirstError(const std::vector<std::string>& errors, const std::string& path) {
+        for (const auto& error : errors) {
+            if (!error.empty()) throw std::runtime_error(path + ": " + error);
+        }
+    }
+    
+    static Vector3 triangleNormal(const Vector3& a, const Vector3& b, const Vector3& c) {
+        return (b - a).cross(c - a).normalize();
+    }
+    
+    // ---- OBJ ----
+    
+    struct ObjChunk {
+        const char* begin;
+        const char* end;
+        size_t positions = 0;
+        size_t texCoords = 0;
+        size_t normals = 0;
+        size_t faces = 0;
+        size_t corners = 0;
+    };
+    
+    static void countObjChunk(ObjChunk& chunk) {
+        const char* p = chunk.begin;
+        while (p < chunk.end) {
+            const char* stop = lineEnd(p, chunk.end);
+            const char* s = skipSpaces(p, stop);
+            if (s + 1 < stop && s[0] == 'v') {
+                if (isSpace(s[1])) chunk.positions++;
+                else if (s[1] == 't' && s + 2 < stop && isSpace(s[2])) chunk.texCoords++;
+                else if (s[1] == 'n' && s + 2 < stop && isSpace(s[2])) chunk.normals++;
+            } else if (s + 1 < stop && s[0] == 'f' && isSpace(s[1])) {
+                chunk.faces++;
+                for (s = skipSpaces(s + 1, stop); s < stop; s = skipSpaces(skipToken(s, stop), stop)) {
+                    chunk.corners++;
+                }
+            }
+            p = stop + 1;
+        }
+    }
+    
+    // Resolves a 1-based or negative (relative) OBJ index to a 0-based one
+    static bool resolveObjIndex(long index, size_t seen, size_t total, long& out) {
+        if (index > 0) out = index - 1;
+        else if (index < 0) out = static_cast<long>(seen) + index;
+        else return false;
+        return out >= 0 && static_cast<size_t>(out) < total;
+    }
+    
+    struct ObjTotals {
+        size_t positions;
+        size_t texCoords;
+        size_t normals;
+    };
+    
+    // Parses one chunk into the output slices that start at the chunk's
+    // offsets (stored in `base`). Returns an error message or "".
+    static std::string parseObjChunk(const ObjChunk& chunk, const ObjChunk& base, const ObjTotals& totals,
+                                     Object3D& object,
+                                     std::vector<std::pair<float, float>>& texPool,
+                                     std::vector<Vector3>& normalPool,
+                                     std::vector<int>& cornerTex,
+                                     std::vector<int>& cornerNormal) {
+        size_t position = base.positions;
+        size_t tex = base.texCoords;
+        size_t normal = base.normals;
+        size_t face = base.faces;
+        size_t corner = base.corners;
+        std::vector<int> indices;
+        
+        const char* p = chunk.begin;
+        while (p < chunk.end) {
+            const char* stop = lineEnd(p, chunk.end);
+            const char* s = skipSpaces(p, stop);
+            
+            if (s + 1 < stop && s[0] == 'v' && isSpace(s[1])) {
+                Vector3& v = object.vertices[position++];
+                s += 2;
+                if (!parseFloat(s, stop, v.x) || !parseFloat(s, stop, v.y) || !parseFloat(s, stop, v.z)) {
+                    return "malformed vertex position";
+                }
+            } else if (s + 2 < stop && s[0] == 'v' && s[1] == 't' && isSpace(s[2])) {
+                std::pair<float, float>& t = texPool[tex++];
+                s += 3;
+                if (!parseFloat(s, stop, t.first)) return "malformed texture coordinate";
+                if (!parseFloat(s, stop, t.second)) t.second = 0.0f;
+            } else if (s + 2 < stop && s[0] == 'v' && s[1] == 'n' && isSpace(s[2])) {
+                Vector3& n = normalPool[normal++];
+                s += 3;
+                if (!parseFloat(s, stop, n.x) || !parseFloat(s, stop, n.y) || !parseFloat(s, stop, n.z)) {
+                    return "malformed vertex normal";
+                }
+            } else if (s + 1 < stop && s[0] == 'f' && isSpace(s[1])) {
+                indices.clear();
+                for (s = skipSpaces(s + 1, stop); s < stop; s = skipSpaces(s, stop)) {
+                    long value, resolved;
+                    if (!parseInt(s, stop, value) || !resolveObjIndex(value, position, totals.positions, resolved)) {
+                        return "invalid face vertex index";
+                    }
+                    indices.push_back(static_cast<int>(resolved));
+                    
+                    int texIndex = -1;
+                    int normalIndex = -1;
+                    if (s < stop && *s == '/') {
+                        s++;
+                        if (s < stop && *s != '/') {
+                            if (!parseInt(s, stop, value) || !resolveObjIndex(value, tex, totals.texCoords, resolved)) {
+                                return "invalid face texture coordinate index";
+                            }
+                            texIndex = static_cast<int>(resolved);
+                        }
+                        if (s < stop && *s == '/') {
+                            s++;
+                            if (!parseInt(s, stop, value) || !resolveObjIndex(value, normal, totals.normals, resolved)) {
+                                return "invalid face normal index";
+                            }
+                            normalIndex = static_cast<int>(resolved);
+                        }
+                    }
+                    if (!cornerTex.empty()) cornerTex[corner] = texIndex;
+                    if (!cornerNormal.empty()) cornerNormal[corner] = normalIndex;
+                    corner++;
+                    s = skipToken(s, stop);
+                }
+                object.faces[face++] = indices;
+            }
+            p = stop + 1;
+        }
+        return "";
+    }
+    
+    // ---- STL ----
+    
+    static bool isBinaryStl(const char* data, size_t size) {
+        if (size < 84) return false;
+        uint32_t triangles;
+        std::memcpy(&triangles, data + 80, sizeof(triangles));
+        return size == 84 + static_cast<size_t>(triangles) * 50;
+    }
+    
+    // STL has no shared vertices: every facet keeps its own three vertices so
+    // the flat facet normals survive
+    static Object3D parseBinaryStl(const char* data, ThreadPool& pool) {
+        uint32_t triangles;
+        std::memcpy(&triangles, data + 80, sizeof(triangles));
+        
+        Object3D object;
+        object.vertices.resize(static_cast<size_t>(triangles) * 3);
+        object.normals.resize(static_cast<size_t>(triangles) * 3);
+        object.faces.resize(triangles);
+        
+        pool.parallelForRange(triangles, 4096, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; t++) {
+                float values[12];
+                std::memcpy(values, data + 84 + t * 50, sizeof(values));
+                
+                Vector3* v = &object.vertices[t * 3];
+                v[0] = Vector3(values[3], values[4], values[5]);
+                v[1] = Vector3(values[6], values[7], values[8]);
+                v[2] = Vector3(values[9], values[10], values[11]);
+                
+                Vector3 normal(values[0], values[1], values[2]);
+                if (normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f) {
+                    normal = triangleNormal(v[0], v[1], v[2]);
+                }
+                Vector3* n = &object.normals[t * 3];
+                n[0] = n[1] = n[2] = normal;
+                
+                int first = static_cast<int>(t * 3);
+                object.faces[t] = { first, first + 1, first + 2 };
+            }
+        });
+        EdgeExtractor::extract(object.vertices, object.faces, object.edges, nullptr, 30.0f, pool);
+        object.markModified();
+        return object;
+    }
+    
+    static Object3D parseAsciiStl(const char* data, size_t size, ThreadPool& pool, const std::string& path) {
+        std::vector<std::pair<const char*, const char*>> ranges = splitLines(data, data + size, chunkCountFor(pool));
+        std::vector<size_t> counts(ranges.size(), 0);
+        
+        pool.parallelFor(ranges.size(), [&](size_t c) {
+            for (const char* p = ranges[c].first; p < ranges[c].second; ) {
+                const char* stop = lineEnd(p, ranges[c].second);
+                if (startsWith(skipSpaces(p, stop), stop, "vertex")) counts[c]++;
+                p = stop + 1;
+            }
+        });
+        
+        std::vector<size_t> offsets(ranges.size() + 1, 0);
+        for (size_t c = 0; c < ranges.size(); c++) offsets[c + 1] = offsets[c] + counts[c];
+        if (offsets.back() % 3 != 0) {
+            throw std::runtime_error(path + ": vertex count is not a multiple of three");
+        }
+        
+        Object3D object;
+        object.vertices.resize(offsets.back());
+        std::vector<std::string> errors(ranges.size());
+        
+        pool.parallelFor(ranges.size(), [&](size_t c) {
+            size_t vertex = offsets[c];
+            for (const char* p = ranges[c].first; p < ranges[c].second; ) {
+                const char* stop = lineEnd(p, ranges[c].second);
+                const char* s = skipSpaces(p, stop);
+                if (startsWith(s, stop, "vertex")) {
+                    s += 6;
+                    Vector3& v = object.vertices[vertex++];
+                    if (!parseFloat(s, stop, v.x) || !parseFloat(s, stop, v.y) || !parseFloat(s, stop, v.z)) {
+                        errors[c] = "malformed vertex";
+                        return;
+                    }
+                }
+                p = stop + 1;
+            }
+        });
+        throwFirstError(errors, path);
+        
+        size_t triangles = object.vertices.size() / 3;
+        object.normals.resize(object.vertices.size());
+        object.faces.resize(triangles);
+        pool.parallelForRange(triangles, 4096, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; t++) {
+                const Vector3* v = &object.vertices[t * 3];
+                Vector3 normal = triangleNormal(v[0], v[1], v[2]);
+                object.normals[t * 3] = object.normals[t * 3 + 1] = object.normals[t * 3 + 2] = normal;
+                int first = static_cast<int>(t * 3);
+                object.faces[t] = { first, first + 1, first + 2 };
+            }
+        });
+        EdgeExtractor::extract(object.vertices, object.faces, object.edges, nullptr, 30.0f, pool);
+        object.markModified();
+        return object;
+    }
+    
+    // ---- PLY ----
+    
+    enum PlyType { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_INVALID };
+    
+    struct PlyProperty {
+        std::string name;
+        PlyType type = PLY_INVALID;
+        bool isList = false;
+        PlyType countType = PLY_INVALID;
+    };
+    
+    struct PlyElement {
+        std::string name;
+        size_t count = 0;
+        std::vector<PlyProperty> properties;
+    };
+    
+    static PlyType plyTypeFromName(const std::string& name) {
+        if (name == "char" || name == "int8") return PLY_INT8;
+        if (name == "uchar" || name == "uint8") return PLY_UINT8;
+        if (name == "short" || name == "int16") return PLY_INT16;
+        if (name == "ushort" || name == "uint16") return PLY_UINT16;
+        if (name == "int" || name == "int32") return PLY_INT32;
+        if (name == "uint" || name == "uint32") return PLY_UINT32;
+        if (name == "float" || name == "float32") return PLY_FLOAT32;
+        if (name == "double" || name == "float64") return PLY_FLOAT64;
+        return PLY_INVALID;
+    }
+    
+    static size_t plyTypeSize(PlyType type) {
+        static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+        return sizes[type];
+    }
+    
+    static double readPlyValue(const char* p, PlyType type, bool bigEndian) {
+        unsigned char bytes[8];
+        size_t size = plyTypeSize(type);
+        std::memcpy(bytes, p, size);
+        if (bigEndian) std::reverse(bytes, bytes + size);
+        
+        switch (type) {
+            case PLY_INT8: { int8_t v; std::memcpy(&v, bytes, 1); return v; }
+            case PLY_UINT8: return bytes[0];
+            case PLY_INT16: { int16_t v; std::memcpy(&v, bytes, 2); return v; }
+            case PLY_UINT16: { uint16_t v; std::memcpy(&v, bytes, 2); return v; }
+            case PLY_INT32: { int32_t v; std::memcpy(&v, bytes, 4); return v; }
+            case PLY_UINT32: { uint32_t v; std::memcpy(&v, bytes, 4); return v; }
+            case PLY_FLOAT32: { float v; std::memcpy(&v, bytes, 4); return v; }
+            case PLY_FLOAT64: { double v; std::memcpy(&v, bytes, 8); return v; }
+            default: return 0.0;
+        }
+    }
+    
+    // Where each vertex property ends up in the Object3D (or -1 to skip)
+    enum VertexSlot { SLOT_X, SLOT_Y, SLOT_Z, SLOT_NX, SLOT_NY, SLOT_NZ, SLOT_U, SLOT_V, SLOT_NONE };
+    
+    static VertexSlot plyVertexSlot(const std::string& name) {
+        if (name == "x") return SLOT_X;
+        if (name == "y") return SLOT_Y;
+        if (name == "z") return SLOT_Z;
+        if (name == "nx") return SLOT_NX;
+        if (name == "ny") return SLOT_NY;
+        if (name == "nz") return SLOT_NZ;
+        if (name == "u" || name == "s" || name == "texture_u" || name == "texture_s") return SLOT_U;
+        if (name == "v" || name == "t" || name == "texture_v" || name == "texture_t") return SLOT_V;
+        return SLOT_NONE;
+    }
+    
+    static void storeVertexSlot(Object3D& object, size_t i, VertexSlot slot, float value) {
+        switch (slot) {
+            case SLOT_X: object.vertices[i].x = value; break;
+            case SLOT_Y: object.vertices[i].y = value; break;
+            case SLOT_Z: object.vertices[i].z = value; break;
+            case SLOT_NX: object.normals[i].x = value; break;
+            case SLOT_NY: object.normals[i].y = value; break;
+            case SLOT_NZ: object.normals[i].z = value; break;
+            case SLOT_U: object.texCoords[i].first = value; break;
+            case SLOT_V: object.texCoords[i].second = value; break;
+            default: break;
+        }
+    }
+    
+    static bool isFaceIndexList(const PlyProperty& property) {
+        return property.isList && (property.name == "vertex_indices" || property.name == "vertex_index");
+    }
+    
+    // Size of one record of an element in a binary file, or 0 if it has lists
+    static size_t plyFixedStride(const PlyElement& element) {
+        size_t stride = 0;
+        for (const auto& property : element.properties) {
+            if (property.isList) return 0;
+            stride += plyTypeSize(property.type);
+        }
+        return stride;
+    }
+    
+    // Byte length of one variable-size binary record starting at p; false
+    // when a list count is negative or the record runs past the end
+    static bool plyRecordLength(const PlyElement& element, const char* p, const char* end,
+                                bool bigEndian, size_t& length) {
+        const char* s = p;
+        for (const auto& property : element.properties) {
+            size_t size = property.isList ? plyTypeSize(property.countType) : plyTypeSize(property.type);
+            if (size > static_cast<size_t>(end - s)) return false;
+            if (property.isList) {
+                double count = readPlyValue(s, property.countType, bigEndian);
+                s += size;
+                size_t itemSize = plyTypeSize(property.type);
+                if (!(count >= 0.0 && count <= static_cast<double>((end - s) / itemSize))) return false;
+                s += static_cast<size_t>(count) * itemSize;
+            } else {
+                s += size;
+            }
+        }
+        length = s - p;
+        return true;
+    }
+    
+    static std::string nextHeaderWord(const char*& p, const char* end) {
+        const char* s = skipSpaces(p, end);
+        const char* e = skipToken(s, end);
+        p = e;
+        return std::string(s, e);
+    }
+    
+    static Object3D parsePly(const char* data, size_t size, ThreadPool& pool, const std::string& path) {
+        const char* end = data + size;
+        if (!startsWith(data, end, "ply")) {
+            throw std::runtime_error(path + ": missing PLY magic");
+        }
+        
+        // Header
+        std::vector<PlyElement> elements;
+        int format = -1;
+        const char* p = lineEnd(data, end) + 1;
+        const char* body = nullptr;
+        while (p < end) {
+            const char* stop = lineEnd(p, end);
+            const char* s = p;
+            std::string keyword = nextHeaderWord(s, stop);
+            if (keyword == "format") {
+                std::string name = nextHeaderWord(s, stop);
+                if (name == "ascii") format = 0;
+                else if (name == "binary_little_endian") format = 1;
+                else if (name == "binary_big_endian") format = 2;
+            } else if (keyword == "element") {
+                PlyElement element;
+                element.name = nextHeaderWord(s, stop);
+                long count;
+                if (!parseInt(s, stop, count) || count < 0) {
+                    throw std::runtime_error(path + ": bad element count");
+                }
+                element.count = static_cast<size_t>(count);
+                elements.push_back(element);
+            } else if (keyword == "property") {
+                if (elements.empty()) throw std::runtime_error(path + ": property before element");
+                PlyProperty property;
+                std::string type = nextHeaderWord(s, stop);
+                if (type == "list") {
+                    property.isList = true;
+                    property.countType = plyTypeFromName(nextHeaderWord(s, stop));
+                    type = nextHeaderWord(s, stop);
+                }
+                property.type = plyTypeFromName(type);
+                property.name = nextHeaderWord(s, stop);
+                if (property.type == PLY_INVALID || (property.isList && property.countType == PLY_INVALID)) {
+                    throw std::runtime_error(path + ": unknown property type");
+                }
+                elements.back().properties.push_back(property);
+            } else if (keyword == "end_header") {
+                body = stop < end ? stop + 1 : end;
+                break;
+            }
+            p = stop + 1;
+        }
+        if (body == nullptr || format < 0) {
+            throw std::runtime_error(path + ": incomplete PLY header");
+        }
+        
+        const PlyElement* vertexElement = nullptr;
+        const PlyElement* faceElement = nullptr;
+        for (const auto& element : elements) {
+            if (element.name == "vertex") vertexElement = &element;
+            if (element.name == "face") faceElement = &element;
+        }
+        if (vertexElement == nullptr) {
+            throw std::runtime_error(path + ": no vertex element");
+        }
+        
+        Object3D object;
+        std::vector<VertexSlot> slots;
+        bool hasNormals = false, hasTexCoords = false;
+        for (const auto& property : vertexElement->properties) {
+            VertexSlot slot = property.isList ? SLOT_NONE : plyVertexSlot(property.name);
+            slots.push_back(slot);
+            hasNormals = hasNormals || slot == SLOT_NX;
+            hasTexCoords = hasTexCoords || slot == SLOT_U;
+        }
+        // A lone "t" or "ny" is some other attribute, not half a texture
+        // coordinate or normal
+        for (auto& slot : slots) {
+            if (!hasNormals && (slot == SLOT_NY || slot == SLOT_NZ)) slot = SLOT_NONE;
+            if (!hasTexCoords && slot == SLOT_V) slot = SLOT_NONE;
+        }
+        object.vertices.resize(vertexElement->count);
+        if (hasNormals) object.normals.resize(vertexElement->count);
+        if (hasTexCoords) object.texCoords.resize(vertexElement->count);
+        if (faceElement != nullptr) object.faces.resize(faceElement->count);
+        
+        if (format == 0) {
+            parseAsciiPlyBody(body, end, elements, vertexElement, faceElement, slots, object, pool, path);
+        } else {
+            parseBinaryPlyBody(body, end, format == 2, elements, vertexElement, faceElement, slots, object, pool, path);
+        }
+        
+        if (hasNormals) {
+            for (auto& normal : object.normals) normal = normal.normalize();
+        } else {
+            object.calculateNormals();
+        }
+        EdgeExtractor::extract(object.vertices, object.faces, object.edges, nullptr, 30.0f, pool);
+        object.markModified();
+        return object;
+    }
+    
+    static void parseAsciiPlyBody(const char* body, const char* end, const std::vector<PlyElement>& elements,
+                                  const PlyElement* vertexElement, const PlyElement* faceElement,
+                                  const std::vector<VertexSlot>& slots, Object3D& object,
+                                  ThreadPool& pool, const std::string& path) {
+        std::vector<std::pair<const char*, const char*>> ranges = splitLines(body, end, chunkCountFor(pool));
+        std::vector<size_t> lineCounts(ranges.size(), 0);
+        pool.parallelFor(ranges.size(), [&](size_t c) {
+            for (const char* p = ranges[c].first; p < ranges[c].second; p = lineEnd(p, ranges[c].second) + 1) {
+                lineCounts[c]++;
+            }
+        });
+        std::vector<size_t> firstLine(ranges.size() + 1, 0);
+        for (size_t c = 0; c < ranges.size(); c++) firstLine[c + 1] = firstLine[c] + lineCounts[c];
+        
+        // Lines of element e are [elementStart[e], elementStart[e] + count)
+        std::vector<size_t> elementStart;
+        size_t line = 0;
+        size_t vertexStart = 0, faceStart = 0;
+        for (const auto& element : elements) {
+            if (&element == vertexElement) vertexStart = line;
+            if (&element == faceElement) faceStart = line;
+            line += element.count;
+        }
+        if (line > firstLine.back()) {
+            throw std::runtime_error(path + ": file ends before all elements were read");
+        }
+        
+        std::vector<std::string> errors(ranges.size());
+        pool.parallelFor(ranges.size(), [&](size_t c) {
+            size_t index = firstLine[c];
+            std::vector<int> face;
+            for (const char* p = ranges[c].first; p < ranges[c].second; index++) {
+                const char* stop = lineEnd(p, ranges[c].second);
+                const char* s = p;
+                
+                if (index >= vertexStart && index < vertexStart + vertexElement->count) {
+                    size_t v = index - vertexStart;
+                    for (size_t k = 0; k < slots.size(); k++) {
+                        float value;
+                        if (!parseFloat(s, stop, value)) {
+                            errors[c] = "malformed vertex";
+                            return;
+                        }
+                        storeVertexSlot(object, v, slots[k], value);
+                    }
+                } else if (faceElement != nullptr && index >= faceStart && index < faceStart + faceElement->count) {
+                    size_t f = index - faceStart;
+                    for (const auto& property : faceElement->properties) {
+                        long count = 1;
+                        if (property.isList && (!parseInt(s, stop, count) || count < 0)) {
+                            errors[c] = "malformed face";
+                            return;
+                        }
+                        face.clear();
+                        for (long k = 0; k < count; k++) {
+                            float value;
+                            if (!parseFloat(s, stop, value)) {
+                                errors[c] = "malformed face";
+                                return;
+                            }
+                            face.push_back(static_cast<int>(value));
+                        }
+                        if (isFaceIndexList(property)) {
+                            for (int vertex : face) {
+                                if (vertex < 0 || static_cast<size_t>(vertex) >= vertexElement->count) {
+                                    errors[c] = "face index out of range";
+                                    return;
+                                }
+                            }
+                            object.faces[f] = face;
+                        }
+                    }
+                }
+                p = stop + 1;
+            }
+        });
+        throwFirstError(errors, path);
+    }
+    
+    static void parseBinaryPlyBody(const char* body, const char* end, bool bigEndian,
+                                   const std::vector<PlyElement>& elements,
+                                   const PlyElement* vertexElement, const PlyElement* faceElement,
+                                   const std::vector<VertexSlot>& slots, Object3D& object,
+                                   ThreadPool& pool, const std::string& path) {
+        const char* p = body;
+        for (const auto& element : elements) {
+            size_t stride = plyFixedStride(element);
+            
+            if (&element == vertexElement) {
+                if (stride == 0) throw std::runtime_error(path + ": list property in vertex element");
+                if (static_cast<size_t>(end - p) < stride * element.count) {
+                    throw std::runtime_error(path + ": truncated vertex data");
+                }
+                std::vector<size_t> offsets;
+                size_t offset = 0;
+                for (const auto& property : element.properties) {
+                    offsets.push_back(offset);
+                    offset += plyTypeSize(property.type);
+                }
+                const char* vertices = p;
+                pool.parallelForRange(element.count, 4096, [&](size_t begin, size_t stop) {
+                    for (size_t v = begin; v < stop; v++) {
+                        const char* record = vertices + v * stride;
+                        for (size_t k = 0; k < slots.size(); k++) {
+                            if (slots[k] == SLOT_NONE) continue;
+                            float value = static_cast<float>(readPlyValue(record + offsets[k], element.properties[k].type, bigEndian));
+                            storeVertexSlot(object, v, slots[k], value);
+                        }
+                    }
+                });
+                p += stride * element.count;
+            } else if (&element == faceElement) {
+                p = parseBinaryPlyFaces(p, end, bigEndian, element, vertexElement->count, object, pool, path);
+            } else if (stride != 0) {
+                if (static_cast<size_t>(end - p) < stride * element.count) {
+                    throw std::runtime_error(path + ": truncated element " + element.name);
+                }
+                p += stride * element.count;
+            } else {
+                for (size_t i = 0; i < element.count; i++) {
+                    size_t length;
+                    if (!plyRecordLength(element, p, end, bigEndian, length)) {
+                        throw std::runtime_error(path + ": malformed or truncated element " + element.name);
+                    }
+                    p += length;
+                }
+            }
+        }
+    }
+    
+    // Face records have variable length, so a quick sequential pass only
+    // records where each block of faces starts; the blocks are then decoded
+    // in parallel
+    static const char* parseBinaryPlyFaces(const char* p, const char* end, bool bigEndian,
+                                           const PlyElement& element, size_t vertexCount,
+                                           Object3D& object, ThreadPool& pool, const std::string& path) {
+        const size_t blockSize = 16384;
+        size_t blocks = (element.count + blockSize - 1) / blockSize;
+        std::vector<const char*> blockStart(blocks + 1);
+        
+        for (size_t f = 0; f < element.count; f++) {
+            if (f % blockSize == 0) blockStart[f / blockSize] = p;
+            size_t length;
+            if (!plyRecordLength(element, p, end, bigEndian, length)) {
+                throw std::runtime_error(path + ": malformed or truncated face data");
+            }
+            p += length;
+        }
+        blockStart[blocks] = p;
+        
+        std::vector<std::string> errors(blocks);
+        pool.parallelFor(blocks, [&](size_t b) {
+            const char* s = blockStart[b];
+            size_t last = std::min(element.count, (b + 1) * blockSize);
+            for (size_t f = b * blockSize; f < last; f++) {
+                for (const auto& property : element.properties) {
+                    if (!property.isList) {
+                        s += plyTypeSize(property.type);
+                        continue;
+                    }
+                    // Checked by plyRecordLength in the sequential pass
+                    size_t count = static_cast<size_t>(readPlyValue(s, property.countType, bigEndian));
+                    s += plyTypeSize(property.countType);
+                    if (isFaceIndexList(property)) {
+                        std::vector<int>& face = object.faces[f];
+                        face.resize(count);
+                        for (size_t k = 0; k < count; k++) {
+                            double value = readPlyValue(s + k * plyTypeSize(property.type), property.type, bigEndian);
+                            if (value < 0 || value >= vertexCount) {
+                                errors[b] = "face index out of range";
+                                return;
+                            }
+                            face[k] = static_cast<int>(value);
+                        }
+                    }
+                    s += count * plyTypeSize(property.type);
+                }
+            }
+        });
+        throwFirstError(errors, path);
+        return p;
+    }
+
+public:
+    static Object3D loadOBJ(const std::string& path, ThreadPool& pool = ThreadPool::shared()) {
+        MappedFile file(path);
+        return parseOBJ(file.data(), file.size(), pool, path);
+    }
+    
+    static Object3D loadSTL(const std::string& path, ThreadPool& pool = ThreadPool::shared()) {
+        MappedFile file(path);
+        if (isBinaryStl(file.data(), file.size())) {
+            return parseBinaryStl(file.data(), pool);
+        }
+        return parseAsciiStl(file.data(), file.size(), pool, path);
+    }
+    
+    static Object3D loadPLY(const std::string& path, ThreadPool& pool = ThreadPool::shared()) {
+        MappedFile file(path);
+        return parsePly(file.data(), file.size(), pool, path);
+    }
+    
+    // Picks the parser from the file extension (.obj, .stl or .ply)
+    static Object3D load(const std::string& path, ThreadPool& pool = ThreadPool::shared()) {
+        size_t dot = path.find_last_of('.');
+        std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+        for (auto& c : extension) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        
+        if (extension == "obj") return loadOBJ(path, pool);
+        if (extension == "stl") return loadSTL(path, pool);
+        if (extension == "ply") return loadPLY(path, pool);
+        throw std::runtime_error("Unsupported mesh format: " + path);
+    }
+    
+    // OBJ text already in memory. Texture coordinates and normals are per
+    // vertex in Object3D; where OBJ corners disagree, the last corner in file
+    // order wins.
+    static Object3D parseOBJ(const char* data, size_t size, ThreadPool& pool = ThreadPool::shared(),
+                             const std::string& name = "OBJ data") {
+        std::vector<std::pair<const char*, const char*>> ranges = splitLines(data, data + size, chunkCountFor(pool));
+        std::vector<ObjChunk> chunks(ranges.size());
+        for (size_t c = 0; c < ranges.size(); c++) {
+            chunks[c].begin = ranges[c].first;
+            chunks[c].end = ranges[c].second;
+        }
+        
+        pool.parallelFor(chunks.size(), [&](size_t c) {
+            countObjChunk(chunks[c]);
+        });
+        
+        // Exclusive prefix sums give every chunk its slice of the outputs
+        std::vector<ObjChunk> bases(chunks.size() + 1);
+        for (size_t c = 0; c < chunks.size(); c++) {
+            bases[c + 1].positions = bases[c].positions + chunks[c].positions;
+            bases[c + 1].texCoords = bases[c].texCoords + chunks[c].texCoords;
+            bases[c + 1].normals = bases[c].normals + chunks[c].normals;
+            bases[c + 1].faces = bases[c].faces + chunks[c].faces;
+            bases[c + 1].corners = bases[c].corners + chunks[c].corners;
+        }
+        const ObjChunk& total = bases.back();
+        ObjTotals totals = { total.positions, total.texCoords, total.normals };
+        
+        Object3D object;
+        object.vertices.resize(total.positions);
+        object.faces.resize(total.faces);
+        std::vector<std::pair<float, float>> texPool(total.texCoords);
+        std::vector<Vector3> normalPool(total.normals);
+        std::vector<int> cornerTex(total.texCoords > 0 ? total.corners : 0);
+        std::vector<int> cornerNormal(total.normals > 0 ? total.corners : 0);
+        
+        std::vector<std::string> errors(chunks.size());
+        pool.parallelFor(chunks.size(), [&](size_t c) {
+            errors[c] = parseObjChunk(chunks[c], bases[c], totals, object, texPool, normalPool, cornerTex, cornerNormal);
+        });
+        throwFirstError(errors, name);
+        
+        // Move per-corner attributes onto the vertices
+        if (!cornerTex.empty()) {
+            object.texCoords.assign(object.vertices.size(), std::make_pair(0.0f, 0.0f));
+            size_t corner = 0;
+            for (const auto& face : object.faces) {
+                for (int vertex : face) {
+                    int tex = cornerTex[corner++];
+                    if (tex >= 0) object.texCoords[vertex] = texPool[tex];
+                }
+            }
+        }
+        if (!cornerNormal.empty()) {
+            object.normals.assign(object.vertices.size(), Vector3(0.0f, 0.0f, 0.0f));
+            size_t corner = 0;
+            for (const auto& face : object.faces) {
+                for (int vertex : face) {
+                    int normal = cornerNormal[corner++];
+                    if (normal >= 0) object.normals[vertex] = normalPool[normal].normalize();
+                }
+            }
+        } else {
+            object.calculateNormals();
+        }
+        
+        EdgeExtractor::extract(object.vertices, object.faces, object.edges, nullptr, 30.0f, pool);
+        object.markModified();
+        return object;
+    }
+};
+
+#endif
\ No newline at end of file
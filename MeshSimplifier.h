@@ -0,0 +1,403 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "Vector3.h"
+#include "Object3D.h"
+#include "EdgeExtractor.h"
+
+// Quadric error metric edge-collapse simplification (Garland/Heckbert).
+// Faces are fan-triangulated; every vertex carries the sum of the
+// area-weighted plane quadrics of its triangles, and open boundaries get
+// extra perpendicular planes so silhouettes of open meshes stay in place.
+// Edges are collapsed cheapest first into the position that minimizes the
+// combined quadric. Collapses that would flip a triangle or pinch the mesh
+// into a non-manifold shape are skipped. Normals and texture coordinates
+// are interpolated along the collapsed edge; vertices that differ only in
+// attributes (texture seams) are separate vertices and their seams are
+// kept as boundaries.
+class MeshSimplifier {
+private:
+    // Symmetric 4x4 matrix of a sum of squared plane distances, upper
+    // triangle only: a2 ab ac ad b2 bc bd c2 cd d2
+    struct Quadric {
+        double q[10];
+        
+        Quadric() {
+            for (double& value : q) value = 0.0;
+        }
+        
+        static Quadric fromPlane(double a, double b, double c, double d, double weight) {
+            Quadric result;
+            result.q[0] = a * a * weight; result.q[1] = a * b * weight; result.q[2] = a * c * weight; result.q[3] = a * d * weight;
+            result.q[4] = b * b * weight; result.q[5] = b * c * weight; result.q[6] = b * d * weight;
+            result.q[7] = c * c * weight; result.q[8] = c * d * weight;
+            result.q[9] = d * d * weight;
+            return result;
+        }
+        
+        Quadric& operator+=(const Quadric& other) {
+            for (int i = 0; i < 10; i++) q[i] += other.q[i];
+            return *this;
+        }
+        
+        double error(double x, double y, double z) const {
+            return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x
+                 + q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y
+                 + q[7] * z * z + 2.0 * q[8] * z
+                 + q[9];
+        }
+        
+        // Point where the gradient vanishes; false when the linear part is
+        // (nearly) singular, as on flat or cylindrical regions
+        bool minimizer(double& x, double& y, double& z) const {
+            double a00 = q[0], a01 = q[1], a02 = q[2];
+            double a11 = q[4], a12 = q[5], a22 = q[7];
+            double c00 = a11 * a22 - a12 * a12;
+            double c01 = a02 * a12 - a01 * a22;
+            double c02 = a01 * a12 - a02 * a11;
+            double det = a00 * c00 + a01 * c01 + a02 * c02;
+            double scale = std::fabs(a00) + std::fabs(a11) + std::fabs(a22);
+            if (std::fabs(det) <= 1e-12 * scale * scale * scale) return false;
+            double c11 = a00 * a22 - a02 * a02;
+            double c12 = a01 * a02 - a00 * a12;
+            double c22 = a00 * a11 - a01 * a01;
+            double bx = -q[3], by = -q[6], bz = -q[8];
+            x = (c00 * bx + c01 * by + c02 * bz) / det;
+            y = (c01 * bx + c11 * by + c12 * bz) / det;
+            z = (c02 * bx + c12 * by + c22 * bz) / det;
+            return true;
+        }
+    };
+    
+    struct Collapse {
+        double cost;
+        uint32_t kept;
+        uint32_t removed;
+        uint32_t keptVersion;
+        uint32_t removedVersion;
+        
+        bool operator>(const Collapse& other) const {
+            return cost > other.cost;
+        }
+    };
+    
+    typedef std::array<uint32_t, 3> Triangle;
+    
+    // Boundary planes dominate the interior ones so open edges move last
+    static constexpr double BOUNDARY_WEIGHT = 100.0;
+    
+    // Cosine below which a collapse is treated as flipping a triangle
+    static constexpr double MIN_NORMAL_COSINE = 0.2;
+    
+    std::vector<Vector3> positions;
+    std::vector<Vector3> normals;
+    std::vector<std::pair<float, float>> texCoords;
+    std::vector<Quadric> quadrics;
+    std::vector<uint32_t> versions;
+    std::vector<bool> removedVertices;
+    
+    std::vector<Triangle> triangles;
+    std::vector<bool> removedTriangles;
+    std::vector<std::vector<uint32_t>> vertexTriangles;
+    size_t liveTriangles = 0;
+    
+    // Unique undirected edges as (min << 32 | max)
+    std::vector<uint64_t> edgeKeys;
+    
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+    
+    // Scratch buffers reused across collapses
+    std::vector<uint32_t> neighbors;
+    std::vector<uint32_t> otherNeighbors;
+    
+    static Vector3 triangleNormal(const Vector3& a, const Vector3& b, const Vector3& c) {
+        return (b - a).cross(c - a);
+    }
+    
+    void load(const Object3D& object) {
+        size_t vertexCount = object.vertices.size();
+        positions = object.vertices;
+        if (object.normals.size() == vertexCount) normals = object.normals;
+        if (object.texCoords.size() == vertexCount) texCoords = object.texCoords;
+        quadrics.assign(vertexCount, Quadric());
+        versions.assign(vertexCount, 0);
+        removedVertices.assign(vertexCount, false);
+        vertexTriangles.assign(vertexCount, std::vector<uint32_t>());
+        
+        for (const auto& face : object.faces) {
+            for (size_t i = 1; i + 1 < face.size(); i++) {
+                Triangle t = {{ static_cast<uint32_t>(face[0]), static_cast<uint32_t>(face[i]), static_cast<uint32_t>(face[i + 1]) }};
+                if (t[0] == t[1] || t[1] == t[2] || t[0] == t[2]) continue;
+                uint32_t index = static_cast<uint32_t>(triangles.size());
+                triangles.push_back(t);
+                for (uint32_t v : t) vertexTriangles[v].push_back(index);
+            }
+        }
+        removedTriangles.assign(triangles.size(), false);
+        liveTriangles = triangles.size();
+    }
+    
+    void computeQuadrics() {
+        for (const Triangle& t : triangles) {
+            Vector3 n = triangleNormal(positions[t[0]], positions[t[1]], positions[t[2]]);
+            double length = n.magnitude();
+            if (length <= 0.0) continue;
+            double a = n.x / length, b = n.y / length, c = n.z / length;
+            double d = -(a * positions[t[0]].x + b * positions[t[0]].y + c * positions[t[0]].z);
+            Quadric plane = Quadric::fromPlane(a, b, c, d, length * 0.5);
+            for (uint32_t v : t) quadrics[v] += plane;
+        }
+        
+        // An edge used by a single triangle is open: add the plane through it
+        // perpendicular to that triangle
+        std::vector<std::pair<uint64_t, uint32_t>> edgeUses;
+        edgeUses.reserve(triangles.size() * 3);
+        for (uint32_t index = 0; index < triangles.size(); index++) {
+            const Triangle& t = triangles[index];
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = t[k], b = t[(k + 1) % 3];
+                uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+                edgeUses.push_back(std::make_pair(key, index));
+            }
+        }
+        std::sort(edgeUses.begin(), edgeUses.end());
+        for (size_t i = 0; i < edgeUses.size();) {
+            size_t j = i + 1;
+            while (j < edgeUses.size() && edgeUses[j].first == edgeUses[i].first) j++;
+            edgeKeys.push_back(edgeUses[i].first);
+            if (j - i == 1) {
+                uint32_t a = static_cast<uint32_t>(edgeUses[i].first >> 32);
+                uint32_t b = static_cast<uint32_t>(edgeUses[i].first & 0xffffffffu);
+                const Triangle& t = triangles[edgeUses[i].second];
+                Vector3 faceNormal = triangleNormal(positions[t[0]], positions[t[1]], positions[t[2]]);
+                Vector3 edge = positions[b] - positions[a];
+                Vector3 n = edge.cross(faceNormal);
+                double length = n.magnitude();
+                if (length > 0.0) {
+                    double na = n.x / length, nb = n.y / length, nc = n.z / length;
+                    double d = -(na * positions[a].x + nb * positions[a].y + nc * positions[a].z);
+                    Quadric plane = Quadric::fromPlane(na, nb, nc, d, BOUNDARY_WEIGHT * edge.dot(edge));
+                    quadrics[a] += plane;
+                    quadrics[b] += plane;
+                }
+            }
+            i = j;
+        }
+    }
+    
+    // Unique vertices sharing a live triangle with v
+    void collectNeighbors(uint32_t v, std::vector<uint32_t>& out) const {
+        out.clear();
+        for (uint32_t index : vertexTriangles[v]) {
+            if (removedTriangles[index]) continue;
+            for (uint32_t w : triangles[index]) {
+                if (w != v) out.push_back(w);
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+    
+    // Cheapest position for merging a and b: the quadric minimizer, or the
+    // best of the endpoints and midpoint when that is undefined
+    double collapseCost(uint32_t a, uint32_t b, Vector3& position) const {
+        Quadric q = quadrics[a];
+        q += quadrics[b];
+        double x, y, z;
+        if (q.minimizer(x, y, z)) {
+            position = Vector3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+            return std::max(0.0, q.error(x, y, z));
+        }
+        const Vector3 candidates[3] = { positions[a], positions[b], (positions[a] + positions[b]) * 0.5f };
+        double best = std::numeric_limits<double>::infinity();
+        for (const Vector3& candidate : candidates) {
+            double error = q.error(candidate.x, candidate.y, candidate.z);
+            if (error < best) {
+                best = error;
+                position = candidate;
+            }
+        }
+        return std::max(0.0, best);
+    }
+    
+    void pushCollapse(uint32_t a, uint32_t b) {
+        Vector3 position;
+        Collapse collapse;
+        collapse.cost = collapseCost(a, b, position);
+        collapse.kept = a;
+        collapse.removed = b;
+        collapse.keptVersion = versions[a];
+        collapse.removedVersion = versions[b];
+        heap.push(collapse);
+    }
+    
+    // The vertices adjacent to both ends must be exactly the apexes of the
+    // triangles on the edge, or the collapse would fuse separate sheets
+    bool preservesManifold(uint32_t a, uint32_t b) {
+        collectNeighbors(a, neighbors);
+        collectNeighbors(b, otherNeighbors);
+        size_t shared = 0;
+        for (size_t i = 0, j = 0; i < neighbors.size() && j < otherNeighbors.size();) {
+            if (neighbors[i] < otherNeighbors[j]) i++;
+            else if (neighbors[i] > otherNeighbors[j]) j++;
+            else { shared++; i++; j++; }
+        }
+        size_t edgeTriangles = 0;
+        for (uint32_t index : vertexTriangles[a]) {
+            if (removedTriangles[index]) continue;
+            const Triangle& t = triangles[index];
+            if (t[0] == b || t[1] == b || t[2] == b) edgeTriangles++;
+        }
+        return shared == edgeTriangles;
+    }
+    
+    // Moving v to position must not turn any of its surviving triangles over
+    bool keepsOrientation(uint32_t v, uint32_t other, const Vector3& position) const {
+        for (uint32_t index : vertexTriangles[v]) {
+            if (removedTriangles[index]) continue;
+            const Triangle& t = triangles[index];
+            if (t[0] == other || t[1] == other || t[2] == other) continue;
+            Vector3 corners[3] = { positions[t[0]], positions[t[1]], positions[t[2]] };
+            Vector3 before = triangleNormal(corners[0], corners[1], corners[2]);
+            for (int k = 0; k < 3; k++) {
+                if (t[k] == v) corners[k] = position;
+            }
+            Vector3 after = triangleNormal(corners[0], corners[1], corners[2]);
+            double beforeLength = before.magnitude();
+            double afterLength = after.magnitude();
+            if (beforeLength <= 0.0) continue;
+            if (afterLength <= 0.0) return false;
+            if (before.dot(after) < MIN_NORMAL_COSINE * beforeLength * afterLength) return false;
+        }
+        return true;
+    }
+    
+    void collapse(uint32_t kept, uint32_t removed, const Vector3& position) {
+        // Attributes follow the projection of the new position onto the edge
+        Vector3 edge = positions[removed] - positions[kept];
+        float lengthSquared = edge.dot(edge);
+        float t = lengthSquared > 0.0f ? std::min(1.0f, std::max(0.0f, (position - positions[kept]).dot(edge) / lengthSquared)) : 0.0f;
+        if (!normals.empty()) {
+            normals[kept] = (normals[kept] * (1.0f - t) + normals[removed] * t).normalize();
+        }
+        if (!texCoords.empty()) {
+            texCoords[kept].first += (texCoords[removed].first - texCoords[kept].first) * t;
+            texCoords[kept].second += (texCoords[removed].second - texCoords[kept].second) * t;
+        }
+        positions[kept] = position;
+        quadrics[kept] += quadrics[removed];
+        removedVertices[removed] = true;
+        versions[kept]++;
+        versions[removed]++;
+        
+        for (uint32_t index : vertexTriangles[removed]) {
+            if (removedTriangles[index]) continue;
+            Triangle& triangle = triangles[index];
+            if (triangle[0] == kept || triangle[1] == kept || triangle[2] == kept) {
+                removedTriangles[index] = true;
+                liveTriangles--;
+                continue;
+            }
+            for (uint32_t& v : triangle) {
+                if (v == removed) v = kept;
+            }
+            vertexTriangles[kept].push_back(index);
+        }
+        vertexTriangles[removed].clear();
+        
+        std::vector<uint32_t>& list = vertexTriangles[kept];
+        list.erase(std::remove_if(list.begin(), list.end(), [this](uint32_t index) { return removedTriangles[index]; }), list.end());
+        
+        // Costs of every edge around the merged vertex changed; the version
+        // bump above invalidates their queued entries
+        collectNeighbors(kept, neighbors);
+        for (uint32_t w : neighbors) pushCollapse(kept, w);
+    }
+    
+    Object3D extract(const Object3D& source) const {
+        Object3D result;
+        result.color = source.color;
+        result.texturePath = source.texturePath;
+        
+        std::vector<int> remap(positions.size(), -1);
+        for (size_t index = 0; index < triangles.size(); index++) {
+            if (removedTriangles[index]) continue;
+            std::vector<int> face;
+            for (uint32_t v : triangles[index]) {
+                if (remap[v] < 0) {
+                    remap[v] = static_cast<int>(result.vertices.size());
+                    result.vertices.push_back(positions[v]);
+                    if (!normals.empty()) result.normals.push_back(normals[v]);
+                    if (!texCoords.empty()) result.texCoords.push_back(texCoords[v]);
+                }
+                face.push_back(remap[v]);
+            }
+            result.faces.push_back(face);
+        }
+        
+        EdgeExtractor::extract(result.vertices, result.faces, result.edges);
+        
+        result.markModified();
+        return result;
+    }
+    
+    Object3D run(const Object3D& object, size_t targetTriangles, double maxError, double* reachedError) {
+        load(object);
+        computeQuadrics();
+        
+        for (uint64_t key : edgeKeys) {
+            pushCollapse(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key & 0xffffffffu));
+        }
+        
+        double error = 0.0;
+        while (liveTriangles > targetTriangles && !heap.empty()) {
+            Collapse top = heap.top();
+            heap.pop();
+            if (top.cost > maxError) break;
+            uint32_t a = top.kept, b = top.removed;
+            if (removedVertices[a] || removedVertices[b]) continue;
+            if (versions[a] != top.keptVersion || versions[b] != top.removedVersion) continue;
+            
+            Vector3 position;
+            collapseCost(a, b, position);
+            if (!preservesManifold(a, b)) continue;
+            if (!keepsOrientation(a, b, position) || !keepsOrientation(b, a, position)) continue;
+            
+            collapse(a, b, position);
+            error = std::max(error, top.cost);
+        }
+        if (reachedError) *reachedError = error;
+        return extract(object);
+    }
+
+public:
+    // Collapses edges until at most targetTriangles triangles remain, or the
+    // next collapse would cost more than maxError (squared distance units,
+    // area weighted). The result is all triangles with welded edges; the
+    // largest collapse cost spent is written to reachedError if given.
+    static Object3D simplify(const Object3D& object, size_t targetTriangles,
+                             double maxError = std::numeric_limits<double>::infinity(),
+                             double* reachedError = nullptr) {
+        MeshSimplifier simplifier;
+        return simplifier.run(object, targetTriangles, maxError, reachedError);
+    }
+    
+    static size_t triangleCount(const Object3D& object) {
+        size_t count = 0;
+        for (const auto& face : object.faces) {
+            if (face.size() >= 3) count += face.size() - 2;
+        }
+        return count;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -3,9 +3,15 @@
 
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cmath>
 #include <string>
 #include "Vector3.h"
+#include "BoundingVolume.h"
+#include "ThreadPool.h"
+#include "EdgeExtractor.h"
 
 class Object3D {
 public:
@@ -13,12 +19,53 @@ public:
     std::vector<Vector3> normals; 
     std::vector<std::pair<float, float>> texCoords;
     std::vector<std::pair<int, int>> edges;
+    // Convex polygons, counter-clockwise seen from outside
     std::vector<std::vector<int>> faces;
+    
+    // EdgeExtractor::EdgeFlags per edge after extractEdges(true), else empty
+    std::vector<uint8_t> edgeFlags;
     std::array<float, 3> color;
     std::string texturePath;
-
-    Object3D() : color({1.0f, 1.0f, 1.0f}), texturePath("") {}
-
+    
+    // Identifies the current geometry; copies share it, edits must call
+    // markModified() so buffers derived from the mesh are rebuilt
+    uint64_t revision;
+    
+    // Object-space bounds of the vertices, refreshed by markModified()
+    AABB bounds;
+    BoundingSphere boundingSphere;
+    
+    Object3D() : color({1.0f, 1.0f, 1.0f}), texturePath(""), revision(nextRevision()) {}
+    
+    static uint64_t nextRevision() {
+        static std::atomic<uint64_t> counter(0);
+        return ++counter;
+    }
+    
+    void markModified() {
+        revision = nextRevision();
+        calculateBounds();
+    }
+    
+    // Box around the vertices; the sphere shares its center and reaches the
+    // farthest vertex, which is tighter than the box's half-diagonal
+    void calculateBounds() {
+        bounds = AABB();
+        for (const auto& vertex : vertices) bounds.expand(vertex);
+        
+        if (bounds.isEmpty()) {
+            boundingSphere = BoundingSphere();
+            return;
+        }
+        Vector3 center = bounds.center();
+        float radiusSquared = 0.0f;
+        for (const auto& vertex : vertices) {
+            Vector3 d = vertex - center;
+            radiusSquared = std::max(radiusSquared, d.dot(d));
+        }
+        boundingSphere = BoundingSphere(center, std::sqrt(radiusSquared));
+    }
+    
     void setColor(float r, float g, float b) {
         color = {r, g, b};
     }
@@ -27,34 +74,215 @@ public:
         texturePath = path;
     }
     
+    // Replaces the edges with the unique edges of the faces, optionally
+    // tagging boundary, non-manifold and feature edges (faces meeting at
+    // more than featureAngle degrees) in edgeFlags
+    void extractEdges(bool tagEdges = false, float featureAngle = 30.0f) {
+        EdgeExtractor::extract(vertices, faces, edges, tagEdges ? &edgeFlags : nullptr, featureAngle);
+        if (!tagEdges) edgeFlags.clear();
+        markModified();
+    }
+    
+    // Newell's method: the sum of the edge cross products is the polygon's
+    // normal scaled by twice its area, for convex, concave and slightly
+    // non-planar n-gons alike
+    Vector3 faceAreaVector(const std::vector<int>& face) const {
+        Vector3 sum(0.0f, 0.0f, 0.0f);
+        size_t count = face.size();
+        if (count < 3) return sum;
+        const Vector3& origin = vertices[face[0]];
+        for (size_t i = 1; i + 1 < count; i++) {
+            sum = sum + (vertices[face[i]] - origin).cross(vertices[face[i + 1]] - origin);
+        }
+        return sum;
+    }
+    
     Vector3 calculateFaceNormal(const std::vector<int>& face) const {
         if (face.size() < 3) return Vector3(0, 1, 0);
-        
-        const Vector3& v1 = vertices[face[0]];
-        const Vector3& v2 = vertices[face[1]];
-        const Vector3& v3 = vertices[face[2]];
-        
-        Vector3 edge1 = v2 - v1;
-        Vector3 edge2 = v3 - v1;
-        return edge1.cross(edge2).normalize();
+        return faceAreaVector(face).normalize();
+    }
+    
+    // Below this many faces the adjacency pass of calculateNormals() costs
+    // more than the threads save
+    enum : size_t { PARALLEL_NORMALS_MIN_FACES = 1 << 14 };
+    
+    enum class NormalWeighting {
+        Uniform,  // every adjacent face counts the same
+        Area,     // faces count by their area
+        Angle     // faces count by their interior angle at the vertex
+    };
+    
+    // acos within 7e-5 radians (Abramowitz/Stegun 4.4.45), plenty for
+    // weights and several times cheaper than std::acos
+    static float approximateAcos(float x) {
+        float a = std::fabs(x);
+        float root = std::sqrt(std::max(0.0f, 1.0f - a));
+        float result = root * (1.5707288f + a * (-0.2121144f + a * (0.0742610f - 0.0187293f * a)));
+        return x < 0.0f ? static_cast<float>(M_PI) - result : result;
+    }
+    
+    // normalize() with one division instead of three
+    static Vector3 unitOrZero(const Vector3& v) {
+        float length = v.magnitude();
+        return length > 0.0f ? v * (1.0f / length) : Vector3(0.0f, 0.0f, 0.0f);
     }
     
-    void calculateNormals() {
-        normals.clear();
-        normals.resize(vertices.size(), Vector3(0, 0, 0));
+    // Unit normal of the face, and the weight each of its corners gives it
+    Vector3 faceNormalAndWeights(const std::vector<int>& face, NormalWeighting weighting, float* weights) const {
+        size_t n = face.size();
+        Vector3 areaVector = faceAreaVector(face);
+        float area = areaVector.magnitude();
+        if (weighting != NormalWeighting::Angle || n < 3) {
+            float weight = weighting == NormalWeighting::Area ? area : 1.0f;
+            for (size_t k = 0; k < n; k++) weights[k] = weight;
+        } else {
+            // Interior angle between the incoming and outgoing edge
+            Vector3 incoming = unitOrZero(vertices[face[0]] - vertices[face[n - 1]]);
+            for (size_t k = 0; k < n; k++) {
+                Vector3 outgoing = unitOrZero(vertices[face[k + 1 < n ? k + 1 : 0]] - vertices[face[k]]);
+                weights[k] = approximateAcos(std::max(-1.0f, std::min(1.0f, -incoming.dot(outgoing))));
+                incoming = outgoing;
+            }
+        }
+        return area > 0.0f ? areaVector * (1.0f / area) : Vector3(0.0f, 0.0f, 0.0f);
+    }
+    
+    // Smooth vertex normals from the faces around each vertex. Face normals
+    // and per-corner weights are computed in parallel over faces; the sums
+    // are then gathered in parallel over vertices through a vertex-to-corner
+    // adjacency, so no two threads write the same normal. With a single
+    // thread, or a mesh too small to split, they are scattered in face order
+    // instead. Angle weighting does not depend on how the surface was
+    // tessellated. Faces meeting at more than creaseAngle degrees get
+    // separate normals: the vertex is duplicated (with its texture
+    // coordinate) for each additional smooth group and those faces are
+    // rewired to the copy. Edges keep the original vertices, which share the
+    // copies' positions.
+    void calculateNormals(NormalWeighting weighting = NormalWeighting::Angle, float creaseAngle = 180.0f) {
+        ThreadPool& pool = ThreadPool::shared();
+        size_t vertexCount = vertices.size();
+        size_t faceCount = faces.size();
+        
+        bool splitCreases = creaseAngle < 180.0f;
+        if (!splitCreases && (pool.size() == 1 || faceCount < PARALLEL_NORMALS_MIN_FACES)) {
+            normals.assign(vertexCount, Vector3(0, 0, 0));
+            std::vector<float> weights;
+            for (const auto& face : faces) {
+                weights.resize(face.size());
+                Vector3 faceNormal = faceNormalAndWeights(face, weighting, weights.data());
+                for (size_t k = 0; k < face.size(); k++) {
+                    Vector3& normal = normals[face[k]];
+                    normal = normal + faceNormal * weights[k];
+                }
+            }
+            for (auto& normal : normals) normal = normal.normalize();
+            markModified();
+            return;
+        }
+        
+        std::vector<uint32_t> faceOffsets(faceCount + 1, 0);
+        for (size_t f = 0; f < faceCount; f++) {
+            faceOffsets[f + 1] = faceOffsets[f] + static_cast<uint32_t>(faces[f].size());
+        }
+        size_t cornerCount = faceOffsets[faceCount];
         
+        std::vector<Vector3> faceNormals(faceCount);
+        std::vector<float> cornerWeights(cornerCount);
+        std::vector<uint32_t> cornerFaces(cornerCount);
+        pool.parallelForRange(faceCount, 4096, [&](size_t begin, size_t end) {
+            for (size_t f = begin; f < end; f++) {
+                faceNormals[f] = faceNormalAndWeights(faces[f], weighting, &cornerWeights[faceOffsets[f]]);
+                for (uint32_t c = faceOffsets[f]; c < faceOffsets[f + 1]; c++) cornerFaces[c] = static_cast<uint32_t>(f);
+            }
+        });
+        
+        // Corners of each vertex, grouped by a counting sort
+        std::vector<uint32_t> vertexOffsets(vertexCount + 1, 0);
         for (const auto& face : faces) {
-            Vector3 faceNormal = calculateFaceNormal(face);
-            for (int vertexIndex : face) {
-                normals[vertexIndex] = normals[vertexIndex] + faceNormal;
+            for (int v : face) vertexOffsets[v + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) vertexOffsets[v + 1] += vertexOffsets[v];
+        std::vector<uint32_t> vertexCorners(cornerCount);
+        {
+            std::vector<uint32_t> cursor(vertexOffsets.begin(), vertexOffsets.end() - 1);
+            for (size_t f = 0; f < faceCount; f++) {
+                for (size_t k = 0; k < faces[f].size(); k++) {
+                    vertexCorners[cursor[faces[f][k]]++] = faceOffsets[f] + static_cast<uint32_t>(k);
+                }
             }
         }
         
-        for (auto& normal : normals) {
-            normal = normal.normalize();
+        // Smooth group of every corner: a corner joins the first group whose
+        // seed face is within the crease angle of its own
+        float creaseCosine = std::cos(creaseAngle * static_cast<float>(M_PI) / 180.0f);
+        std::vector<uint8_t> cornerGroups;
+        std::vector<uint32_t> extraGroups;
+        if (splitCreases) {
+            cornerGroups.assign(cornerCount, 0);
+            extraGroups.assign(vertexCount + 1, 0);
+            pool.parallelForRange(vertexCount, 1024, [&](size_t begin, size_t end) {
+                std::vector<Vector3> seeds;
+                for (size_t v = begin; v < end; v++) {
+                    seeds.clear();
+                    for (uint32_t i = vertexOffsets[v]; i < vertexOffsets[v + 1]; i++) {
+                        uint32_t corner = vertexCorners[i];
+                        const Vector3& unit = faceNormals[cornerFaces[corner]];
+                        size_t group = 0;
+                        while (group < seeds.size() && seeds[group].dot(unit) < creaseCosine) group++;
+                        // Beyond 256 groups the rest share the last one
+                        if (group == seeds.size() && seeds.size() < 256) seeds.push_back(unit);
+                        cornerGroups[corner] = static_cast<uint8_t>(std::min<size_t>(group, 255));
+                    }
+                    extraGroups[v + 1] = seeds.empty() ? 0 : static_cast<uint32_t>(seeds.size() - 1);
+                }
+            });
+            for (size_t v = 0; v < vertexCount; v++) extraGroups[v + 1] += extraGroups[v];
+        }
+        
+        size_t splitCount = splitCreases ? extraGroups[vertexCount] : 0;
+        normals.assign(vertexCount + splitCount, Vector3(0, 0, 0));
+        vertices.resize(vertexCount + splitCount);
+        bool hasTexCoords = texCoords.size() == vertexCount;
+        if (hasTexCoords) texCoords.resize(vertexCount + splitCount);
+        
+        pool.parallelForRange(vertexCount, 1024, [&](size_t begin, size_t end) {
+            std::vector<Vector3> sums;
+            for (size_t v = begin; v < end; v++) {
+                size_t groups = splitCreases ? extraGroups[v + 1] - extraGroups[v] + 1 : 1;
+                sums.assign(groups, Vector3(0, 0, 0));
+                for (uint32_t i = vertexOffsets[v]; i < vertexOffsets[v + 1]; i++) {
+                    uint32_t corner = vertexCorners[i];
+                    size_t group = splitCreases ? cornerGroups[corner] : 0;
+                    sums[group] = sums[group] + faceNormals[cornerFaces[corner]] * cornerWeights[corner];
+                }
+                normals[v] = sums[0].normalize();
+                for (size_t group = 1; group < groups; group++) {
+                    size_t copy = vertexCount + extraGroups[v] + group - 1;
+                    vertices[copy] = vertices[v];
+                    if (hasTexCoords) texCoords[copy] = texCoords[v];
+                    normals[copy] = sums[group].normalize();
+                }
+            }
+        });
+        
+        // Each corner belongs to one face, so the rewiring writes never collide
+        if (splitCount > 0) {
+            pool.parallelForRange(vertexCount, 1024, [&](size_t begin, size_t end) {
+                for (size_t v = begin; v < end; v++) {
+                    if (extraGroups[v + 1] == extraGroups[v]) continue;
+                    for (uint32_t i = vertexOffsets[v]; i < vertexOffsets[v + 1]; i++) {
+                        uint32_t corner = vertexCorners[i];
+                        size_t group = cornerGroups[corner];
+                        if (group == 0) continue;
+                        uint32_t f = cornerFaces[corner];
+                        faces[f][corner - faceOffsets[f]] = static_cast<int>(vertexCount + extraGroups[v] + group - 1);
+                    }
+                }
+            });
         }
+        markModified();
     }
-
+    
     static Object3D createCube(float size = 1.0f) {
         Object3D cube;
         float halfSize = size / 2.0f;
@@ -88,11 +316,11 @@ public:
         };
         
         cube.faces = {
-            {0, 1, 2, 3},  // back face
+            {0, 3, 2, 1},  // back face
             {4, 5, 6, 7},  // front face
             {0, 1, 5, 4},  // bottom face
             {2, 3, 7, 6},  // top face
-            {0, 3, 7, 4},  // left face
+            {0, 4, 7, 3},  // left face
             {1, 2, 6, 5}   // right face
         };
         
@@ -127,7 +355,7 @@ public:
         };
         
         pyramid.faces = {
-            {0, 1, 2, 3},  // base
+            {0, 3, 2, 1},  // base
             {0, 1, 4},     // front face
             {1, 2, 4},     // right face
             {2, 3, 4},     // back face
@@ -162,7 +390,7 @@ public:
         };
         
         tetra.faces = {
-            {0, 1, 2},  // base
+            {0, 2, 1},  // base
             {0, 1, 3},  // front face
             {1, 2, 3},  // right face
             {2, 0, 3}   // left face
@@ -204,17 +432,13 @@ public:
                 int next_col = i * resolution + (j + 1) % resolution;
                 int next_both = (i + 1) * resolution + (j + 1) % resolution;
                 
-                if (i < resolution - 1) {
-                    sphere.edges.push_back({current, next_row});
-                }
+                sphere.edges.push_back({current, next_row});
                 sphere.edges.push_back({current, next_col});
-                
-                if (i < resolution - 1) {
-                    sphere.faces.push_back({current, next_col, next_both, next_row});
-                }
+                sphere.faces.push_back({current, next_row, next_both, next_col});
             }
         }
         
+        sphere.markModified();
         return sphere;
     }
 };
@@ -0,0 +1,146 @@
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "Vector3.h"
+#include "Matrix4x4.h"
+
+// Rotation as a unit quaternion w + xi + yj + zk. Products compose like
+// matrices: (a * b).rotate(v) == a.rotate(b.rotate(v)). Angles are in
+// degrees, as everywhere else.
+class Quaternion {
+public:
+    float w, x, y, z;
+    
+    Quaternion() : w(1.0f), x(0.0f), y(0.0f), z(0.0f) {}
+    Quaternion(float w, float x, float y, float z) : w(w), x(x), y(y), z(z) {}
+    
+    static Quaternion fromAxisAngle(const Vector3& axis, float angleDegrees) {
+        Vector3 unit = axis.normalize();
+        float half = angleDegrees * static_cast<float>(M_PI) / 360.0f;
+        float s = std::sin(half);
+        return Quaternion(std::cos(half), unit.x * s, unit.y * s, unit.z * s);
+    }
+    
+    // Same rotation as Matrix4x4::rotationX(x) * rotationY(y) * rotationZ(z)
+    static Quaternion fromEuler(const Vector3& degrees) {
+        float scale = static_cast<float>(M_PI) / 360.0f;
+        float cx = std::cos(degrees.x * scale), sx = std::sin(degrees.x * scale);
+        float cy = std::cos(degrees.y * scale), sy = std::sin(degrees.y * scale);
+        float cz = std::cos(degrees.z * scale), sz = std::sin(degrees.z * scale);
+        return Quaternion(cx * cy * cz - sx * sy * sz,
+                          sx * cy * cz + cx * sy * sz,
+                          cx * sy * cz - sx * cy * sz,
+                          cx * cy * sz + sx * sy * cz);
+    }
+    
+    // Rotation part of a matrix whose upper 3x3 is a pure rotation
+    static Quaternion fromMatrix(const Matrix4x4& matrix) {
+        const float (&m)[4][4] = matrix.m;
+        float trace = m[0][0] + m[1][1] + m[2][2];
+        Quaternion q;
+        if (trace > 0.0f) {
+            float s = 0.5f / std::sqrt(trace + 1.0f);
+            q = Quaternion(0.25f / s, (m[2][1] - m[1][2]) * s, (m[0][2] - m[2][0]) * s, (m[1][0] - m[0][1]) * s);
+        } else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+            float s = 2.0f * std::sqrt(1.0f + m[0][0] - m[1][1] - m[2][2]);
+            q = Quaternion((m[2][1] - m[1][2]) / s, 0.25f * s, (m[0][1] + m[1][0]) / s, (m[0][2] + m[2][0]) / s);
+        } else if (m[1][1] > m[2][2]) {
+            float s = 2.0f * std::sqrt(1.0f + m[1][1] - m[0][0] - m[2][2]);
+            q = Quaternion((m[0][2] - m[2][0]) / s, (m[0][1] + m[1][0]) / s, 0.25f * s, (m[1][2] + m[2][1]) / s);
+        } else {
+            float s = 2.0f * std::sqrt(1.0f + m[2][2] - m[0][0] - m[1][1]);
+            q = Quaternion((m[1][0] - m[0][1]) / s, (m[0][2] + m[2][0]) / s, (m[1][2] + m[2][1]) / s, 0.25f * s);
+        }
+        return q.normalize();
+    }
+    
+    Quaternion operator*(const Quaternion& q) const {
+        return Quaternion(w * q.w - x * q.x - y * q.y - z * q.z,
+                          w * q.x + x * q.w + y * q.z - z * q.y,
+                          w * q.y - x * q.z + y * q.w + z * q.x,
+                          w * q.z + x * q.y - y * q.x + z * q.w);
+    }
+    
+    float dot(const Quaternion& q) const {
+        return w * q.w + x * q.x + y * q.y + z * q.z;
+    }
+    
+    float magnitude() const {
+        return std::sqrt(dot(*this));
+    }
+    
+    Quaternion normalize() const {
+        float mag = magnitude();
+        if (mag == 0.0f)
+            return Quaternion();
+        float inv = 1.0f / mag;
+        return Quaternion(w * inv, x * inv, y * inv, z * inv);
+    }
+    
+    // The inverse rotation of a unit quaternion
+    Quaternion conjugate() const {
+        return Quaternion(w, -x, -y, -z);
+    }
+    
+    Vector3 rotate(const Vector3& v) const {
+        // v + 2w(u x v) + 2u x (u x v), with u the vector part
+        Vector3 u(x, y, z);
+        Vector3 t = u.cross(v) * 2.0f;
+        return v + t * w + u.cross(t);
+    }
+    
+    Matrix4x4 toMatrix() const {
+        Matrix4x4 result;
+        float xx = x * x, yy = y * y, zz = z * z;
+        float xy = x * y, xz = x * z, yz = y * z;
+        float wx = w * x, wy = w * y, wz = w * z;
+        result.m[0][0] = 1.0f - 2.0f * (yy + zz);
+        result.m[0][1] = 2.0f * (xy - wz);
+        result.m[0][2] = 2.0f * (xz + wy);
+        result.m[1][0] = 2.0f * (xy + wz);
+        result.m[1][1] = 1.0f - 2.0f * (xx + zz);
+        result.m[1][2] = 2.0f * (yz - wx);
+        result.m[2][0] = 2.0f * (xz - wy);
+        result.m[2][1] = 2.0f * (yz + wx);
+        result.m[2][2] = 1.0f - 2.0f * (xx + yy);
+        return result;
+    }
+    
+    // Normalized linear interpolation along the shorter arc. Not constant
+    // speed, but close for the small angles between neighbouring keyframes.
+    static Quaternion nlerp(const Quaternion& a, const Quaternion& b, float t) {
+        float sign = a.dot(b) < 0.0f ? -1.0f : 1.0f;
+        float u = 1.0f - t;
+        float v = t * sign;
+        return Quaternion(a.w * u + b.w * v, a.x * u + b.x * v,
+                          a.y * u + b.y * v, a.z * u + b.z * v).normalize();
+    }
+    
+    // Constant-speed interpolation along the shorter arc
+    static Quaternion slerp(const Quaternion& a, const Quaternion& b, float t) {
+        float cosTheta = a.dot(b);
+        float sign = 1.0f;
+        if (cosTheta < 0.0f) {
+            cosTheta = -cosTheta;
+            sign = -1.0f;
+        }
+        // Nearly parallel: sin(theta) vanishes and nlerp is exact enough
+        if (cosTheta > 0.9995f) return nlerp(a, b, t);
+        float theta = std::acos(std::min(cosTheta, 1.0f));
+        float invSin = 1.0f / std::sin(theta);
+        float u = std::sin((1.0f - t) * theta) * invSin;
+        float v = std::sin(t * theta) * invSin * sign;
+        return Quaternion(a.w * u + b.w * v, a.x * u + b.x * v,
+                          a.y * u + b.y * v, a.z * u + b.z * v);
+    }
+    
+    friend std::ostream& operator<<(std::ostream& os, const Quaternion& q) {
+        os << "Quaternion(" << q.w << ", " << q.x << ", " << q.y << ", " << q.z << ")";
+        return os;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+#include <cstddef>
+#include <vector>
+#include "Vector3.h"
+#include "Quaternion.h"
+#include "Object3D.h"
+#include "TransformationPipeline.h"
+#include "Frustum.h"
+#include "InstanceData.h"
+#include "LODChain.h"
+#include "HiZBuffer.h"
+
+// Common interface of the OpenGL Renderer and the headless SoftwareRenderer.
+// Deliberately free of any OpenGL includes so headless builds can use it.
+class RenderBackend {
+public:
+    // Which faces to drop before rasterization, like glCullFace. Front
+    // faces wind counter-clockwise on screen, the GL default.
+    enum class CullMode {
+        None,
+        Back,
+        Front,
+        FrontAndBack
+    };
+
+protected:
+    int width;
+    int height;
+    TransformationPipeline pipeline;
+    bool wireframeMode = true;
+    bool depthTestEnabled = true;
+    bool frustumCullingEnabled = true;
+    bool occlusionCullingEnabled = false;
+    CullMode cullMode = CullMode::None;
+    CullStats cullStats;
+    
+    // Culling settings as of the last beginFrame(). Changes made during a
+    // frame apply from the next one, so a frame never mixes two settings.
+    bool frameFrustumCulling = true;
+    bool frameOcclusion = false;
+    CullMode frameCullMode = CullMode::None;
+    
+    enum : int { OCCLUSION_DOWNSCALE = 4 };
+    
+    // Occluders of the current frame, at a quarter of the resolution
+    HiZBuffer occlusionBuffer;
+    
+    // Occluders only hide what is behind them when drawn filled and depth
+    // tested
+    bool occlusionActive() const {
+        return occlusionCullingEnabled && depthTestEnabled && !wireframeMode;
+    }
+    
+    // Every backend calls this from beginFrame()
+    void beginFrameCulling() {
+        frameFrustumCulling = frustumCullingEnabled;
+        frameOcclusion = occlusionActive();
+        frameCullMode = cullMode;
+    }
+    
+    // True when the box under the given model-view-projection matrix is
+    // hidden behind this frame's occluders
+    bool isOccluded(const AABB& bounds, const Matrix4x4& mvp) {
+        if (!frameOcclusion) return false;
+        occlusionBuffer.update();
+        return occlusionBuffer.isOccluded(bounds, mvp);
+    }
+    
+    // Counts the object and returns true when its bounds under the current
+    // model matrix lie outside the view frustum or behind the occluders.
+    // Objects without bounds (vertices edited without markModified()) are
+    // always drawn.
+    bool cullObject(const Object3D& object) {
+        if (!object.bounds.isEmpty() && (frameFrustumCulling || frameOcclusion)) {
+            cullStats.objectsTested++;
+            if (frameFrustumCulling && !pipeline.getFrustum().intersects(object.bounds.transformed(pipeline.modelMatrix))) {
+                cullStats.objectsCulled++;
+                return true;
+            }
+            if (isOccluded(object.bounds, pipeline.getMVPMatrix())) {
+                cullStats.objectsCulled++;
+                cullStats.objectsOccluded++;
+                return true;
+            }
+        }
+        cullStats.objectsDrawn++;
+        return false;
+    }
+
+public:
+    RenderBackend(int width, int height)
+        : width(width), height(height),
+          occlusionBuffer(width / OCCLUSION_DOWNSCALE, height / OCCLUSION_DOWNSCALE) {
+        pipeline.resetTransformations();
+        
+        pipeline.setViewTransform(
+            Vector3(0.0f, 0.0f, 5.0f),
+            Vector3(0.0f, 0.0f, 0.0f),
+            Vector3(0.0f, 1.0f, 0.0f)
+        );
+        
+        pipeline.setProjection(45.0f, static_cast<float>(width) / height, 0.1f, 100.0f);
+    }
+    
+    virtual ~RenderBackend() {}
+    
+    void setModelTransform(const Vector3& translation, const Vector3& rotation, const Vector3& scale) {
+        pipeline.setModelTransform(translation, rotation, scale);
+    }
+    
+    void setModelTransform(const Vector3& translation, const Quaternion& rotation, const Vector3& scale) {
+        pipeline.setModelTransform(translation, rotation, scale);
+    }
+    
+    void setCameraPosition(const Vector3& position, const Vector3& target, const Vector3& up) {
+        pipeline.setViewTransform(position, target, up);
+    }
+    
+    void toggleWireframe() {
+        wireframeMode = !wireframeMode;
+    }
+    
+    void setModelMatrix(const Matrix4x4& matrix) {
+        pipeline.setModelMatrix(matrix);
+    }
+    
+    void setFrustumCulling(bool enabled) {
+        frustumCullingEnabled = enabled;
+    }
+    
+    bool isFrustumCullingEnabled() const {
+        return frustumCullingEnabled;
+    }
+    
+    // Hierarchical-Z occlusion culling against the occluders added this
+    // frame; only applies to filled, depth-tested drawing
+    void setOcclusionCulling(bool enabled) {
+        occlusionCullingEnabled = enabled;
+    }
+    
+    bool isOcclusionCullingEnabled() const {
+        return occlusionCullingEnabled;
+    }
+    
+    // Facing is only tested on filled triangles; lines are never culled
+    void setCullMode(CullMode mode) {
+        cullMode = mode;
+    }
+    
+    CullMode getCullMode() const {
+        return cullMode;
+    }
+    
+    // Rasterizes the object under the current model transform into the
+    // occlusion buffer. Add a few large occluders after beginFrame() and
+    // before the objects they hide; they are not drawn by this call.
+    void addOccluder(const Object3D& object) {
+        if (frameOcclusion) occlusionBuffer.addOccluder(object, pipeline.getMVPMatrix());
+    }
+    
+    const HiZBuffer& getOcclusionBuffer() const {
+        return occlusionBuffer;
+    }
+    
+    // Level of the chain to draw under the current model transform, from
+    // the level the object was drawn at last time
+    size_t selectLOD(const LODChain& chain, size_t current) const {
+        if (chain.levels.empty()) return 0;
+        float size = LODChain::screenSize(chain.level(0).boundingSphere, pipeline.getModelViewMatrix(),
+                                          pipeline.projectionMatrix, height);
+        return chain.select(size, current);
+    }
+    
+    // Objects tested, culled, occluded and drawn since the last beginFrame()
+    const CullStats& getCullStats() const {
+        return cullStats;
+    }
+    
+    void toggleDepthTest() {
+        depthTestEnabled = !depthTestEnabled;
+    }
+    
+    bool isWireframeMode() const {
+        return wireframeMode;
+    }
+    
+    bool isDepthTestEnabled() const {
+        return depthTestEnabled;
+    }
+    
+    int getWidth() const {
+        return width;
+    }
+    
+    int getHeight() const {
+        return height;
+    }
+    
+    virtual void beginFrame() = 0;
+    virtual void renderObject(const Object3D& object) = 0;
+    
+    // Draws count copies of the object in one batched pass. Each instance
+    // transform is applied inside the current model transform, and its
+    // color replaces the object's. Instances outside the frustum are culled
+    // individually. The array must stay alive until endFrame().
+    virtual void renderInstances(const Object3D& object, const InstanceData* instances, size_t count) = 0;
+    
+    void renderInstances(const Object3D& object, const std::vector<InstanceData>& instances) {
+        renderInstances(object, instances.data(), instances.size());
+    }
+    virtual void endFrame() = 0;
+};
+
+#endif
\ No newline at end of file
@@ -1,62 +1,82 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
-// macOS specific OpenGL includes
+// OpenGL and GLUT from the macOS frameworks, or Mesa and freeglut elsewhere
+#ifdef __APPLE__
 #define GL_SILENCE_DEPRECATION
 #include <OpenGL/gl.h>
 #include <GLUT/glut.h>
+#else
+// Buffer object entry points are prototypes only with this on Mesa
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glut.h>
+#endif
 
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include "Vector3.h"
+#include "Vector4.h"
+#include "Clipper.h"
 #include "Object3D.h"
-#include "TransformationPipeline.h"
+#include "RenderBackend.h"
+#include "InstanceData.h"
+#include "ThreadPool.h"
+#include "FrameProfiler.h"
 
-class Renderer {
+class Renderer : public RenderBackend {
 private:
-    int width;
-    int height;
-    TransformationPipeline pipeline;
-    bool wireframeMode = true;
-    bool depthTestEnabled = true;
+    // Every vertex is transformed once per draw, not once per edge or face.
+    // Vertices stay homogeneous so that GL clips them before the divide;
+    // the outcodes only drop primitives that are entirely outside.
+    std::vector<Vector4> clipVertices;
+    std::vector<uint32_t> outcodes;
     
-public:
-    Renderer(int width, int height) : width(width), height(height) {
-        pipeline.resetTransformations();
-        
-        pipeline.setViewTransform(
-            Vector3(0.0f, 0.0f, 5.0f),
-            Vector3(0.0f, 0.0f, 0.0f),
-            Vector3(0.0f, 1.0f, 0.0f)
-        );
-        
-        pipeline.setProjection(45.0f, static_cast<float>(width) / height, 0.1f, 100.0f);
-    }
+    // Instanced draws: every visible copy is transformed into one vertex
+    // array and drawn with a single glDrawElements
+    std::vector<Vector4> instanceVertices;
+    std::vector<float> instanceColors;
+    std::vector<GLuint> instanceIndices;
+    std::vector<GLuint> indexPattern;
+    std::vector<size_t> visibleInstances;
+    uint64_t patternRevision = 0;
+    bool patternWireframe = false;
     
-    void setModelTransform(const Vector3& translation, const Vector3& rotation, const Vector3& scale) {
-        pipeline.setModelTransform(translation, rotation, scale);
-    }
-    
-    void setCameraPosition(const Vector3& position, const Vector3& target, const Vector3& up) {
-        pipeline.setViewTransform(position, target, up);
-    }
-    
-    void toggleWireframe() {
-        wireframeMode = !wireframeMode;
-    }
-    
-    void toggleDepthTest() {
-        depthTestEnabled = !depthTestEnabled;
-    }
-
-    bool isWireframeMode() const {
-        return wireframeMode;
+    // Indices of one copy: edges as lines, or faces fanned into triangles.
+    // Cached per object revision; instanceIndices repeats it with offsets.
+    void buildIndexPattern(const Object3D& object) {
+        if (!indexPattern.empty() && patternRevision == object.revision && patternWireframe == wireframeMode) return;
+        indexPattern.clear();
+        instanceIndices.clear();
+        if (wireframeMode) {
+            for (const auto& edge : object.edges) {
+                indexPattern.push_back(static_cast<GLuint>(edge.first));
+                indexPattern.push_back(static_cast<GLuint>(edge.second));
+            }
+        } else {
+            for (const auto& face : object.faces) {
+                for (size_t i = 2; i < face.size(); i++) {
+                    indexPattern.push_back(static_cast<GLuint>(face[0]));
+                    indexPattern.push_back(static_cast<GLuint>(face[i - 1]));
+                    indexPattern.push_back(static_cast<GLuint>(face[i]));
+                }
+            }
+        }
+        patternRevision = object.revision;
+        patternWireframe = wireframeMode;
     }
 
-    bool isDepthTestEnabled() const {
-        return depthTestEnabled;
-    }
+public:
+    Renderer(int width, int height) : RenderBackend(width, height) {}
     
-    void beginFrame() {
+    void beginFrame() override {
+        cullStats.reset();
+        occlusionBuffer.clear();
+        beginFrameCulling();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
         if (depthTestEnabled) {
@@ -70,26 +90,63 @@ public:
         } else {
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         }
+        
+        if (frameCullMode == CullMode::None) {
+            glDisable(GL_CULL_FACE);
+        } else {
+            glEnable(GL_CULL_FACE);
+            glFrontFace(GL_CCW);
+            glCullFace(frameCullMode == CullMode::Back ? GL_BACK : frameCullMode == CullMode::Front ? GL_FRONT : GL_FRONT_AND_BACK);
+        }
     }
     
-    void renderObject(const Object3D& object) {
+    void renderObject(const Object3D& object) override {
+        if (cullObject(object)) return;
+        
         glColor3f(object.color[0], object.color[1], object.color[2]);
         
+        size_t count = object.vertices.size();
+        {
+            PROFILE_ZONE("transform");
+            clipVertices.resize(count);
+            outcodes.resize(count);
+            pipeline.transformToClipSpace(object.vertices.data(), count, clipVertices.data());
+            for (size_t i = 0; i < count; i++) {
+                outcodes[i] = Clipper::outcode(clipVertices[i]);
+            }
+        }
+        
         if (wireframeMode) {
             glBegin(GL_LINES);
             for (const auto& edge : object.edges) {
-                const Vector3& v1 = object.vertices[edge.first];
-                const Vector3& v2 = object.vertices[edge.second];
-                
-                Vector3 transformedV1 = pipeline.applyMVP(v1);
-                Vector3 transformedV2 = pipeline.applyMVP(v2);
+                if (outcodes[edge.first] & outcodes[edge.second] & Clipper::REJECT_PLANES) continue;
+                const Vector4& v1 = clipVertices[edge.first];
+                const Vector4& v2 = clipVertices[edge.second];
                 
-                glVertex3f(transformedV1.x, transformedV1.y, transformedV1.z);
-                glVertex3f(transformedV2.x, transformedV2.y, transformedV2.z);
+                glVertex4f(v1.x, v1.y, v1.z, v1.w);
+                glVertex4f(v2.x, v2.y, v2.z, v2.w);
             }
             glEnd();
         } else {
             for (const auto& face : object.faces) {
+                if (face.size() < 3) continue;
+                
+                uint32_t allCodes = ~0u;
+                uint32_t anyCodes = 0;
+                for (int vertexIndex : face) {
+                    allCodes &= outcodes[vertexIndex];
+                    anyCodes |= outcodes[vertexIndex];
+                }
+                if (allCodes & Clipper::REJECT_PLANES) {
+                    cullStats.trianglesRejected += face.size() - 2;
+                    continue;
+                }
+                if (anyCodes & Clipper::CLIP_PLANES) {
+                    cullStats.trianglesClipped += face.size() - 2;
+                } else {
+                    cullStats.trianglesAccepted += face.size() - 2;
+                }
+                
                 if (face.size() == 3) {
                     glBegin(GL_TRIANGLES);
                 } else {
@@ -97,9 +154,8 @@ public:
                 }
                 
                 for (int vertexIndex : face) {
-                    const Vector3& vertex = object.vertices[vertexIndex];
-                    Vector3 transformed = pipeline.applyMVP(vertex);
-                    glVertex3f(transformed.x, transformed.y, transformed.z);
+                    const Vector4& v = clipVertices[vertexIndex];
+                    glVertex4f(v.x, v.y, v.z, v.w);
                 }
                 
                 glEnd();
@@ -107,8 +163,75 @@ public:
         }
     }
     
-    void endFrame() {
+    using RenderBackend::renderInstances;
+    
+    void renderInstances(const Object3D& object, const InstanceData* instances, size_t count) override {
+        // Planes in the space the instance transforms map into
+        const Matrix4x4& mvp = pipeline.getMVPMatrix();
+        Frustum frustum = Frustum::fromMatrix(mvp);
+        bool cull = (frameFrustumCulling || frameOcclusion) && !object.bounds.isEmpty();
+        
+        visibleInstances.clear();
+        for (size_t i = 0; i < count; i++) {
+            if (cull) {
+                cullStats.objectsTested++;
+                Matrix4x4 instanceMatrix = instances[i].matrix();
+                if (frameFrustumCulling && !frustum.intersects(object.bounds.transformed(instanceMatrix))) {
+                    cullStats.objectsCulled++;
+                    continue;
+                }
+                if (isOccluded(object.bounds, mvp * instanceMatrix)) {
+                    cullStats.objectsCulled++;
+                    cullStats.objectsOccluded++;
+                    continue;
+                }
+            }
+            visibleInstances.push_back(i);
+        }
+        cullStats.objectsDrawn += visibleInstances.size();
+        if (visibleInstances.empty()) return;
+        
+        size_t vertexCount = object.vertices.size();
+        size_t visible = visibleInstances.size();
+        instanceVertices.resize(visible * vertexCount);
+        instanceColors.resize(visible * vertexCount * 3);
+        {
+            PROFILE_ZONE("transform");
+            ThreadPool::shared().parallelForRange(visible, 64, [&](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; k++) {
+                    const InstanceData& instance = instances[visibleInstances[k]];
+                    Matrix4x4 instanceMVP = mvp * instance.matrix();
+                    instanceMVP.transformPointsToClip(object.vertices.data(), vertexCount, &instanceVertices[k * vertexCount]);
+                    float* colors = &instanceColors[k * vertexCount * 3];
+                    for (size_t v = 0; v < vertexCount; v++) {
+                        colors[v * 3] = instance.color[0];
+                        colors[v * 3 + 1] = instance.color[1];
+                        colors[v * 3 + 2] = instance.color[2];
+                    }
+                }
+            });
+        }
+        
+        buildIndexPattern(object);
+        size_t patternSize = indexPattern.size();
+        for (size_t copy = instanceIndices.size() / std::max<size_t>(patternSize, 1); copy < visible; copy++) {
+            GLuint offset = static_cast<GLuint>(copy * vertexCount);
+            for (GLuint index : indexPattern) instanceIndices.push_back(index + offset);
+        }
+        
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glVertexPointer(4, GL_FLOAT, sizeof(Vector4), instanceVertices.data());
+        glColorPointer(3, GL_FLOAT, 0, instanceColors.data());
+        glDrawElements(wireframeMode ? GL_LINES : GL_TRIANGLES, static_cast<GLsizei>(visible * patternSize),
+                       GL_UNSIGNED_INT, instanceIndices.data());
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+    
+    void endFrame() override {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        glDisable(GL_CULL_FACE);
     }
 };
 
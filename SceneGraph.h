@@ -0,0 +1,326 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "Vector3.h"
+#include "Matrix4x4.h"
+#include "Quaternion.h"
+#include "TransformationPipeline.h"
+#include "ThreadPool.h"
+
+// Transform hierarchy for large scenes. Nodes are addressed by stable ids;
+// their data lives in flat arrays sorted by depth, so every parent precedes
+// its children and each depth level is one contiguous range. update()
+// streams through the levels in order and processes each level in
+// parallel. A world matrix is recomputed only when its own local transform
+// changed or its parent's world matrix was recomputed in the same pass.
+//
+// Structural edits (add, remove, reparent) re-sort the arrays on the next
+// update(); transform edits only mark the node.
+class SceneGraph {
+public:
+    typedef uint32_t NodeId;
+    enum : NodeId { INVALID_NODE = UINT32_MAX };
+    
+    // Objects a node draws, usually an index into the application's objects
+    static const int NO_OBJECT = -1;
+
+private:
+    enum : uint32_t { NO_SLOT = UINT32_MAX };
+    static const size_t MIN_CHUNK = 512;
+    
+    // Per slot, in depth order
+    std::vector<NodeId> ids;
+    std::vector<uint32_t> parentSlots;
+    std::vector<Matrix4x4> localMatrices;
+    std::vector<Matrix4x4> worldMatrices;
+    std::vector<int> objectIndices;
+    std::vector<uint8_t> localDirty;
+    // Pass in which the world matrix was last rewritten
+    std::vector<uint32_t> worldStamps;
+    
+    // Slot ranges of each depth: level d is [levelOffsets[d], levelOffsets[d + 1])
+    std::vector<uint32_t> levelOffsets;
+    
+    // Per id
+    std::vector<uint32_t> slotOf;
+    std::vector<NodeId> parentOf;
+    std::vector<NodeId> freeIds;
+    
+    uint32_t stamp = 0;
+    bool structureDirty = false;
+    size_t firstDirtyLevel = SIZE_MAX;
+    
+    uint32_t slotFor(NodeId id) const {
+        if (id >= slotOf.size() || slotOf[id] == NO_SLOT) {
+            throw std::out_of_range("SceneGraph: invalid node id");
+        }
+        return slotOf[id];
+    }
+    
+    size_t levelOfSlot(uint32_t slot) const {
+        return std::upper_bound(levelOffsets.begin(), levelOffsets.end(), slot) - levelOffsets.begin() - 1;
+    }
+    
+    void markLocalDirty(uint32_t slot) {
+        localDirty[slot] = 1;
+        if (!structureDirty) firstDirtyLevel = std::min(firstDirtyLevel, levelOfSlot(slot));
+    }
+    
+    // Sorts the live nodes by depth (counting sort); stable, so siblings keep
+    // their relative order. Every node is marked dirty.
+    void rebuildOrder() {
+        size_t count = ids.size();
+        std::vector<uint32_t> depth(count, NO_SLOT);
+        std::vector<uint32_t> chain;
+        uint32_t maxDepth = 0;
+        
+        for (uint32_t slot = 0; slot < count; slot++) {
+            // Walk up to the first node of known depth, then assign on the way back
+            uint32_t s = slot;
+            while (s != NO_SLOT && depth[s] == NO_SLOT) {
+                chain.push_back(s);
+                NodeId parent = parentOf[ids[s]];
+                s = parent == INVALID_NODE ? NO_SLOT : slotOf[parent];
+            }
+            uint32_t d = s == NO_SLOT ? 0 : depth[s] + 1;
+            while (!chain.empty()) {
+                depth[chain.back()] = d++;
+                chain.pop_back();
+            }
+            maxDepth = std::max(maxDepth, depth[slot]);
+        }
+        
+        levelOffsets.assign(count > 0 ? maxDepth + 2 : 1, 0);
+        for (uint32_t slot = 0; slot < count; slot++) levelOffsets[depth[slot] + 1]++;
+        for (size_t d = 1; d < levelOffsets.size(); d++) levelOffsets[d] += levelOffsets[d - 1];
+        
+        std::vector<uint32_t> order(count);
+        std::vector<uint32_t> cursor(levelOffsets.begin(), levelOffsets.end() - 1);
+        for (uint32_t slot = 0; slot < count; slot++) order[cursor[depth[slot]]++] = slot;
+        
+        std::vector<NodeId> sortedIds(count);
+        std::vector<Matrix4x4> sortedLocals(count);
+        std::vector<int> sortedObjects(count);
+        for (uint32_t i = 0; i < count; i++) {
+            sortedIds[i] = ids[order[i]];
+            sortedLocals[i] = localMatrices[order[i]];
+            sortedObjects[i] = objectIndices[order[i]];
+            slotOf[sortedIds[i]] = i;
+        }
+        ids.swap(sortedIds);
+        localMatrices.swap(sortedLocals);
+        objectIndices.swap(sortedObjects);
+        
+        parentSlots.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            NodeId parent = parentOf[ids[i]];
+            parentSlots[i] = parent == INVALID_NODE ? NO_SLOT : slotOf[parent];
+        }
+        worldMatrices.resize(count);
+        localDirty.assign(count, 1);
+        worldStamps.assign(count, 0);
+        
+        structureDirty = false;
+        firstDirtyLevel = 0;
+    }
+    
+    void updateRange(size_t begin, size_t end) {
+        for (size_t slot = begin; slot < end; slot++) {
+            uint32_t parent = parentSlots[slot];
+            bool parentChanged = parent != NO_SLOT && worldStamps[parent] == stamp;
+            if (!localDirty[slot] && !parentChanged) continue;
+            
+            worldMatrices[slot] = parent == NO_SLOT ? localMatrices[slot] : worldMatrices[parent] * localMatrices[slot];
+            worldStamps[slot] = stamp;
+            localDirty[slot] = 0;
+        }
+    }
+
+public:
+    NodeId addNode(NodeId parent, const Matrix4x4& local = Matrix4x4(), int objectIndex = NO_OBJECT) {
+        if (parent != INVALID_NODE) slotFor(parent);
+        
+        NodeId id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+        } else {
+            id = static_cast<NodeId>(slotOf.size());
+            slotOf.push_back(NO_SLOT);
+            parentOf.push_back(INVALID_NODE);
+        }
+        
+        // Appended out of order; the next update() sorts it into its level
+        slotOf[id] = static_cast<uint32_t>(ids.size());
+        parentOf[id] = parent;
+        ids.push_back(id);
+        parentSlots.push_back(NO_SLOT);
+        localMatrices.push_back(local);
+        worldMatrices.push_back(local);
+        objectIndices.push_back(objectIndex);
+        localDirty.push_back(1);
+        worldStamps.push_back(0);
+        structureDirty = true;
+        return id;
+    }
+    
+    NodeId addNode(NodeId parent, const Vector3& translation, const Vector3& rotation,
+                   const Vector3& scale, int objectIndex = NO_OBJECT) {
+        return addNode(parent, TransformationPipeline::composeModelMatrix(translation, rotation, scale), objectIndex);
+    }
+    
+    NodeId addNode(NodeId parent, const Vector3& translation, const Quaternion& rotation,
+                   const Vector3& scale, int objectIndex = NO_OBJECT) {
+        return addNode(parent, TransformationPipeline::composeModelMatrix(translation, rotation, scale), objectIndex);
+    }
+    
+    // Removes the node and its whole subtree
+    void removeNode(NodeId id) {
+        slotFor(id);
+        std::vector<uint8_t> removed(slotOf.size(), 0);
+        removed[id] = 1;
+        
+        // Parents are not necessarily visited first while the order is stale,
+        // so repeat until no more descendants are found
+        bool found = true;
+        while (found) {
+            found = false;
+            for (NodeId node : ids) {
+                NodeId parent = parentOf[node];
+                if (!removed[node] && parent != INVALID_NODE && removed[parent]) {
+                    removed[node] = 1;
+                    found = true;
+                }
+            }
+        }
+        
+        size_t kept = 0;
+        for (size_t slot = 0; slot < ids.size(); slot++) {
+            NodeId node = ids[slot];
+            if (removed[node]) {
+                slotOf[node] = NO_SLOT;
+                parentOf[node] = INVALID_NODE;
+                freeIds.push_back(node);
+                continue;
+            }
+            ids[kept] = node;
+            localMatrices[kept] = localMatrices[slot];
+            objectIndices[kept] = objectIndices[slot];
+            slotOf[node] = static_cast<uint32_t>(kept);
+            kept++;
+        }
+        ids.resize(kept);
+        localMatrices.resize(kept);
+        objectIndices.resize(kept);
+        parentSlots.resize(kept);
+        worldMatrices.resize(kept);
+        localDirty.resize(kept);
+        worldStamps.resize(kept);
+        structureDirty = true;
+    }
+    
+    void setParent(NodeId id, NodeId parent) {
+        slotFor(id);
+        for (NodeId ancestor = parent; ancestor != INVALID_NODE; ancestor = parentOf[ancestor]) {
+            slotFor(ancestor);
+            if (ancestor == id) throw std::invalid_argument("SceneGraph: reparenting would create a cycle");
+        }
+        parentOf[id] = parent;
+        structureDirty = true;
+    }
+    
+    void setLocalMatrix(NodeId id, const Matrix4x4& local) {
+        uint32_t slot = slotFor(id);
+        localMatrices[slot] = local;
+        markLocalDirty(slot);
+    }
+    
+    void setLocalTransform(NodeId id, const Vector3& translation, const Vector3& rotation, const Vector3& scale) {
+        setLocalMatrix(id, TransformationPipeline::composeModelMatrix(translation, rotation, scale));
+    }
+    
+    void setLocalTransform(NodeId id, const Vector3& translation, const Quaternion& rotation, const Vector3& scale) {
+        setLocalMatrix(id, TransformationPipeline::composeModelMatrix(translation, rotation, scale));
+    }
+    
+    void setObject(NodeId id, int objectIndex) {
+        objectIndices[slotFor(id)] = objectIndex;
+    }
+    
+    // Brings every world matrix up to date. Levels above the shallowest dirty
+    // node are skipped, and nodes in clean subtrees are only tested.
+    void update(ThreadPool& pool = ThreadPool::shared()) {
+        if (structureDirty) rebuildOrder();
+        
+        // Every call is a new pass, so worldChanged() reports only this one
+        stamp++;
+        if (stamp == 0) {
+            // Wrapped: old stamps could look current
+            std::fill(worldStamps.begin(), worldStamps.end(), 0u);
+            stamp = 1;
+        }
+        if (firstDirtyLevel == SIZE_MAX) return;
+        
+        for (size_t level = firstDirtyLevel; level + 1 < levelOffsets.size(); level++) {
+            size_t begin = levelOffsets[level];
+            size_t end = levelOffsets[level + 1];
+            pool.parallelForRange(end - begin, MIN_CHUNK, [&](size_t first, size_t last) {
+                updateRange(begin + first, begin + last);
+            });
+        }
+        firstDirtyLevel = SIZE_MAX;
+    }
+    
+    bool needsUpdate() const {
+        return structureDirty || firstDirtyLevel != SIZE_MAX;
+    }
+    
+    bool contains(NodeId id) const {
+        return id < slotOf.size() && slotOf[id] != NO_SLOT;
+    }
+    
+    NodeId parent(NodeId id) const {
+        slotFor(id);
+        return parentOf[id];
+    }
+    
+    const Matrix4x4& localMatrix(NodeId id) const {
+        return localMatrices[slotFor(id)];
+    }
+    
+    // Updates first if anything changed since the last update()
+    const Matrix4x4& worldMatrix(NodeId id) {
+        if (needsUpdate()) update();
+        return worldMatrices[slotFor(id)];
+    }
+    
+    // True when the last update() rewrote the node's world matrix
+    bool worldChanged(NodeId id) const {
+        return worldStamps[slotFor(id)] == stamp;
+    }
+    
+    int object(NodeId id) const {
+        return objectIndices[slotFor(id)];
+    }
+    
+    size_t size() const {
+        return ids.size();
+    }
+    
+    size_t depthCount() const {
+        return structureDirty ? 0 : levelOffsets.size() - 1;
+    }
+    
+    // Flat views in depth order for drawing and culling after update();
+    // slot i belongs to node nodeIds()[i]
+    const NodeId* nodeIds() const { return ids.data(); }
+    const Matrix4x4* worldMatrixArray() const { return worldMatrices.data(); }
+    const int* objectIndexArray() const { return objectIndices.data(); }
+};
+
+#endif
\ No newline at end of file
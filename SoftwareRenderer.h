@@ -0,0 +1,788 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "Vector3.h"
+#include "Vector4.h"
+#include "Matrix4x4.h"
+#include "MathKernels.h"
+#include "Object3D.h"
+#include "RenderBackend.h"
+#include "Texture.h"
+#include "Frustum.h"
+#include "HiZBuffer.h"
+#include "InstanceData.h"
+#include "ThreadPool.h"
+#include "FrameProfiler.h"
+#include "FrameAllocator.h"
+#include "Clipper.h"
+
+// Headless backend that rasterizes into in-memory color and depth buffers.
+// renderObject only records the draw; endFrame transforms every draw, bins
+// the resulting primitives into screen tiles and rasterizes the tiles in
+// parallel. Objects and bound textures must stay alive until endFrame
+// returns.
+class SoftwareRenderer : public RenderBackend {
+public:
+    static const int TILE_SIZE = 64;
+
+private:
+    struct DrawCall {
+        const Object3D* object;
+        const Texture* texture;
+        Matrix4x4 modelView;
+        Matrix4x4 projection;
+        bool wireframe;
+        bool lit;
+        CullMode cullMode;
+        // Instanced draws only: copies drawn inside modelView, the frustum
+        // in the space their transforms map into, and the occluders to test
+        // them against (null when occlusion culling is off)
+        const InstanceData* instances;
+        size_t instanceCount;
+        bool cullInstances;
+        Frustum instanceFrustum;
+        const HiZBuffer* occlusion;
+    };
+    
+    // Part of a draw that one task transforms and sets up. Instanced draws
+    // are split so their copies spread over the pool.
+    struct DrawItem {
+        size_t draw;
+        size_t firstInstance;
+        size_t instanceCount;
+    };
+    
+    static const size_t INSTANCES_PER_ITEM = 256;
+    
+    // Texture coordinates are stored divided by w for perspective-correct
+    // interpolation
+    struct ScreenVertex {
+        float x, y, z;
+        float invW, uOverW, vOverW;
+    };
+    
+    struct Triangle {
+        ScreenVertex v[3];
+        int minX, minY, maxX, maxY;
+        uint32_t color;
+        const Texture* texture;
+        float lod;
+    };
+    
+    struct Line {
+        ScreenVertex a, b;
+        int minX, minY, maxX, maxY;
+        uint32_t color;
+    };
+    
+    // Per-vertex buffers of the draw a task is transforming. Pooled, so
+    // there are only as many as tasks running at once and their capacity
+    // carries over between frames.
+    struct VertexScratch {
+        std::vector<Vector3> viewPositions;
+        std::vector<Vector4> clip;
+        std::vector<ScreenVertex> screen;
+        std::vector<uint32_t> outcodes;
+        std::vector<Clipper::Vertex> polygon;
+        std::vector<Clipper::Vertex> clipScratch;
+        // Triangles waiting for setup, three corners each, with their
+        // corners' x and y coordinates gathered for the area kernel
+        std::vector<ScreenVertex> corners;
+        std::vector<uint32_t> colors;
+        std::vector<Vector3> cornersX;
+        std::vector<Vector3> cornersY;
+        std::vector<float> areas;
+    };
+    
+    struct DrawGeometry {
+        std::vector<Triangle> triangles;
+        std::vector<Line> lines;
+        size_t trianglesAccepted;
+        size_t trianglesClipped;
+        size_t trianglesRejected;
+        size_t trianglesCulledFacing;
+        size_t trianglesCulledSmall;
+        size_t instancesTested;
+        size_t instancesCulled;
+        size_t instancesOccluded;
+    };
+    
+    ThreadPool& pool;
+    std::vector<uint32_t> colorBuffer;
+    std::vector<float> depthBuffer;
+    uint32_t clearColor;
+    int tilesX;
+    int tilesY;
+    bool frameDepthTest = true;
+    const Texture* boundTexture = nullptr;
+    bool lightingEnabled = true;
+    Texture::Filter textureFilter = Texture::Filter::Trilinear;
+    Texture::Filter frameTextureFilter = Texture::Filter::Trilinear;
+    
+    std::vector<DrawCall> draws;
+    // Holds the draw items of the frame being ended
+    FrameArena frameArena;
+    DrawItem* items = nullptr;
+    size_t itemCount = 0;
+    std::vector<DrawGeometry> geometry;
+    mutable ObjectPool<VertexScratch> scratchPool;
+    std::vector<Triangle> triangles;
+    std::vector<Line> lines;
+    size_t binChunks = 0;
+    std::vector<std::vector<uint32_t>> triangleBins;
+    std::vector<std::vector<uint32_t>> lineBins;
+    
+    static uint32_t packColor(float r, float g, float b) {
+        uint32_t ri = static_cast<uint32_t>(std::min(std::max(r, 0.0f), 1.0f) * 255.0f + 0.5f);
+        uint32_t gi = static_cast<uint32_t>(std::min(std::max(g, 0.0f), 1.0f) * 255.0f + 0.5f);
+        uint32_t bi = static_cast<uint32_t>(std::min(std::max(b, 0.0f), 1.0f) * 255.0f + 0.5f);
+        return ri | (gi << 8) | (bi << 16) | 0xFF000000u;
+    }
+    
+    // Per-channel product of two RGBA8 colors, like GL_MODULATE
+    static uint32_t modulateColor(uint32_t a, uint32_t b) {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            uint32_t product = ((a >> shift) & 0xFF) * ((b >> shift) & 0xFF);
+            result |= ((product + 255) >> 8) << shift;
+        }
+        return result;
+    }
+    
+    static float edgeFunction(const ScreenVertex& a, const ScreenVertex& b, float px, float py) {
+        return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+    }
+    
+    // Edges owning the pixels that lie exactly on them (positive-area winding, y down)
+    static bool isTopLeft(const ScreenVertex& a, const ScreenVertex& b) {
+        float dx = b.x - a.x;
+        float dy = b.y - a.y;
+        return dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+    }
+    
+    static bool insideEdge(float w, bool topLeft) {
+        return w > 0.0f || (w == 0.0f && topLeft);
+    }
+    
+    int tileCount() const {
+        return tilesX * tilesY;
+    }
+    
+    void transformDraw(const DrawCall& draw, const Matrix4x4& modelView, VertexScratch& scratch) const {
+        const Object3D& object = *draw.object;
+        size_t count = object.vertices.size();
+        
+        scratch.viewPositions.resize(count);
+        scratch.clip.resize(count);
+        scratch.screen.resize(count);
+        scratch.outcodes.resize(count);
+        
+        modelView.transformPoints(object.vertices.data(), count, scratch.viewPositions.data());
+        draw.projection.transformPointsToClip(scratch.viewPositions.data(), count, scratch.clip.data());
+        
+        // Vertices that need clipping are projected after it instead
+        for (size_t i = 0; i < count; i++) {
+            const Vector4& c = scratch.clip[i];
+            scratch.outcodes[i] = Clipper::outcode(c);
+            if (scratch.outcodes[i] & Clipper::CLIP_PLANES) continue;
+            scratch.screen[i] = toScreen(c, draw.texture ? object.texCoords[i].first : 0.0f,
+                                         draw.texture ? object.texCoords[i].second : 0.0f);
+        }
+    }
+    
+    ScreenVertex toScreen(const Vector4& c, float u, float v) const {
+        float invW = 1.0f / c.w;
+        ScreenVertex s;
+        s.x = (c.x * invW + 1.0f) * 0.5f * width;
+        s.y = (1.0f - c.y * invW) * 0.5f * height;
+        s.z = c.z * invW * 0.5f + 0.5f;
+        s.invW = invW;
+        s.uOverW = u * invW;
+        s.vOverW = v * invW;
+        return s;
+    }
+    
+    Clipper::Vertex clipVertex(const DrawCall& draw, const VertexScratch& scratch, int index) const {
+        Clipper::Vertex vertex;
+        vertex.position = scratch.clip[index];
+        vertex.u = draw.texture ? draw.object->texCoords[index].first : 0.0f;
+        vertex.v = draw.texture ? draw.object->texCoords[index].second : 0.0f;
+        return vertex;
+    }
+    
+    void queueTriangle(const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c,
+                       uint32_t color, VertexScratch& scratch) const {
+        scratch.corners.push_back(a);
+        scratch.corners.push_back(b);
+        scratch.corners.push_back(c);
+        scratch.colors.push_back(color);
+        scratch.cornersX.push_back(Vector3(a.x, b.x, c.x));
+        scratch.cornersY.push_back(Vector3(a.y, b.y, c.y));
+    }
+    
+    // Signed areas of all queued triangles in one batch, then setup of the
+    // ones that survive the cull mode. Counter-clockwise on screen is a
+    // negative area here, since y points down.
+    void setupTriangles(const DrawCall& draw, VertexScratch& scratch, DrawGeometry& geo) const {
+        size_t count = scratch.colors.size();
+        scratch.areas.resize(count);
+        MathKernels::triangleAreas(scratch.cornersX.data(), scratch.cornersY.data(), count, scratch.areas.data());
+        
+        bool cullFront = draw.cullMode == CullMode::Front || draw.cullMode == CullMode::FrontAndBack;
+        bool cullBack = draw.cullMode == CullMode::Back || draw.cullMode == CullMode::FrontAndBack;
+        for (size_t i = 0; i < count; i++) {
+            float area = scratch.areas[i];
+            bool front = area < 0.0f;
+            bool back = area > 0.0f;
+            if ((front && cullFront) || (back && cullBack)) {
+                geo.trianglesCulledFacing++;
+            } else if (!front && !back) {
+                geo.trianglesCulledSmall++;
+            } else {
+                const ScreenVertex* corner = &scratch.corners[i * 3];
+                setupTriangle(corner[0], corner[1], corner[2], area, scratch.colors[i], draw.texture, geo);
+            }
+        }
+        scratch.corners.clear();
+        scratch.colors.clear();
+        scratch.cornersX.clear();
+        scratch.cornersY.clear();
+    }
+    
+    void setupTriangle(ScreenVertex a, ScreenVertex b, ScreenVertex c, float area,
+                       uint32_t color, const Texture* texture, DrawGeometry& geo) const {
+        if (area < 0.0f) std::swap(b, c);
+        
+        float minX = std::min(a.x, std::min(b.x, c.x));
+        float maxX = std::max(a.x, std::max(b.x, c.x));
+        float minY = std::min(a.y, std::min(b.y, c.y));
+        float maxY = std::max(a.y, std::max(b.y, c.y));
+        if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) return;
+        
+        // Slivers and specks whose bounding box lies between two rows or
+        // columns of pixel centers cover nothing
+        if (std::ceil(minX - 0.5f) > std::floor(maxX - 0.5f) || std::ceil(minY - 0.5f) > std::floor(maxY - 0.5f)) {
+            geo.trianglesCulledSmall++;
+            return;
+        }
+        
+        Triangle tri;
+        tri.v[0] = a;
+        tri.v[1] = b;
+        tri.v[2] = c;
+        tri.minX = std::max(0, static_cast<int>(std::floor(minX)));
+        tri.minY = std::max(0, static_cast<int>(std::floor(minY)));
+        tri.maxX = std::min(width - 1, static_cast<int>(std::floor(maxX)));
+        tri.maxY = std::min(height - 1, static_cast<int>(std::floor(maxY)));
+        tri.color = color;
+        tri.texture = texture;
+        tri.lod = 0.0f;
+        if (texture != nullptr) {
+            // One level of detail per triangle, from its texel to pixel area ratio
+            float ua = a.uOverW / a.invW, va = a.vOverW / a.invW;
+            float ub = b.uOverW / b.invW, vb = b.vOverW / b.invW;
+            float uc = c.uOverW / c.invW, vc = c.vOverW / c.invW;
+            float texelArea = std::abs((ub - ua) * (vc - va) - (uc - ua) * (vb - va))
+                            * texture->width() * texture->height();
+            tri.lod = Texture::lodFor(std::sqrt(texelArea / std::abs(area)));
+        }
+        geo.triangles.push_back(tri);
+    }
+    
+    void setupLine(const ScreenVertex& a, const ScreenVertex& b,
+                   uint32_t color, std::vector<Line>& out) const {
+        float minX = std::min(a.x, b.x);
+        float maxX = std::max(a.x, b.x);
+        float minY = std::min(a.y, b.y);
+        float maxY = std::max(a.y, b.y);
+        if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) return;
+        
+        Line line;
+        line.a = a;
+        line.b = b;
+        line.minX = std::max(0, static_cast<int>(std::floor(minX)));
+        line.minY = std::max(0, static_cast<int>(std::floor(minY)));
+        line.maxX = std::min(width - 1, static_cast<int>(std::floor(maxX)));
+        line.maxY = std::min(height - 1, static_cast<int>(std::floor(maxY)));
+        line.color = color;
+        out.push_back(line);
+    }
+    
+    void buildPrimitives(const DrawCall& draw, const float* baseColor, VertexScratch& scratch,
+                         DrawGeometry& geo) const {
+        const Object3D& object = *draw.object;
+        
+        if (draw.wireframe) {
+            uint32_t color = packColor(baseColor[0], baseColor[1], baseColor[2]);
+            for (const auto& edge : object.edges) {
+                uint32_t codeA = scratch.outcodes[edge.first];
+                uint32_t codeB = scratch.outcodes[edge.second];
+                if (codeA & codeB & Clipper::REJECT_PLANES) continue;
+                if (!((codeA | codeB) & Clipper::CLIP_PLANES)) {
+                    setupLine(scratch.screen[edge.first], scratch.screen[edge.second], color, geo.lines);
+                    continue;
+                }
+                Clipper::Vertex a = clipVertex(draw, scratch, edge.first);
+                Clipper::Vertex b = clipVertex(draw, scratch, edge.second);
+                if (Clipper::clipLine(a, b, codeA | codeB)) {
+                    setupLine(toScreen(a.position, a.u, a.v), toScreen(b.position, b.u, b.v), color, geo.lines);
+                }
+            }
+            return;
+        }
+        
+        for (const auto& face : object.faces) {
+            if (face.size() < 3) continue;
+            
+            uint32_t allCodes = ~0u;
+            uint32_t anyCodes = 0;
+            for (int vertexIndex : face) {
+                allCodes &= scratch.outcodes[vertexIndex];
+                anyCodes |= scratch.outcodes[vertexIndex];
+            }
+            if (allCodes & Clipper::REJECT_PLANES) {
+                geo.trianglesRejected += face.size() - 2;
+                continue;
+            }
+            
+            // Flat two-sided headlight shading from the view-space face normal.
+            // Newell's method copes with the collapsed corners at sphere poles.
+            float intensity = 1.0f;
+            if (draw.lit) {
+                Vector3 normal;
+                for (size_t i = 0; i < face.size(); i++) {
+                    const Vector3& a = scratch.viewPositions[face[i]];
+                    const Vector3& b = scratch.viewPositions[face[(i + 1) % face.size()]];
+                    normal = normal + (a - b).cross(a + b) * 0.5f;
+                }
+                normal = normal.normalize();
+                intensity = 0.2f + 0.8f * std::abs(normal.z);
+            }
+            uint32_t color = packColor(baseColor[0] * intensity,
+                                       baseColor[1] * intensity,
+                                       baseColor[2] * intensity);
+            
+            if (!(anyCodes & Clipper::CLIP_PLANES)) {
+                geo.trianglesAccepted += face.size() - 2;
+                for (size_t i = 1; i + 1 < face.size(); i++) {
+                    queueTriangle(scratch.screen[face[0]], scratch.screen[face[i]], scratch.screen[face[i + 1]],
+                                  color, scratch);
+                }
+                continue;
+            }
+            
+            std::vector<Clipper::Vertex>& polygon = scratch.polygon;
+            polygon.clear();
+            for (int vertexIndex : face) polygon.push_back(clipVertex(draw, scratch, vertexIndex));
+            size_t count = Clipper::clipPolygon(polygon, scratch.clipScratch, anyCodes);
+            if (count == 0) {
+                geo.trianglesRejected += face.size() - 2;
+                continue;
+            }
+            geo.trianglesClipped += face.size() - 2;
+            ScreenVertex first = toScreen(polygon[0].position, polygon[0].u, polygon[0].v);
+            ScreenVertex previous = toScreen(polygon[1].position, polygon[1].u, polygon[1].v);
+            for (size_t i = 2; i < count; i++) {
+                ScreenVertex current = toScreen(polygon[i].position, polygon[i].u, polygon[i].v);
+                queueTriangle(first, previous, current, color, scratch);
+                previous = current;
+            }
+        }
+        setupTriangles(draw, scratch, geo);
+    }
+    
+    void processItem(const DrawItem& item, DrawGeometry& geo) const {
+        const DrawCall& draw = draws[item.draw];
+        geo.triangles.clear();
+        geo.lines.clear();
+        geo.trianglesAccepted = 0;
+        geo.trianglesClipped = 0;
+        geo.trianglesRejected = 0;
+        geo.trianglesCulledFacing = 0;
+        geo.trianglesCulledSmall = 0;
+        geo.instancesTested = 0;
+        geo.instancesCulled = 0;
+        geo.instancesOccluded = 0;
+        ObjectPool<VertexScratch>::Handle scratch(scratchPool);
+        
+        if (draw.instances == nullptr) {
+            {
+                PROFILE_ZONE("transform");
+                transformDraw(draw, draw.modelView, *scratch);
+            }
+            PROFILE_ZONE("primitive setup");
+            buildPrimitives(draw, draw.object->color.data(), *scratch, geo);
+            return;
+        }
+        
+        PROFILE_ZONE("instances");
+        const AABB& bounds = draw.object->bounds;
+        Matrix4x4 mvp = draw.projection * draw.modelView;
+        for (size_t i = item.firstInstance; i < item.firstInstance + item.instanceCount; i++) {
+            const InstanceData& instance = draw.instances[i];
+            Matrix4x4 instanceMatrix = instance.matrix();
+            if (draw.cullInstances || draw.occlusion) {
+                geo.instancesTested++;
+                if (draw.cullInstances && !draw.instanceFrustum.intersects(bounds.transformed(instanceMatrix))) {
+                    geo.instancesCulled++;
+                    continue;
+                }
+                if (draw.occlusion && draw.occlusion->isOccluded(bounds, mvp * instanceMatrix)) {
+                    geo.instancesCulled++;
+                    geo.instancesOccluded++;
+                    continue;
+                }
+            }
+            transformDraw(draw, draw.modelView * instanceMatrix, *scratch);
+            buildPrimitives(draw, instance.color, *scratch, geo);
+        }
+    }
+    
+    DrawCall recordDraw(const Object3D& object) const {
+        bool textured = boundTexture != nullptr && !boundTexture->empty() && !wireframeMode &&
+                        object.texCoords.size() == object.vertices.size();
+        DrawCall draw;
+        draw.object = &object;
+        draw.texture = textured ? boundTexture : nullptr;
+        draw.modelView = pipeline.getModelViewMatrix();
+        draw.projection = pipeline.projectionMatrix;
+        draw.wireframe = wireframeMode;
+        draw.lit = lightingEnabled;
+        draw.cullMode = frameCullMode;
+        draw.instances = nullptr;
+        draw.instanceCount = 0;
+        draw.cullInstances = false;
+        draw.occlusion = nullptr;
+        return draw;
+    }
+    
+    void binPrimitives(size_t chunk) {
+        size_t tiles = tileCount();
+        for (size_t t = 0; t < tiles; t++) {
+            triangleBins[chunk * tiles + t].clear();
+            lineBins[chunk * tiles + t].clear();
+        }
+        
+        size_t triBegin = triangles.size() * chunk / binChunks;
+        size_t triEnd = triangles.size() * (chunk + 1) / binChunks;
+        for (size_t i = triBegin; i < triEnd; i++) {
+            const Triangle& tri = triangles[i];
+            for (int ty = tri.minY / TILE_SIZE; ty <= tri.maxY / TILE_SIZE; ty++) {
+                for (int tx = tri.minX / TILE_SIZE; tx <= tri.maxX / TILE_SIZE; tx++) {
+                    triangleBins[chunk * tiles + ty * tilesX + tx].push_back(static_cast<uint32_t>(i));
+                }
+            }
+        }
+        
+        size_t lineBegin = lines.size() * chunk / binChunks;
+        size_t lineEnd = lines.size() * (chunk + 1) / binChunks;
+        for (size_t i = lineBegin; i < lineEnd; i++) {
+            const Line& line = lines[i];
+            for (int ty = line.minY / TILE_SIZE; ty <= line.maxY / TILE_SIZE; ty++) {
+                for (int tx = line.minX / TILE_SIZE; tx <= line.maxX / TILE_SIZE; tx++) {
+                    lineBins[chunk * tiles + ty * tilesX + tx].push_back(static_cast<uint32_t>(i));
+                }
+            }
+        }
+    }
+    
+    // Textured triangles collect the covered pixels of a row and sample the
+    // texture for the whole span at once
+    template <bool Textured>
+    void rasterizeTriangle(const Triangle& tri, int tileMinX, int tileMinY, int tileMaxX, int tileMaxY) {
+        int minX = std::max(tri.minX, tileMinX);
+        int minY = std::max(tri.minY, tileMinY);
+        int maxX = std::min(tri.maxX, tileMaxX);
+        int maxY = std::min(tri.maxY, tileMaxY);
+        if (minX > maxX || minY > maxY) return;
+        
+        const ScreenVertex& v0 = tri.v[0];
+        const ScreenVertex& v1 = tri.v[1];
+        const ScreenVertex& v2 = tri.v[2];
+        
+        bool topLeft0 = isTopLeft(v1, v2);
+        bool topLeft1 = isTopLeft(v2, v0);
+        bool topLeft2 = isTopLeft(v0, v1);
+        
+        // Per-pixel increments of the three edge functions
+        float stepX0 = -(v2.y - v1.y), stepY0 = v2.x - v1.x;
+        float stepX1 = -(v0.y - v2.y), stepY1 = v0.x - v2.x;
+        float stepX2 = -(v1.y - v0.y), stepY2 = v1.x - v0.x;
+        
+        float invArea = 1.0f / edgeFunction(v0, v1, v2.x, v2.y);
+        float dz1 = (v1.z - v0.z) * invArea;
+        float dz2 = (v2.z - v0.z) * invArea;
+        
+        float startX = minX + 0.5f;
+        float startY = minY + 0.5f;
+        float row0 = edgeFunction(v1, v2, startX, startY);
+        float row1 = edgeFunction(v2, v0, startX, startY);
+        float row2 = edgeFunction(v0, v1, startX, startY);
+        
+        int spanX[TILE_SIZE];
+        float spanU[TILE_SIZE], spanV[TILE_SIZE];
+        uint32_t spanTexels[TILE_SIZE];
+        
+        for (int y = minY; y <= maxY; y++) {
+            float w0 = row0, w1 = row1, w2 = row2;
+            uint32_t* colorRow = &colorBuffer[static_cast<size_t>(y) * width];
+            float* depthRow = &depthBuffer[static_cast<size_t>(y) * width];
+            int span = 0;
+            
+            for (int x = minX; x <= maxX; x++) {
+                if (insideEdge(w0, topLeft0) && insideEdge(w1, topLeft1) && insideEdge(w2, topLeft2)) {
+                    float z = v0.z + w1 * dz1 + w2 * dz2;
+                    if (!frameDepthTest || z < depthRow[x]) {
+                        depthRow[x] = z;
+                        if (Textured) {
+                            float b1 = w1 * invArea;
+                            float b2 = w2 * invArea;
+                            float b0 = 1.0f - b1 - b2;
+                            float w = 1.0f / (v0.invW * b0 + v1.invW * b1 + v2.invW * b2);
+                            spanU[span] = (v0.uOverW * b0 + v1.uOverW * b1 + v2.uOverW * b2) * w;
+                            spanV[span] = (v0.vOverW * b0 + v1.vOverW * b1 + v2.vOverW * b2) * w;
+                            spanX[span++] = x;
+                        } else {
+                            colorRow[x] = tri.color;
+                        }
+                    }
+                }
+                w0 += stepX0;
+                w1 += stepX1;
+                w2 += stepX2;
+            }
+            
+            if (Textured && span > 0) {
+                tri.texture->sample(spanU, spanV, span, frameTextureFilter, tri.lod, spanTexels);
+                for (int i = 0; i < span; i++) {
+                    colorRow[spanX[i]] = modulateColor(spanTexels[i], tri.color);
+                }
+            }
+            
+            row0 += stepY0;
+            row1 += stepY1;
+            row2 += stepY2;
+        }
+    }
+    
+    // Narrows [t0, t1] to the part of p + t * d that lies within [lo, hi)
+    static bool clipSlab(float p, float d, float lo, float hi, float& t0, float& t1) {
+        if (d == 0.0f) return p >= lo && p < hi;
+        float ta = (lo - p) / d;
+        float tb = (hi - p) / d;
+        if (ta > tb) std::swap(ta, tb);
+        t0 = std::max(t0, ta);
+        t1 = std::min(t1, tb);
+        return t0 <= t1;
+    }
+    
+    void rasterizeLine(const Line& line, int tileMinX, int tileMinY, int tileMaxX, int tileMaxY) {
+        float dx = line.b.x - line.a.x;
+        float dy = line.b.y - line.a.y;
+        float dz = line.b.z - line.a.z;
+        
+        float t0 = 0.0f, t1 = 1.0f;
+        if (!clipSlab(line.a.x, dx, static_cast<float>(tileMinX), tileMaxX + 1.0f, t0, t1)) return;
+        if (!clipSlab(line.a.y, dy, static_cast<float>(tileMinY), tileMaxY + 1.0f, t0, t1)) return;
+        
+        float steps = std::max(1.0f, std::ceil(std::max(std::abs(dx), std::abs(dy))));
+        int firstStep = static_cast<int>(std::floor(t0 * steps));
+        int lastStep = static_cast<int>(std::ceil(t1 * steps));
+        
+        for (int s = firstStep; s <= lastStep; s++) {
+            float t = s / steps;
+            int x = static_cast<int>(std::floor(line.a.x + dx * t));
+            int y = static_cast<int>(std::floor(line.a.y + dy * t));
+            if (x < tileMinX || x > tileMaxX || y < tileMinY || y > tileMaxY) continue;
+            
+            size_t index = static_cast<size_t>(y) * width + x;
+            float z = line.a.z + dz * t;
+            if (!frameDepthTest || z < depthBuffer[index]) {
+                depthBuffer[index] = z;
+                colorBuffer[index] = line.color;
+            }
+        }
+    }
+    
+    void rasterizeTile(size_t tile) {
+        int tileX = static_cast<int>(tile % tilesX);
+        int tileY = static_cast<int>(tile / tilesX);
+        int minX = tileX * TILE_SIZE;
+        int minY = tileY * TILE_SIZE;
+        int maxX = std::min(width, minX + TILE_SIZE) - 1;
+        int maxY = std::min(height, minY + TILE_SIZE) - 1;
+        
+        for (int y = minY; y <= maxY; y++) {
+            std::fill(&colorBuffer[static_cast<size_t>(y) * width + minX],
+                      &colorBuffer[static_cast<size_t>(y) * width + maxX] + 1, clearColor);
+            std::fill(&depthBuffer[static_cast<size_t>(y) * width + minX],
+                      &depthBuffer[static_cast<size_t>(y) * width + maxX] + 1, 1.0f);
+        }
+        
+        size_t tiles = tileCount();
+        for (size_t chunk = 0; chunk < binChunks; chunk++) {
+            for (uint32_t index : triangleBins[chunk * tiles + tile]) {
+                const Triangle& tri = triangles[index];
+                if (tri.texture != nullptr) {
+                    rasterizeTriangle<true>(tri, minX, minY, maxX, maxY);
+                } else {
+                    rasterizeTriangle<false>(tri, minX, minY, maxX, maxY);
+                }
+            }
+        }
+        for (size_t chunk = 0; chunk < binChunks; chunk++) {
+            for (uint32_t index : lineBins[chunk * tiles + tile]) {
+                rasterizeLine(lines[index], minX, minY, maxX, maxY);
+            }
+        }
+    }
+
+public:
+    SoftwareRenderer(int width, int height, ThreadPool& pool = ThreadPool::shared())
+        : RenderBackend(width, height), pool(pool) {
+        tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        colorBuffer.resize(static_cast<size_t>(width) * height);
+        depthBuffer.resize(static_cast<size_t>(width) * height);
+        setClearColor(0.1f, 0.1f, 0.1f);
+    }
+    
+    void setClearColor(float r, float g, float b) {
+        clearColor = packColor(r, g, b);
+    }
+    
+    // RGBA8 pixels, row 0 at the top of the image
+    const std::vector<uint32_t>& getColorBuffer() const {
+        return colorBuffer;
+    }
+    
+    // Window-space depth in [0, 1], 1 where nothing was drawn
+    const std::vector<float>& getDepthBuffer() const {
+        return depthBuffer;
+    }
+    
+    // Texture for the following renderObject calls, like glBindTexture;
+    // nullptr disables texturing. Used for filled objects with per-vertex
+    // texture coordinates.
+    void bindTexture(const Texture* texture) {
+        boundTexture = texture;
+    }
+    
+    void setTextureFilter(Texture::Filter filter) {
+        textureFilter = filter;
+    }
+    
+    Texture::Filter getTextureFilter() const {
+        return textureFilter;
+    }
+    
+    // Headlight shading of the following filled draws; off draws them in
+    // their flat color, like GL_LIGHTING disabled
+    void setLighting(bool enabled) {
+        lightingEnabled = enabled;
+    }
+    
+    bool isLightingEnabled() const {
+        return lightingEnabled;
+    }
+    
+    void beginFrame() override {
+        draws.clear();
+        cullStats.reset();
+        occlusionBuffer.clear();
+        beginFrameCulling();
+        frameDepthTest = depthTestEnabled;
+        frameTextureFilter = textureFilter;
+    }
+    
+    void renderObject(const Object3D& object) override {
+        if (cullObject(object)) return;
+        draws.push_back(recordDraw(object));
+    }
+    
+    using RenderBackend::renderInstances;
+    
+    // Culling and transformation happen in endFrame, spread over the pool
+    void renderInstances(const Object3D& object, const InstanceData* instances, size_t count) override {
+        if (count == 0) return;
+        DrawCall draw = recordDraw(object);
+        draw.instances = instances;
+        draw.instanceCount = count;
+        draw.cullInstances = frameFrustumCulling && !object.bounds.isEmpty();
+        draw.instanceFrustum = Frustum::fromMatrix(draw.projection * draw.modelView);
+        draw.occlusion = frameOcclusion && !object.bounds.isEmpty() ? &occlusionBuffer : nullptr;
+        draws.push_back(draw);
+    }
+    
+    void endFrame() override {
+        frameArena.reset();
+        size_t maxItems = 0;
+        for (const auto& draw : draws) {
+            maxItems += draw.instances == nullptr ? 1 : (draw.instanceCount + INSTANCES_PER_ITEM - 1) / INSTANCES_PER_ITEM;
+        }
+        items = frameArena.allocate<DrawItem>(maxItems);
+        itemCount = 0;
+        for (size_t d = 0; d < draws.size(); d++) {
+            if (draws[d].instances == nullptr) {
+                items[itemCount++] = { d, 0, 1 };
+                continue;
+            }
+            for (size_t first = 0; first < draws[d].instanceCount; first += INSTANCES_PER_ITEM) {
+                size_t remaining = draws[d].instanceCount - first;
+                items[itemCount++] = { d, first, remaining < INSTANCES_PER_ITEM ? remaining : size_t(INSTANCES_PER_ITEM) };
+            }
+        }
+        if (geometry.size() < itemCount) {
+            geometry.resize(itemCount);
+        }
+        
+        // Instances are tested against the occluders from the pool threads
+        occlusionBuffer.update();
+        
+        pool.parallelFor(itemCount, [&](size_t i) {
+            processItem(items[i], geometry[i]);
+        });
+        
+        triangles.clear();
+        lines.clear();
+        for (size_t i = 0; i < itemCount; i++) {
+            triangles.insert(triangles.end(), geometry[i].triangles.begin(), geometry[i].triangles.end());
+            lines.insert(lines.end(), geometry[i].lines.begin(), geometry[i].lines.end());
+            cullStats.trianglesAccepted += geometry[i].trianglesAccepted;
+            cullStats.trianglesClipped += geometry[i].trianglesClipped;
+            cullStats.trianglesRejected += geometry[i].trianglesRejected;
+            cullStats.trianglesCulledFacing += geometry[i].trianglesCulledFacing;
+            cullStats.trianglesCulledSmall += geometry[i].trianglesCulledSmall;
+            if (draws[items[i].draw].instances != nullptr) {
+                cullStats.objectsTested += geometry[i].instancesTested;
+                cullStats.objectsCulled += geometry[i].instancesCulled;
+                cullStats.objectsOccluded += geometry[i].instancesOccluded;
+                cullStats.objectsDrawn += items[i].instanceCount - geometry[i].instancesCulled;
+            }
+        }
+        
+        // Each chunk bins a contiguous primitive range, so walking the chunks
+        // in order keeps submission order within every tile
+        binChunks = pool.size() * 2;
+        size_t binCount = binChunks * tileCount();
+        if (triangleBins.size() < binCount) {
+            triangleBins.resize(binCount);
+            lineBins.resize(binCount);
+        }
+        pool.parallelFor(binChunks, [&](size_t chunk) {
+            PROFILE_ZONE("binning");
+            binPrimitives(chunk);
+        });
+        
+        pool.parallelFor(tileCount(), [&](size_t tile) {
+            PROFILE_ZONE("raster");
+            rasterizeTile(tile);
+        });
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,292 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(TEXTURE_SCALAR)
+#include <emmintrin.h>
+#define TEXTURE_SSE2 1
+#endif
+
+// RGBA8 image with a full mip chain, kept in CPU memory so it can be
+// sampled without a GPU. Texels are packed like SoftwareRenderer pixels
+// (red in the low byte), which is also GL_RGBA/GL_UNSIGNED_BYTE order on
+// little-endian hosts. Coordinates wrap like GL_REPEAT.
+//
+// Filtering uses 8-bit fixed-point weights; the SSE2 path filters all four
+// channels of a sample at once and gives the same result as the scalar one
+// (forced with -DTEXTURE_SCALAR).
+class Texture {
+public:
+    enum class Filter {
+        Nearest,    // nearest texel of the nearest mip level
+        Bilinear,   // 2x2 texels of the nearest mip level
+        Trilinear   // bilinear on the two closest levels, blended
+    };
+    
+    struct Level {
+        int width;
+        int height;
+        std::vector<uint32_t> texels;
+    };
+
+private:
+    std::vector<Level> levels;
+    
+    // Texel footprint of a sample: two columns, two rows and weights in [0, 256]
+    struct Footprint {
+        int x0, x1, y0, y1;
+        int fx, fy;
+    };
+    
+    // floor() that matches between the scalar and vector paths for |x| < 2^31
+    static float floorFloat(float x) {
+        float truncated = static_cast<float>(static_cast<int>(x));
+        return truncated > x ? truncated - 1.0f : truncated;
+    }
+    
+    static float wrapCoordinate(float t) {
+        return t - floorFloat(t);
+    }
+    
+    static Footprint footprint(const Level& level, float u, float v) {
+        float x = wrapCoordinate(u) * level.width - 0.5f;
+        float y = wrapCoordinate(v) * level.height - 0.5f;
+        float xFloor = floorFloat(x);
+        float yFloor = floorFloat(y);
+        
+        Footprint f;
+        f.fx = static_cast<int>((x - xFloor) * 256.0f + 0.5f);
+        f.fy = static_cast<int>((y - yFloor) * 256.0f + 0.5f);
+        f.x0 = static_cast<int>(xFloor);
+        f.y0 = static_cast<int>(yFloor);
+        if (f.x0 < 0) f.x0 += level.width;
+        if (f.y0 < 0) f.y0 += level.height;
+        if (f.x0 >= level.width) f.x0 -= level.width;
+        if (f.y0 >= level.height) f.y0 -= level.height;
+        f.x1 = f.x0 + 1 == level.width ? 0 : f.x0 + 1;
+        f.y1 = f.y0 + 1 == level.height ? 0 : f.y0 + 1;
+        return f;
+    }
+    
+    static uint32_t nearestTexel(const Level& level, float u, float v) {
+        int x = static_cast<int>(wrapCoordinate(u) * level.width);
+        int y = static_cast<int>(wrapCoordinate(v) * level.height);
+        x = std::min(x, level.width - 1);
+        y = std::min(y, level.height - 1);
+        return level.texels[static_cast<size_t>(y) * level.width + x];
+    }
+    
+    // (a * (256 - w) + b * w + 128) >> 8 for each 8-bit channel
+    static uint32_t lerpTexels(uint32_t a, uint32_t b, int w) {
+#ifdef TEXTURE_SSE2
+        __m128i zero = _mm_setzero_si128();
+        __m128i pairs = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(a)),
+                                                            _mm_cvtsi32_si128(static_cast<int>(b))), zero);
+        __m128i weights = _mm_set1_epi32((w << 16) | (256 - w));
+        __m128i sum = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(pairs, weights), _mm_set1_epi32(128)), 8);
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(sum, zero), zero);
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+#else
+        uint32_t result = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            uint32_t ca = (a >> shift) & 0xFF;
+            uint32_t cb = (b >> shift) & 0xFF;
+            result |= ((ca * (256 - w) + cb * w + 128) >> 8) << shift;
+        }
+        return result;
+#endif
+    }
+    
+    static uint32_t bilinearTexel(const Level& level, float u, float v) {
+        Footprint f = footprint(level, u, v);
+        const uint32_t* row0 = &level.texels[static_cast<size_t>(f.y0) * level.width];
+        const uint32_t* row1 = &level.texels[static_cast<size_t>(f.y1) * level.width];
+#ifdef TEXTURE_SSE2
+        // Both rows at once: lanes hold (left, right) channel pairs, so one
+        // multiply-add per row does the horizontal blend
+        __m128i zero = _mm_setzero_si128();
+        __m128i top = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(row0[f.x0])),
+                                                          _mm_cvtsi32_si128(static_cast<int>(row0[f.x1]))), zero);
+        __m128i bottom = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(row1[f.x0])),
+                                                             _mm_cvtsi32_si128(static_cast<int>(row1[f.x1]))), zero);
+        __m128i round = _mm_set1_epi32(128);
+        __m128i weightsX = _mm_set1_epi32((f.fx << 16) | (256 - f.fx));
+        __m128i topSum = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(top, weightsX), round), 8);
+        __m128i bottomSum = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(bottom, weightsX), round), 8);
+        
+        // Vertical blend of the (top, bottom) pairs
+        __m128i columns = _mm_or_si128(topSum, _mm_slli_epi32(bottomSum, 16));
+        __m128i weightsY = _mm_set1_epi32((f.fy << 16) | (256 - f.fy));
+        __m128i sum = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(columns, weightsY), round), 8);
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(sum, zero), zero);
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+#else
+        uint32_t top = lerpTexels(row0[f.x0], row0[f.x1], f.fx);
+        uint32_t bottom = lerpTexels(row1[f.x0], row1[f.x1], f.fx);
+        return lerpTexels(top, bottom, f.fy);
+#endif
+    }
+    
+    int nearestLevel(float lod) const {
+        int level = static_cast<int>(std::floor(lod + 0.5f));
+        return std::min(std::max(level, 0), levelCount() - 1);
+    }
+    
+    // Box filter: every destination texel averages the source texels its
+    // footprint touches (2x2 for even sizes)
+    static void downsample(const Level& source, Level& target, ThreadPool& pool) {
+        target.width = std::max(1, source.width / 2);
+        target.height = std::max(1, source.height / 2);
+        target.texels.resize(static_cast<size_t>(target.width) * target.height);
+        
+        pool.parallelForRange(target.height, 16, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; y++) {
+                int sy0 = static_cast<int>(y * source.height / target.height);
+                int sy1 = static_cast<int>(((y + 1) * source.height + target.height - 1) / target.height);
+                for (int x = 0; x < target.width; x++) {
+                    int sx0 = x * source.width / target.width;
+                    int sx1 = ((x + 1) * source.width + target.width - 1) / target.width;
+                    
+                    uint32_t sums[4] = { 0, 0, 0, 0 };
+                    for (int sy = sy0; sy < sy1; sy++) {
+                        const uint32_t* row = &source.texels[static_cast<size_t>(sy) * source.width];
+                        for (int sx = sx0; sx < sx1; sx++) {
+                            for (int c = 0; c < 4; c++) sums[c] += (row[sx] >> (c * 8)) & 0xFF;
+                        }
+                    }
+                    uint32_t count = static_cast<uint32_t>((sy1 - sy0) * (sx1 - sx0));
+                    uint32_t texel = 0;
+                    for (int c = 0; c < 4; c++) texel |= ((sums[c] + count / 2) / count) << (c * 8);
+                    target.texels[y * target.width + x] = texel;
+                }
+            }
+        });
+    }
+
+public:
+    Texture() {}
+    
+    // Copies width * height RGBA8 texels (row 0 first) and builds the mip chain
+    Texture(int width, int height, const uint32_t* texels, ThreadPool& pool = ThreadPool::shared()) {
+        if (width <= 0 || height <= 0) {
+            throw std::runtime_error("Texture size must be positive");
+        }
+        Level base;
+        base.width = width;
+        base.height = height;
+        base.texels.assign(texels, texels + static_cast<size_t>(width) * height);
+        levels.push_back(base);
+        buildMipChain(pool);
+    }
+    
+    // Same patterns as TextureLoader: "checkerboard", "gradient", "brick"
+    static Texture createProcedural(const std::string& patternType = "checkerboard", ThreadPool& pool = ThreadPool::shared()) {
+        const int width = 64;
+        const int height = 64;
+        std::vector<uint32_t> texels(width * height);
+        
+        for (int i = 0; i < height; i++) {
+            for (int j = 0; j < width; j++) {
+                uint32_t r = 0, g = 0, b = 0;
+                if (patternType == "checkerboard") {
+                    r = g = b = ((((i & 0x8) == 0) ^ ((j & 0x8) == 0))) * 255;
+                } else if (patternType == "gradient") {
+                    r = 255 * i / width;
+                    g = 255 * j / height;
+                    b = 128;
+                } else if (patternType == "brick") {
+                    bool isBrick = ((i % 16 < 15) && (j % 8 < 7)) ||
+                                   ((i % 16 > 7) && (j % 16 < 15) && (j % 16 > 7));
+                    r = isBrick ? 156 : 200;
+                    g = isBrick ? 56 : 70;
+                    b = isBrick ? 28 : 35;
+                }
+                texels[i * width + j] = r | (g << 8) | (b << 16) | (255u << 24);
+            }
+        }
+        return Texture(width, height, texels.data(), pool);
+    }
+    
+    // Rebuilds levels 1..n from level 0, down to 1x1
+    void buildMipChain(ThreadPool& pool = ThreadPool::shared()) {
+        levels.resize(1);
+        while (levels.back().width > 1 || levels.back().height > 1) {
+            Level next;
+            downsample(levels.back(), next, pool);
+            levels.push_back(next);
+        }
+    }
+    
+    bool empty() const {
+        return levels.empty();
+    }
+    
+    int width() const {
+        return levels.empty() ? 0 : levels[0].width;
+    }
+    
+    int height() const {
+        return levels.empty() ? 0 : levels[0].height;
+    }
+    
+    int levelCount() const {
+        return static_cast<int>(levels.size());
+    }
+    
+    const Level& level(int index) const {
+        return levels[index];
+    }
+    
+    // Mip level of detail for a footprint of `texelsPerPixel` level-0 texels
+    // along each screen axis
+    static float lodFor(float texelsPerPixel) {
+        return texelsPerPixel > 1.0f ? std::log2(texelsPerPixel) : 0.0f;
+    }
+    
+    uint32_t sampleNearest(float u, float v, int level = 0) const {
+        return nearestTexel(levels[level], u, v);
+    }
+    
+    uint32_t sampleBilinear(float u, float v, int level = 0) const {
+        return bilinearTexel(levels[level], u, v);
+    }
+    
+    uint32_t sampleTrilinear(float u, float v, float lod) const {
+        if (lod <= 0.0f) return bilinearTexel(levels[0], u, v);
+        int last = levelCount() - 1;
+        if (lod >= last) return bilinearTexel(levels[last], u, v);
+        
+        int level = static_cast<int>(lod);
+        int weight = static_cast<int>((lod - level) * 256.0f + 0.5f);
+        return lerpTexels(bilinearTexel(levels[level], u, v), bilinearTexel(levels[level + 1], u, v), weight);
+    }
+    
+    // Samples `count` coordinates that share one level of detail
+    void sample(const float* u, const float* v, size_t count, Filter filter, float lod, uint32_t* out) const {
+        switch (filter) {
+            case Filter::Nearest: {
+                const Level& source = levels[nearestLevel(lod)];
+                for (size_t i = 0; i < count; i++) out[i] = nearestTexel(source, u[i], v[i]);
+                break;
+            }
+            case Filter::Bilinear: {
+                const Level& source = levels[nearestLevel(lod)];
+                for (size_t i = 0; i < count; i++) out[i] = bilinearTexel(source, u[i], v[i]);
+                break;
+            }
+            case Filter::Trilinear:
+                for (size_t i = 0; i < count; i++) out[i] = sampleTrilinear(u[i], v[i], lod);
+                break;
+        }
+    }
+};
+
+#endif
\ No newline at end of file
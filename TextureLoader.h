@@ -1,17 +1,30 @@
 #ifndef TEXTURE_LOADER_H
 #define TEXTURE_LOADER_H
 
+// OpenGL and GLUT from the macOS frameworks, or Mesa and freeglut elsewhere
+#ifdef __APPLE__
 #define GL_SILENCE_DEPRECATION
 #include <OpenGL/gl.h>
 #include <GLUT/glut.h>
+#else
+// Buffer object entry points are prototypes only with this on Mesa
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glut.h>
+#endif
+
 #include <string>
 #include <map>
 #include <iostream>
+#include "Texture.h"
 
 class TextureLoader {
 private:
     static std::map<std::string, GLuint> textureCache;
-    
+
 public:
     static GLuint createProceduralTexture(const std::string& patternType = "checkerboard") {
         if (textureCache.find(patternType) != textureCache.end()) {
@@ -27,45 +40,11 @@ public:
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         
-        const int width = 64;
-        const int height = 64;
-        GLubyte checkImage[width][height][4];
-        
-        if (patternType == "checkerboard") {
-            for (int i = 0; i < width; i++) {
-                for (int j = 0; j < height; j++) {
-                    int c = ((((i & 0x8) == 0) ^ ((j & 0x8) == 0))) * 255;
-                    checkImage[i][j][0] = (GLubyte) c;
-                    checkImage[i][j][1] = (GLubyte) c;
-                    checkImage[i][j][2] = (GLubyte) c;
-                    checkImage[i][j][3] = (GLubyte) 255; // Alpha
-                }
-            }
-        } 
-        else if (patternType == "gradient") {
-            for (int i = 0; i < width; i++) {
-                for (int j = 0; j < height; j++) {
-                    checkImage[i][j][0] = (GLubyte) (255 * i / width);
-                    checkImage[i][j][1] = (GLubyte) (255 * j / height);
-                    checkImage[i][j][2] = (GLubyte) 128;
-                    checkImage[i][j][3] = (GLubyte) 255;
-                }
-            }
-        }
-        else if (patternType == "brick") {
-            for (int i = 0; i < width; i++) {
-                for (int j = 0; j < height; j++) {
-                    bool isBrick = ((i % 16 < 15) && (j % 8 < 7)) || 
-                                   ((i % 16 > 7) && (j % 16 < 15) && (j % 16 > 7));
-                    checkImage[i][j][0] = (GLubyte) (isBrick ? 156 : 200);
-                    checkImage[i][j][1] = (GLubyte) (isBrick ? 56 : 70);
-                    checkImage[i][j][2] = (GLubyte) (isBrick ? 28 : 35);
-                    checkImage[i][j][3] = (GLubyte) 255;
-                }
-            }
-        }
+        // Texels come from the CPU-side texture so both renderers see the same image
+        Texture texture = Texture::createProcedural(patternType);
+        const Texture::Level& image = texture.level(0);
         
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, checkImage);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.texels.data());
         
         textureCache[patternType] = textureID;
         
@@ -0,0 +1,135 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for data-parallel loops. The calling thread
+// joins in, so a pool of size 1 runs everything inline.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextIndex;
+    size_t activeWorkers = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+    
+    void runJob(const std::function<void(size_t)>& fn, size_t count) {
+        for (size_t i = nextIndex.fetch_add(1); i < count; i = nextIndex.fetch_add(1)) {
+            fn(i);
+        }
+    }
+    
+    void workerLoop() {
+        unsigned long seenGeneration = 0;
+        for (;;) {
+            const std::function<void(size_t)>* currentJob;
+            size_t count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+                // The caller may already have finished this job on its own
+                if (job == nullptr) continue;
+                currentJob = job;
+                count = jobCount;
+                activeWorkers++;
+            }
+            
+            runJob(*currentJob, count);
+            
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                activeWorkers--;
+            }
+            doneCondition.notify_one();
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t threadCount = 0) : nextIndex(0) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 1; i < threadCount; i++) {
+            workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+        }
+    }
+    
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    size_t size() const {
+        return workers.size() + 1;
+    }
+    
+    // Calls fn(i) for every i in [0, count) and returns once all calls finished.
+    // Not reentrant: fn must not call parallelFor on the same pool.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+        if (count == 0) return;
+        if (workers.empty() || count == 1) {
+            for (size_t i = 0; i < count; i++) fn(i);
+            return;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobCount = count;
+            nextIndex.store(0);
+            generation++;
+        }
+        wakeCondition.notify_all();
+        
+        runJob(fn, count);
+        
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [&] { return activeWorkers == 0 && nextIndex.load() >= jobCount; });
+        job = nullptr;
+    }
+    
+    // Splits [0, count) into contiguous ranges of at least minChunk items and
+    // calls fn(begin, end) for each of them.
+    void parallelForRange(size_t count, size_t minChunk,
+                          const std::function<void(size_t, size_t)>& fn) {
+        if (count == 0) return;
+        minChunk = std::max<size_t>(1, minChunk);
+        size_t chunks = std::min((count + minChunk - 1) / minChunk, size() * 4);
+        size_t chunkSize = (count + chunks - 1) / chunks;
+        parallelFor(chunks, [&](size_t chunk) {
+            size_t begin = chunk * chunkSize;
+            size_t end = std::min(count, begin + chunkSize);
+            if (begin < end) fn(begin, end);
+        });
+    }
+    
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+};
+
+#endif
\ No newline at end of file
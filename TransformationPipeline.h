@@ -1,11 +1,47 @@
 #ifndef TRANSFORMATION_PIPELINE_H
 #define TRANSFORMATION_PIPELINE_H
 
+#include <cmath>
+#include <cstddef>
+#include <vector>
 #include "Vector3.h"
+#include "Vector4.h"
 #include "Matrix4x4.h"
+#include "Quaternion.h"
+#include "MathKernels.h"
+#include "Frustum.h"
 
 class TransformationPipeline {
+private:
+    // Products of the three matrices, rebuilt lazily after one of them changes
+    mutable Matrix4x4 modelViewMatrix;
+    mutable Matrix4x4 viewProjectionMatrix;
+    mutable Matrix4x4 mvpMatrix;
+    mutable bool modelViewDirty = true;
+    mutable bool viewProjectionDirty = true;
+    mutable bool mvpDirty = true;
+    mutable Frustum frustum;
+    mutable bool frustumDirty = true;
+    mutable Matrix4x4 normalMatrix;
+    mutable bool normalMatrixDirty = true;
+    
+    void markModelDirty() {
+        modelViewDirty = true;
+        normalMatrixDirty = true;
+        mvpDirty = true;
+    }
+    
+    void markViewOrProjectionDirty() {
+        modelViewDirty = true;
+        normalMatrixDirty = true;
+        viewProjectionDirty = true;
+        mvpDirty = true;
+        frustumDirty = true;
+    }
+
 public:
+    // Readable directly; assign them through the setters so the cached
+    // products stay in sync.
     Matrix4x4 modelMatrix;
     Matrix4x4 viewMatrix;
     Matrix4x4 projectionMatrix;
@@ -18,33 +54,194 @@ public:
         modelMatrix = Matrix4x4();
         viewMatrix = Matrix4x4();
         projectionMatrix = Matrix4x4();
+        markViewOrProjectionDirty();
+    }
+    
+    // Translation * rotation (X, then Y, then Z, in degrees) * scale,
+    // written out in closed form instead of multiplying five matrices
+    static Matrix4x4 composeModelMatrix(const Vector3& translation,
+                                        const Vector3& rotation,
+                                        const Vector3& scale) {
+        float toRadians = static_cast<float>(M_PI) / 180.0f;
+        float ca = std::cos(rotation.x * toRadians), sa = std::sin(rotation.x * toRadians);
+        float cb = std::cos(rotation.y * toRadians), sb = std::sin(rotation.y * toRadians);
+        float cc = std::cos(rotation.z * toRadians), sc = std::sin(rotation.z * toRadians);
+        
+        Matrix4x4 result;
+        result.m[0][0] = cb * cc * scale.x;
+        result.m[0][1] = -cb * sc * scale.y;
+        result.m[0][2] = sb * scale.z;
+        result.m[1][0] = (ca * sc + sa * sb * cc) * scale.x;
+        result.m[1][1] = (ca * cc - sa * sb * sc) * scale.y;
+        result.m[1][2] = -sa * cb * scale.z;
+        result.m[2][0] = (sa * sc - ca * sb * cc) * scale.x;
+        result.m[2][1] = (sa * cc + ca * sb * sc) * scale.y;
+        result.m[2][2] = ca * cb * scale.z;
+        result.m[0][3] = translation.x;
+        result.m[1][3] = translation.y;
+        result.m[2][3] = translation.z;
+        return result;
+    }
+    
+    // Translation * rotation * scale with the rotation as a unit quaternion,
+    // free of gimbal lock
+    static Matrix4x4 composeModelMatrix(const Vector3& translation,
+                                        const Quaternion& rotation,
+                                        const Vector3& scale) {
+        Matrix4x4 result = rotation.toMatrix();
+        for (int i = 0; i < 3; i++) {
+            result.m[i][0] *= scale.x;
+            result.m[i][1] *= scale.y;
+            result.m[i][2] *= scale.z;
+        }
+        result.m[0][3] = translation.x;
+        result.m[1][3] = translation.y;
+        result.m[2][3] = translation.z;
+        return result;
     }
     
     void setModelTransform(const Vector3& translation, 
                            const Vector3& rotation, 
                            const Vector3& scale) {
-        Matrix4x4 translationMatrix = Matrix4x4::translation(translation.x, translation.y, translation.z);
-        Matrix4x4 rotationMatrixX = Matrix4x4::rotationX(rotation.x);
-        Matrix4x4 rotationMatrixY = Matrix4x4::rotationY(rotation.y);
-        Matrix4x4 rotationMatrixZ = Matrix4x4::rotationZ(rotation.z);
-        Matrix4x4 scaleMatrix = Matrix4x4::scaling(scale.x, scale.y, scale.z);
-        
-        Matrix4x4 rotationMatrix = rotationMatrixX * rotationMatrixY * rotationMatrixZ;
-        
-        modelMatrix = translationMatrix * rotationMatrix * scaleMatrix;
+        modelMatrix = composeModelMatrix(translation, rotation, scale);
+        markModelDirty();
+    }
+    
+    void setModelTransform(const Vector3& translation,
+                           const Quaternion& rotation,
+                           const Vector3& scale) {
+        modelMatrix = composeModelMatrix(translation, rotation, scale);
+        markModelDirty();
+    }
+    
+    void setModelMatrix(const Matrix4x4& matrix) {
+        modelMatrix = matrix;
+        markModelDirty();
     }
     
     void setViewTransform(const Vector3& cameraPos, const Vector3& target, const Vector3& up) {
         viewMatrix = Matrix4x4::lookAt(cameraPos, target, up);
+        markViewOrProjectionDirty();
+    }
+    
+    void setViewMatrix(const Matrix4x4& matrix) {
+        viewMatrix = matrix;
+        markViewOrProjectionDirty();
     }
     
     void setProjection(float fov, float aspectRatio, float near, float far) {
         projectionMatrix = Matrix4x4::perspective(fov, aspectRatio, near, far);
+        markViewOrProjectionDirty();
+    }
+    
+    void setProjectionMatrix(const Matrix4x4& matrix) {
+        projectionMatrix = matrix;
+        markViewOrProjectionDirty();
+    }
+    
+    const Matrix4x4& getModelViewMatrix() const {
+        if (modelViewDirty) {
+            modelViewMatrix = viewMatrix * modelMatrix;
+            modelViewDirty = false;
+        }
+        return modelViewMatrix;
+    }
+    
+    // Inverse transpose of the model-view matrix's upper 3x3, which takes
+    // normals to view space even under non-uniform scale; the rest is
+    // identity. Built from the cofactors, so a singular model-view still
+    // gives usable (unnormalized) normal directions.
+    const Matrix4x4& getNormalMatrix() const {
+        if (normalMatrixDirty) {
+            const float (&m)[4][4] = getModelViewMatrix().m;
+            float c[3][3] = {
+                { m[1][1] * m[2][2] - m[1][2] * m[2][1], m[1][2] * m[2][0] - m[1][0] * m[2][2], m[1][0] * m[2][1] - m[1][1] * m[2][0] },
+                { m[0][2] * m[2][1] - m[0][1] * m[2][2], m[0][0] * m[2][2] - m[0][2] * m[2][0], m[0][1] * m[2][0] - m[0][0] * m[2][1] },
+                { m[0][1] * m[1][2] - m[0][2] * m[1][1], m[0][2] * m[1][0] - m[0][0] * m[1][2], m[0][0] * m[1][1] - m[0][1] * m[1][0] }
+            };
+            float det = m[0][0] * c[0][0] + m[0][1] * c[0][1] + m[0][2] * c[0][2];
+            float scale = det != 0.0f ? 1.0f / det : 1.0f;
+            normalMatrix = Matrix4x4();
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    normalMatrix.m[i][j] = c[i][j] * scale;
+                }
+            }
+            normalMatrixDirty = false;
+        }
+        return normalMatrix;
+    }
+    
+    // Normals of the current model to view space, renormalized
+    void transformNormals(const Vector3* normals, size_t count, Vector3* out) const {
+        getNormalMatrix().transformDirections(normals, count, out);
+        MathKernels::normalize(out, count, out);
+    }
+    
+    const Matrix4x4& getViewProjectionMatrix() const {
+        if (viewProjectionDirty) {
+            viewProjectionMatrix = projectionMatrix * viewMatrix;
+            viewProjectionDirty = false;
+        }
+        return viewProjectionMatrix;
+    }
+    
+    // World-space view volume, from projectionMatrix * viewMatrix
+    const Frustum& getFrustum() const {
+        if (frustumDirty) {
+            frustum = Frustum::fromMatrix(getViewProjectionMatrix());
+            frustumDirty = false;
+        }
+        return frustum;
+    }
+    
+    // Only the model matrix changes between objects, so this usually costs a
+    // single product against the cached view-projection matrix
+    const Matrix4x4& getMVPMatrix() const {
+        if (mvpDirty) {
+            mvpMatrix = getViewProjectionMatrix() * modelMatrix;
+            mvpDirty = false;
+        }
+        return mvpMatrix;
     }
     
     Vector3 applyMVP(const Vector3& vertex) const {
-        Matrix4x4 mvp = projectionMatrix * viewMatrix * modelMatrix;
-        return mvp.transform(vertex);
+        return getMVPMatrix().transform(vertex);
+    }
+    
+    // Writes homogeneous clip-space coordinates (x, y, z, w) for count vertices
+    // to out, which must hold 4 * count floats. No perspective divide.
+    void transformToClipSpace(const Vector3* vertices, size_t count, float* out) const {
+        MathKernels::transformPointsToClip(&getMVPMatrix().m[0][0], vertices, count, out);
+    }
+    
+    void transformToClipSpace(const Vector3* vertices, size_t count, Vector4* out) const {
+        getMVPMatrix().transformPointsToClip(vertices, count, out);
+    }
+    
+    // Batch version of applyMVP: normalized device coordinates for every vertex
+    void transformVertices(const Vector3* vertices, size_t count, Vector3* out) const {
+        getMVPMatrix().transformPoints(vertices, count, out);
+    }
+    
+    void transformVertices(const std::vector<Vector3>& vertices, std::vector<Vector3>& out) const {
+        out.resize(vertices.size());
+        transformVertices(vertices.data(), vertices.size(), out.data());
+    }
+    
+    // Batch version of transformVertexToScreen
+    void transformVerticesToScreen(const Vector3* vertices, size_t count, Vector3* out,
+                                   int screenWidth, int screenHeight) const {
+        transformVertices(vertices, count, out);
+        for (size_t i = 0; i < count; i++) {
+            out[i] = clipToScreen(out[i], screenWidth, screenHeight);
+        }
+    }
+    
+    void transformVerticesToScreen(const std::vector<Vector3>& vertices, std::vector<Vector3>& out,
+                                   int screenWidth, int screenHeight) const {
+        out.resize(vertices.size());
+        transformVerticesToScreen(vertices.data(), vertices.size(), out.data(), screenWidth, screenHeight);
     }
     
     Vector3 clipToScreen(const Vector3& clipSpaceCoord, int screenWidth, int screenHeight) const {
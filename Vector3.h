@@ -4,61 +4,60 @@
 #include <iostream>
 #include <cmath>
 
-class Vector3 {
+// 3D vector over a scalar type: float (Vector3), double (Vector3d) or
+// Fixed from FixedPoint.h for deterministic runs. Math functions are called
+// unqualified so that non-standard scalars supply their own.
+template <typename T>
+class Vector3T {
 public:
-    float x, y, z;
-
-    Vector3() : x(0.0f), y(0.0f), z(0.0f) {}
-    Vector3(float x, float y, float z) : x(x), y(y), z(z) {}
+    T x, y, z;
+    
+    constexpr Vector3T() : x(0), y(0), z(0) {}
+    constexpr Vector3T(T x, T y, T z) : x(x), y(y), z(z) {}
     
-    Vector3 operator+(const Vector3& v) const {
-        return Vector3(x + v.x, y + v.y, z + v.z);
+    constexpr Vector3T operator+(const Vector3T& v) const {
+        return Vector3T(x + v.x, y + v.y, z + v.z);
     }
     
-    Vector3 operator-(const Vector3& v) const {
-        return Vector3(x - v.x, y - v.y, z - v.z);
+    constexpr Vector3T operator-(const Vector3T& v) const {
+        return Vector3T(x - v.x, y - v.y, z - v.z);
     }
     
-    Vector3 operator*(float scalar) const {
-        return Vector3(x * scalar, y * scalar, z * scalar);
+    constexpr Vector3T operator*(T scalar) const {
+        return Vector3T(x * scalar, y * scalar, z * scalar);
     }
     
-    float dot(const Vector3& v) const {
+    constexpr T dot(const Vector3T& v) const {
         return x * v.x + y * v.y + z * v.z;
     }
     
-    Vector3 cross(const Vector3& v) const {
-        return Vector3(
+    constexpr Vector3T cross(const Vector3T& v) const {
+        return Vector3T(
             y * v.z - z * v.y,
             z * v.x - x * v.z,
             x * v.y - y * v.x
         );
     }
     
-    float magnitude() const {
-        return std::sqrt(x * x + y * y + z * z);
+    T magnitude() const {
+        using std::sqrt;
+        return sqrt(x * x + y * y + z * z);
     }
     
-    Vector3 normalize() const {
-        float mag = magnitude();
-        if (mag == 0.0f)
-            return Vector3(0.0f, 0.0f, 0.0f);
-        return Vector3(x / mag, y / mag, z / mag);
+    Vector3T normalize() const {
+        T mag = magnitude();
+        if (mag == T(0))
+            return Vector3T(T(0), T(0), T(0));
+        return Vector3T(x / mag, y / mag, z / mag);
     }
     
-    friend std::ostream& operator<<(std::ostream& os, const Vector3& v) {
+    friend std::ostream& operator<<(std::ostream& os, const Vector3T& v) {
         os << "Vector3(" << v.x << ", " << v.y << ", " << v.z << ")";
         return os;
     }
-
-    float* toHomogeneous() const {
-        float* result = new float[4];
-        result[0] = x;
-        result[1] = y;
-        result[2] = z;
-        result[3] = 1.0f;
-        return result;
-    }
 };
 
+typedef Vector3T<float> Vector3;
+typedef Vector3T<double> Vector3d;
+
 #endif
\ No newline at end of file
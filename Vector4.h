@@ -0,0 +1,65 @@
+#ifndef VECTOR4_H
+#define VECTOR4_H
+
+#include <iostream>
+#include "Vector3.h"
+
+// Homogeneous coordinates, e.g. a clip-space position. Nothing divides by
+// w implicitly; perspectiveDivide() does it when the caller asks.
+template <typename T>
+class Vector4T {
+public:
+    T x, y, z, w;
+    
+    constexpr Vector4T() : x(0), y(0), z(0), w(0) {}
+    constexpr Vector4T(T x, T y, T z, T w) : x(x), y(y), z(z), w(w) {}
+    
+    // A point (w = 1) or, with w = 0, a direction
+    constexpr explicit Vector4T(const Vector3T<T>& v, T w = T(1)) : x(v.x), y(v.y), z(v.z), w(w) {}
+    
+    constexpr Vector4T operator+(const Vector4T& v) const {
+        return Vector4T(x + v.x, y + v.y, z + v.z, w + v.w);
+    }
+    
+    constexpr Vector4T operator-(const Vector4T& v) const {
+        return Vector4T(x - v.x, y - v.y, z - v.z, w - v.w);
+    }
+    
+    constexpr Vector4T operator*(T scalar) const {
+        return Vector4T(x * scalar, y * scalar, z * scalar, w * scalar);
+    }
+    
+    constexpr T dot(const Vector4T& v) const {
+        return x * v.x + y * v.y + z * v.z + w * v.w;
+    }
+    
+    // Drops w without dividing
+    constexpr Vector3T<T> xyz() const {
+        return Vector3T<T>(x, y, z);
+    }
+    
+    // Normalized device coordinates; w must not be zero
+    Vector3T<T> perspectiveDivide() const {
+        T invW = T(1) / w;
+        return Vector3T<T>(x * invW, y * invW, z * invW);
+    }
+    
+    // Inside the view volume: -w <= x, y, z <= w
+    constexpr bool insideClipVolume() const {
+        return -w <= x && x <= w && -w <= y && y <= w && -w <= z && z <= w;
+    }
+    
+    static constexpr Vector4T lerp(const Vector4T& a, const Vector4T& b, T t) {
+        return a + (b - a) * t;
+    }
+    
+    friend std::ostream& operator<<(std::ostream& os, const Vector4T& v) {
+        os << "Vector4(" << v.x << ", " << v.y << ", " << v.z << ", " << v.w << ")";
+        return os;
+    }
+};
+
+typedef Vector4T<float> Vector4;
+typedef Vector4T<double> Vector4d;
+
+#endif
\ No newline at end of file
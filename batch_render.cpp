@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BatchRenderer.h"
+#include "ThreadPool.h"
+
+// Headless batch renderer: renders the jobs of one or more job files to
+// image sequences with the software renderer. See BatchRenderer.h for the
+// job file format.
+
+void printUsage() {
+    std::cout << "Usage: batch_render [--threads N] JOBFILE..." << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t threads = 0;
+    std::vector<std::string> jobFiles;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--threads" && hasValue) threads = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--help") {
+            printUsage();
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            printUsage();
+            return 1;
+        } else {
+            jobFiles.push_back(arg);
+        }
+    }
+    if (jobFiles.empty()) {
+        printUsage();
+        return 1;
+    }
+    
+    try {
+        std::vector<RenderJob> jobs;
+        for (const auto& path : jobFiles) {
+            std::vector<RenderJob> fileJobs = BatchRenderer::loadJobs(path);
+            jobs.insert(jobs.end(), fileJobs.begin(), fileJobs.end());
+        }
+        
+        auto start = std::chrono::steady_clock::now();
+        AssetCache assets;
+        BatchRenderer::loadAssets(jobs, assets);
+        auto loaded = std::chrono::steady_clock::now();
+        
+        std::unique_ptr<ThreadPool> ownPool;
+        if (threads > 0) ownPool.reset(new ThreadPool(threads));
+        ThreadPool& pool = ownPool ? *ownPool : ThreadPool::shared();
+        size_t frames = BatchRenderer::render(jobs, assets, pool);
+        auto done = std::chrono::steady_clock::now();
+        
+        for (const auto& job : jobs) {
+            std::cout << job.name << ": " << job.frames << " frame" << (job.frames == 1 ? "" : "s")
+                      << " " << job.width << "x" << job.height << " -> " << job.output << std::endl;
+        }
+        double loadMs = std::chrono::duration<double, std::milli>(loaded - start).count();
+        double renderMs = std::chrono::duration<double, std::milli>(done - loaded).count();
+        std::cout << assets.meshCount() << " meshes and " << assets.textureCount() << " textures loaded in "
+                  << loadMs << " ms; " << frames << " frames rendered in " << renderMs << " ms on "
+                  << pool.size() << " threads" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "batch_render: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,1472 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "Vector3.h"
+#include "Matrix4x4.h"
+#include "MathKernels.h"
+#include "Object3D.h"
+#include "IndexedMesh.h"
+#include "MeshLoader.h"
+#include "MeshCache.h"
+#include "TransformationPipeline.h"
+#include "SoftwareRenderer.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "SceneGraph.h"
+#include "BVH.h"
+#include "InstanceData.h"
+#include "LODChain.h"
+#include "MeshOptimizer.h"
+#include "Quaternion.h"
+#include "Animation.h"
+#include "FixedPoint.h"
+
+// Keeps the optimizer from discarding benchmark results
+volatile float benchmarkSink;
+
+// Every heap allocation of the process, for --check-allocations
+std::atomic<size_t> heapAllocations(0);
+
+void* operator new(size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+// GCC mistakes the inlined free() for a mismatch with the builtin new
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+void operator delete[](void* p) noexcept {
+    operator delete(p);
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct BenchmarkOptions {
+    int samples = 15;
+    double minSampleSeconds = 0.01;
+    // Expensive benchmarks take fewer samples (at least 3) to stay in budget
+    double maxSecondsPerBenchmark = 2.0;
+    std::string filter;
+    std::string jsonPath;
+    std::string label;
+};
+
+struct BenchmarkResult {
+    std::string name;
+    size_t iterations = 0;         // calls per sample
+    double itemsPerCall = 0.0;     // vertices, matrices, ... handled by one call
+    std::vector<double> samples;   // nanoseconds per call
+    double min = 0.0, median = 0.0, mean = 0.0, stddev = 0.0, max = 0.0;
+    std::map<std::string, double> counters;
+};
+
+// Runs each benchmark as repeated timed samples and summarizes them. One
+// sample calls the function often enough to last minSampleSeconds, so
+// timer resolution does not matter; the median is the headline number.
+class BenchmarkSuite {
+private:
+    BenchmarkOptions options;
+    std::vector<BenchmarkResult> results;
+    
+    static void summarize(BenchmarkResult& result) {
+        std::vector<double> sorted = result.samples;
+        std::sort(sorted.begin(), sorted.end());
+        size_t n = sorted.size();
+        result.min = sorted.front();
+        result.max = sorted.back();
+        result.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) * 0.5;
+        
+        double sum = 0.0;
+        for (double s : sorted) sum += s;
+        result.mean = sum / n;
+        double squares = 0.0;
+        for (double s : sorted) squares += (s - result.mean) * (s - result.mean);
+        result.stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+    }
+    
+    static void printResult(const BenchmarkResult& result) {
+        char line[256];
+        double relative = result.mean > 0.0 ? result.stddev / result.mean * 100.0 : 0.0;
+        std::snprintf(line, sizeof(line), "%-44s %14.1f ns  +-%5.1f%%", result.name.c_str(), result.median, relative);
+        std::cout << line;
+        if (result.itemsPerCall > 0.0) {
+            std::snprintf(line, sizeof(line), "  %10.2f M items/s", result.itemsPerCall / result.median * 1e3);
+            std::cout << line;
+        }
+        std::cout << std::endl;
+    }
+    
+    static std::string escapeJson(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20) escaped += c;
+        }
+        return escaped;
+    }
+
+public:
+    explicit BenchmarkSuite(const BenchmarkOptions& options) : options(options) {}
+    
+    bool enabled(const std::string& name) const {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+    
+    template <typename Function>
+    void run(const std::string& name, Function function, double itemsPerCall = 0.0) {
+        if (!enabled(name)) return;
+        
+        BenchmarkResult result;
+        result.name = name;
+        result.itemsPerCall = itemsPerCall;
+        
+        // Warm up, then double the call count until a sample is long enough
+        function();
+        size_t iterations = 1;
+        double sampleSeconds = 0.0;
+        for (;;) {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; i++) function();
+            sampleSeconds = secondsSince(start);
+            if (sampleSeconds >= options.minSampleSeconds) break;
+            iterations *= 2;
+        }
+        result.iterations = iterations;
+        
+        int samples = options.samples;
+        if (sampleSeconds * samples > options.maxSecondsPerBenchmark) {
+            samples = std::max(3, static_cast<int>(options.maxSecondsPerBenchmark / sampleSeconds));
+        }
+        for (int s = 0; s < samples; s++) {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; i++) function();
+            result.samples.push_back(secondsSince(start) * 1e9 / iterations);
+        }
+        
+        summarize(result);
+        printResult(result);
+        results.push_back(result);
+    }
+    
+    // Attaches a non-timing value (bytes, counts) to the last benchmark run
+    void addCounter(const std::string& name, const std::string& key, double value) {
+        if (!results.empty() && results.back().name == name) {
+            results.back().counters[key] = value;
+            std::cout << "    " << key << " = " << value << std::endl;
+        }
+    }
+    
+    bool writeJson(const std::string& path) const {
+        std::ofstream out(path.c_str());
+        if (!out) return false;
+        out.precision(10);
+        
+        out << "{\n  \"context\": {\n";
+        out << "    \"label\": \"" << escapeJson(options.label) << "\",\n";
+        out << "    \"compiler\": \"" << escapeJson(__VERSION__) << "\",\n";
+        out << "    \"isa\": \"" << MathKernels::isaName(MathKernels::activeIsa()) << "\",\n";
+        out << "    \"threads\": " << ThreadPool::shared().size() << ",\n";
+        out << "    \"unit\": \"ns\"\n  },\n";
+        out << "  \"benchmarks\": [\n";
+        for (size_t r = 0; r < results.size(); r++) {
+            const BenchmarkResult& result = results[r];
+            out << "    {\"name\": \"" << escapeJson(result.name) << "\""
+                << ", \"iterations\": " << result.iterations
+                << ", \"items_per_call\": " << result.itemsPerCall
+                << ", \"median\": " << result.median
+                << ", \"mean\": " << result.mean
+                << ", \"stddev\": " << result.stddev
+                << ", \"min\": " << result.min
+                << ", \"max\": " << result.max
+                << ", \"samples\": [";
+            for (size_t s = 0; s < result.samples.size(); s++) {
+                out << (s ? ", " : "") << result.samples[s];
+            }
+            out << "], \"counters\": {";
+            size_t c = 0;
+            for (const auto& counter : result.counters) {
+                out << (c++ ? ", " : "") << "\"" << escapeJson(counter.first) << "\": " << counter.second;
+            }
+            out << "}}" << (r + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+        return static_cast<bool>(out);
+    }
+};
+
+TransformationPipeline makeBenchmarkPipeline() {
+    TransformationPipeline pipeline;
+    pipeline.setViewTransform(Vector3(0.0f, 0.0f, 5.0f), Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f));
+    pipeline.setProjection(45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+    pipeline.setModelTransform(Vector3(0.5f, 0.0f, 0.0f), Vector3(30.0f, 45.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f));
+    return pipeline;
+}
+
+// The inverse before the SIMD and affine paths: 16 cofactor submatrices
+// built with index loops, for comparison
+Matrix4x4 cofactorInverse(const Matrix4x4& matrix) {
+    Matrix4x4 result;
+    float invDet = 1.0f / matrix.determinant();
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            float submatrix[9];
+            int idx = 0;
+            for (int k = 0; k < 4; k++) {
+                if (k == i) continue;
+                for (int l = 0; l < 4; l++) {
+                    if (l != j) submatrix[idx++] = matrix.m[k][l];
+                }
+            }
+            float cofactor = ((i + j) % 2 == 0 ? 1.0f : -1.0f) *
+                matrix.det3x3(submatrix[0], submatrix[1], submatrix[2],
+                              submatrix[3], submatrix[4], submatrix[5],
+                              submatrix[6], submatrix[7], submatrix[8]);
+            result.m[j][i] = cofactor * invDet;
+        }
+    }
+    return result;
+}
+
+// Scalar math on batches of 1024 inputs, so each call is long enough to time
+void benchmarkMatrix(BenchmarkSuite& suite) {
+    const size_t count = 1024;
+    std::vector<Matrix4x4> matrices(count), products(count);
+    std::vector<Vector3> points(count), transformed(count);
+    for (size_t i = 0; i < count; i++) {
+        float f = static_cast<float>(i);
+        matrices[i] = Matrix4x4::translation(f * 0.01f, 1.0f, -2.0f) * Matrix4x4::rotationY(f) * Matrix4x4::scaling(1.0f, 2.0f, 0.5f);
+        points[i] = Vector3(f * 0.001f, 1.0f - f * 0.002f, 0.5f);
+    }
+    const Matrix4x4 view = Matrix4x4::lookAt(Vector3(0.0f, 0.0f, 5.0f), Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f));
+    const Matrix4x4 projection = Matrix4x4::perspective(45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+    std::vector<Matrix4x4> rigidMatrices(count), projected(count);
+    for (size_t i = 0; i < count; i++) {
+        float f = static_cast<float>(i);
+        rigidMatrices[i] = Matrix4x4::translation(f * 0.01f, 1.0f, -2.0f) * Matrix4x4::rotationY(f) * Matrix4x4::rotationX(f * 0.5f);
+        projected[i] = projection * view * matrices[i];
+    }
+    
+    suite.run("matrix/multiply", [&]() {
+        for (size_t i = 0; i < count; i++) products[i] = view * matrices[i];
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    suite.run("matrix/inverse_cofactor", [&]() {
+        for (size_t i = 0; i < count; i++) products[i] = cofactorInverse(matrices[i]);
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    suite.run("matrix/inverse", [&]() {
+        for (size_t i = 0; i < count; i++) products[i] = matrices[i].inverse();
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    suite.run("matrix/inverse_rigid", [&]() {
+        for (size_t i = 0; i < count; i++) products[i] = rigidMatrices[i].rigidInverse();
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    suite.run("matrix/inverse_general_cofactor", [&]() {
+        for (size_t i = 0; i < count; i++) products[i] = cofactorInverse(projected[i]);
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    suite.run("matrix/inverse_general", [&]() {
+        for (size_t i = 0; i < count; i++) products[i] = projected[i].inverse();
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    suite.run("matrix/normal_matrix", [&]() {
+        TransformationPipeline pipeline = makeBenchmarkPipeline();
+        for (size_t i = 0; i < count; i++) {
+            pipeline.setModelMatrix(matrices[i]);
+            products[i] = pipeline.getNormalMatrix();
+        }
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    suite.run("matrix/compose_euler", [&]() {
+        for (size_t i = 0; i < count; i++) {
+            products[i] = TransformationPipeline::composeModelMatrix(points[i], Vector3(30.0f, static_cast<float>(i), 10.0f), Vector3(1.0f, 2.0f, 0.5f));
+        }
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    suite.run("matrix/compose_chain", [&]() {
+        for (size_t i = 0; i < count; i++) {
+            const Vector3& t = points[i];
+            products[i] = Matrix4x4::translation(t.x, t.y, t.z) * Matrix4x4::rotationX(30.0f) *
+                          Matrix4x4::rotationY(static_cast<float>(i)) * Matrix4x4::rotationZ(10.0f) *
+                          Matrix4x4::scaling(1.0f, 2.0f, 0.5f);
+        }
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    suite.run("matrix/compose_quaternion", [&]() {
+        Quaternion rotation = Quaternion::fromEuler(Vector3(30.0f, 45.0f, 10.0f));
+        for (size_t i = 0; i < count; i++) {
+            products[i] = TransformationPipeline::composeModelMatrix(points[i], rotation, Vector3(1.0f, 2.0f, 0.5f));
+        }
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    suite.run("matrix/multiply_projective", [&]() {
+        for (size_t i = 0; i < count; i++) products[i] = projected[i] * matrices[i];
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    std::vector<Matrix4x4d> doubleMatrices(count), doubleProducts(count);
+    std::vector<Matrix4x4T<Fixed>> fixedMatrices(count), fixedProducts(count);
+    for (size_t i = 0; i < count; i++) {
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c < 4; c++) {
+                doubleMatrices[i].m[r][c] = matrices[i].m[r][c];
+                fixedMatrices[i].m[r][c] = Fixed(static_cast<double>(matrices[i].m[r][c]));
+            }
+        }
+    }
+    
+    suite.run("matrix/multiply_double", [&]() {
+        Matrix4x4d doubleView = doubleMatrices[0];
+        for (size_t i = 0; i < count; i++) doubleProducts[i] = doubleView * doubleMatrices[i];
+        benchmarkSink = static_cast<float>(doubleProducts[count / 2].m[0][1]);
+    }, count);
+    
+    suite.run("matrix/multiply_fixed", [&]() {
+        Matrix4x4T<Fixed> fixedView = fixedMatrices[0];
+        for (size_t i = 0; i < count; i++) fixedProducts[i] = fixedView * fixedMatrices[i];
+        benchmarkSink = static_cast<float>(fixedProducts[count / 2].m[0][1]);
+    }, count);
+    
+    suite.run("matrix/transform", [&]() {
+        for (size_t i = 0; i < count; i++) transformed[i] = view.transform(points[i]);
+        benchmarkSink = transformed[count / 2].x;
+    }, count);
+    
+    suite.run("matrix/lookAt", [&]() {
+        for (size_t i = 0; i < count; i++) {
+            products[i] = Matrix4x4::lookAt(points[i] + Vector3(0.0f, 0.0f, 5.0f), Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f));
+        }
+        benchmarkSink = products[count / 2].m[0][1];
+    }, count);
+    
+    suite.run("matrix/perspective", [&]() {
+        for (size_t i = 0; i < count; i++) {
+            products[i] = Matrix4x4::perspective(30.0f + points[i].x, 4.0f / 3.0f, 0.1f, 100.0f);
+        }
+        benchmarkSink = products[count / 2].m[0][0];
+    }, count);
+}
+
+void benchmarkVertexThroughput(BenchmarkSuite& suite) {
+    Object3D sphere = Object3D::createSphere(1.0f, 300);
+    const std::vector<Vector3>& vertices = sphere.vertices;
+    double count = static_cast<double>(vertices.size());
+    TransformationPipeline pipeline = makeBenchmarkPipeline();
+    std::vector<Vector3> out(vertices.size());
+    std::vector<float> clip(vertices.size() * 4);
+    
+    // Previous behaviour: the full MVP product is rebuilt for every vertex
+    suite.run("pipeline/mvp_rebuilt_per_vertex", [&]() {
+        for (size_t i = 0; i < vertices.size(); i++) {
+            Matrix4x4 mvp = pipeline.projectionMatrix * pipeline.viewMatrix * pipeline.modelMatrix;
+            out[i] = mvp.transform(vertices[i]);
+        }
+        benchmarkSink = out[vertices.size() / 2].x;
+    }, count);
+    
+    suite.run("pipeline/applyMVP", [&]() {
+        for (size_t i = 0; i < vertices.size(); i++) {
+            out[i] = pipeline.applyMVP(vertices[i]);
+        }
+        benchmarkSink = out[vertices.size() / 2].x;
+    }, count);
+    
+    suite.run("pipeline/batch_to_screen", [&]() {
+        pipeline.transformVerticesToScreen(vertices, out, 800, 600);
+        benchmarkSink = out[vertices.size() / 2].x;
+    }, count);
+    
+    suite.run("pipeline/batch_to_clip", [&]() {
+        pipeline.transformToClipSpace(vertices.data(), vertices.size(), clip.data());
+        benchmarkSink = clip[vertices.size() * 2];
+    }, count);
+}
+
+void benchmarkMathKernels(BenchmarkSuite& suite) {
+    Object3D sphere = Object3D::createSphere(1.0f, 300);
+    const std::vector<Vector3>& vertices = sphere.vertices;
+    double count = static_cast<double>(vertices.size());
+    
+    Matrix4x4 mvp = Matrix4x4::perspective(45.0f, 800.0f / 600.0f, 0.1f, 100.0f)
+                  * Matrix4x4::lookAt(Vector3(0.0f, 0.0f, 5.0f), Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f));
+    std::vector<Vector3> points(vertices.size());
+    std::vector<float> clip(vertices.size() * 4);
+    std::vector<Vector3> normalized(vertices.size());
+    
+    // Corner coordinates of one screen triangle per sphere vertex
+    std::vector<Vector3> cornersX(vertices.size()), cornersY(vertices.size());
+    std::vector<float> areas(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vector3& a = vertices[i];
+        const Vector3& b = vertices[(i + 1) % vertices.size()];
+        const Vector3& c = vertices[(i + 7) % vertices.size()];
+        cornersX[i] = Vector3(a.x, b.x, c.x) * 400.0f;
+        cornersY[i] = Vector3(a.y, b.y, c.y) * 300.0f;
+    }
+    
+    MathKernels::Isa isas[] = { MathKernels::Isa::Scalar, MathKernels::Isa::SSE2,
+                                MathKernels::Isa::AVX2, MathKernels::Isa::AVX512 };
+    MathKernels::Isa best = MathKernels::supportedIsa();
+    for (MathKernels::Isa isa : isas) {
+        if (!MathKernels::setIsa(isa)) continue;
+        std::string prefix = std::string("kernels/") + MathKernels::isaName(isa) + "/";
+        
+        suite.run(prefix + "transformPoints", [&]() {
+            mvp.transformPoints(vertices.data(), vertices.size(), points.data());
+            benchmarkSink = points[1].x;
+        }, count);
+        
+        suite.run(prefix + "transformPointsToClip", [&]() {
+            MathKernels::transformPointsToClip(&mvp.m[0][0], vertices.data(), vertices.size(), clip.data());
+            benchmarkSink = clip[5];
+        }, count);
+        
+        suite.run(prefix + "normalize", [&]() {
+            MathKernels::normalize(vertices.data(), vertices.size(), normalized.data());
+            benchmarkSink = normalized[1].y;
+        }, count);
+        
+        suite.run(prefix + "triangleAreas", [&]() {
+            MathKernels::triangleAreas(cornersX.data(), cornersY.data(), vertices.size(), areas.data());
+            benchmarkSink = areas[3];
+        }, count);
+    }
+    MathKernels::setIsa(best);
+}
+
+void benchmarkMeshGeneration(BenchmarkSuite& suite) {
+    const int resolutions[] = { 10, 50, 100, 500, 1000, 2000 };
+    for (int resolution : resolutions) {
+        std::string suffix = "/" + std::to_string(resolution);
+        double vertices = static_cast<double>(resolution) * resolution;
+        
+        suite.run("object3d/createSphere" + suffix, [&]() {
+            Object3D sphere = Object3D::createSphere(1.0f, resolution);
+            benchmarkSink = sphere.vertices.back().y;
+        }, vertices);
+        
+        if (!suite.enabled("object3d/calculateNormals")) continue;
+        Object3D sphere = Object3D::createSphere(1.0f, resolution);
+        suite.run("object3d/calculateNormals" + suffix, [&]() {
+            sphere.calculateNormals();
+            benchmarkSink = sphere.normals.back().y;
+        }, vertices);
+        
+        suite.run("object3d/calculateNormals_area" + suffix, [&]() {
+            sphere.calculateNormals(Object3D::NormalWeighting::Area);
+            benchmarkSink = sphere.normals.back().y;
+        }, vertices);
+        
+        // Goes through the vertex-to-corner adjacency; only the poles split
+        suite.run("object3d/calculateNormals_crease60" + suffix, [&]() {
+            sphere.calculateNormals(Object3D::NormalWeighting::Angle, 60.0f);
+            benchmarkSink = sphere.normals.back().y;
+        }, vertices);
+    }
+}
+
+// Rough heap footprint of an Object3D, counting one allocator header per face
+size_t object3DMemoryBytes(const Object3D& object) {
+    const size_t allocationOverhead = 16;
+    size_t bytes = object.vertices.capacity() * sizeof(Vector3)
+                 + object.normals.capacity() * sizeof(Vector3)
+                 + object.texCoords.capacity() * sizeof(std::pair<float, float>)
+                 + object.edges.capacity() * sizeof(std::pair<int, int>)
+                 + object.faces.capacity() * sizeof(std::vector<int>);
+    for (const auto& face : object.faces) {
+        bytes += face.capacity() * sizeof(int) + allocationOverhead;
+    }
+    return bytes;
+}
+
+void benchmarkMeshLayout(BenchmarkSuite& suite) {
+    if (!suite.enabled("mesh/")) return;
+    
+    // 707 x 708 quads, about one million triangles
+    Object3D sphere = Object3D::createSphere(1.0f, 708);
+    IndexedMesh mesh = IndexedMesh::fromObject3D(sphere);
+    double triangles = static_cast<double>(mesh.triangleCount());
+    
+    // Traversal: accumulate every triangle's unnormalized normal
+    suite.run("mesh/traversal_object3d", [&]() {
+        Vector3 sum;
+        for (const auto& face : sphere.faces) {
+            const Vector3& a = sphere.vertices[face[0]];
+            for (size_t i = 1; i + 1 < face.size(); i++) {
+                sum = sum + (sphere.vertices[face[i]] - a).cross(sphere.vertices[face[i + 1]] - a);
+            }
+        }
+        benchmarkSink = sum.x;
+    }, triangles);
+    suite.addCounter("mesh/traversal_object3d", "bytes_per_triangle", object3DMemoryBytes(sphere) / triangles);
+    
+    std::string indexedName = std::string("mesh/traversal_indexed_") + (IndexedMesh::interleaved ? "interleaved" : "soa");
+    suite.run(indexedName, [&]() {
+        Vector3 sum;
+        const uint32_t* indices = mesh.indices.data();
+        for (size_t t = 0; t < mesh.triangleCount(); t++) {
+            Vector3 a = mesh.position(indices[t * 3]);
+            sum = sum + (mesh.position(indices[t * 3 + 1]) - a).cross(mesh.position(indices[t * 3 + 2]) - a);
+        }
+        benchmarkSink = sum.x;
+    }, triangles);
+    suite.addCounter(indexedName, "bytes_per_triangle", mesh.memoryBytes() / triangles);
+}
+
+void benchmarkMeshImport(BenchmarkSuite& suite) {
+    if (!suite.enabled("import/")) return;
+    
+    const char* path = "benchmark_sphere.obj";
+    Object3D sphere = Object3D::createSphere(1.0f, 500);
+    FILE* out = std::fopen(path, "w");
+    if (out == nullptr) return;
+    for (const auto& v : sphere.vertices) std::fprintf(out, "v %.7f %.7f %.7f\n", v.x, v.y, v.z);
+    for (const auto& n : sphere.normals) std::fprintf(out, "vn %.6f %.6f %.6f\n", n.x, n.y, n.z);
+    for (const auto& face : sphere.faces) {
+        std::fprintf(out, "f");
+        for (int i : face) std::fprintf(out, " %d//%d", i + 1, i + 1);
+        std::fprintf(out, "\n");
+    }
+    std::fclose(out);
+    std::remove(MeshCache::cachePathFor(path).c_str());
+    
+    double vertices = static_cast<double>(sphere.vertices.size());
+    suite.run("import/parse_obj", [&]() {
+        Object3D parsed = MeshLoader::load(path);
+        benchmarkSink = parsed.vertices[1].x;
+    }, vertices);
+    
+    // The first call writes the cache; the timed calls map it
+    MeshCache::load(path);
+    suite.run("import/cached", [&]() {
+        MeshCache cached = MeshCache::load(path);
+        benchmarkSink = cached.positions()[1].y;
+    }, vertices);
+    
+    std::remove(MeshCache::cachePathFor(path).c_str());
+    std::remove(path);
+}
+
+// World matrix update of a 100k-node hierarchy (eight children per node):
+// moving the root recomputes every node, moving a leaf only that leaf
+void benchmarkSceneGraph(BenchmarkSuite& suite) {
+    const size_t nodeCount = 100000;
+    SceneGraph scene;
+    std::vector<SceneGraph::NodeId> nodes;
+    nodes.push_back(scene.addNode(SceneGraph::INVALID_NODE));
+    for (size_t i = 1; i < nodeCount; i++) {
+        nodes.push_back(scene.addNode(nodes[(i - 1) / 8], Vector3(1.0f, 0.0f, 0.0f),
+                                      Vector3(0.0f, static_cast<float>(i % 360), 0.0f), Vector3(1.0f, 1.0f, 1.0f)));
+    }
+    scene.update();
+    
+    Matrix4x4 rootMatrix = Matrix4x4::rotationY(1.0f);
+    suite.run("scene/update_root_moved_100k", [&]() {
+        scene.setLocalMatrix(nodes[0], rootMatrix);
+        scene.update();
+        benchmarkSink = scene.worldMatrixArray()[nodeCount - 1].m[0][3];
+    }, static_cast<double>(nodeCount));
+    
+    Matrix4x4 leafMatrix = Matrix4x4::translation(0.0f, 1.0f, 0.0f);
+    suite.run("scene/update_leaf_moved_100k", [&]() {
+        scene.setLocalMatrix(nodes[nodeCount - 1], leafMatrix);
+        scene.update();
+        benchmarkSink = scene.worldMatrixArray()[nodeCount - 1].m[1][3];
+    }, static_cast<double>(nodeCount));
+}
+
+// Frustum culling of 100k unit boxes scattered over a 200x40x200 volume,
+// with a 60 degree camera seeing about a sixth of them
+void benchmarkCulling(BenchmarkSuite& suite) {
+    const size_t instanceCount = 100000;
+    std::vector<AABB> bounds(instanceCount);
+    uint32_t seed = 1;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) * (1.0f / 16777216.0f) * 200.0f - 100.0f;
+    };
+    for (auto& box : bounds) {
+        Vector3 center(random(), random() * 0.2f, random());
+        box = AABB(center - Vector3(0.5f, 0.5f, 0.5f), center + Vector3(0.5f, 0.5f, 0.5f));
+    }
+    
+    TransformationPipeline pipeline;
+    pipeline.setViewTransform(Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 0.0f, -1.0f), Vector3(0.0f, 1.0f, 0.0f));
+    pipeline.setProjection(60.0f, 4.0f / 3.0f, 0.1f, 100.0f);
+    const Frustum& frustum = pipeline.getFrustum();
+    BVH bvh(bounds);
+    
+    CullStats stats;
+    suite.run("cull/linear_100k", [&]() {
+        size_t visible = 0;
+        for (const auto& box : bounds) visible += frustum.intersects(box);
+        benchmarkSink = static_cast<float>(visible);
+    }, static_cast<double>(instanceCount));
+    
+    suite.run("cull/bvh_100k", [&]() {
+        stats.reset();
+        size_t visible = 0;
+        bvh.cull(frustum, stats, [&](size_t) { visible++; });
+        benchmarkSink = static_cast<float>(visible);
+    }, static_cast<double>(instanceCount));
+    suite.addCounter("cull/bvh_100k", "objects_tested", static_cast<double>(stats.objectsTested));
+    suite.addCounter("cull/bvh_100k", "objects_drawn", static_cast<double>(stats.objectsDrawn));
+    suite.addCounter("cull/bvh_100k", "nodes_tested", static_cast<double>(stats.nodesTested));
+    
+    // 1% of the instances move a little each call
+    size_t next = 0;
+    suite.run("cull/bvh_refit_1k_moved", [&]() {
+        for (size_t i = 0; i < 1000; i++) {
+            size_t instance = (next++ * 7919) % instanceCount;
+            AABB box = bvh.instance(instance);
+            Vector3 step((instance & 1) ? 0.01f : -0.01f, 0.0f, 0.01f);
+            bvh.setInstanceBounds(instance, AABB(box.min + step, box.max + step));
+        }
+        bvh.refit();
+        benchmarkSink = bvh.bounds().max.x;
+    }, 1000.0);
+}
+
+// Filtered texture lookups over a 256x256 mip chain, as in textured spans
+void benchmarkTextureSampling(BenchmarkSuite& suite) {
+    std::vector<uint32_t> texels(256 * 256);
+    for (size_t i = 0; i < texels.size(); i++) texels[i] = static_cast<uint32_t>(i * 2654435761u);
+    Texture texture(256, 256, texels.data());
+    
+    const int count = 1024;
+    std::vector<float> u(count), v(count);
+    std::vector<uint32_t> out(count);
+    for (int i = 0; i < count; i++) {
+        u[i] = i * 0.0137f - 3.0f;
+        v[i] = i * 0.0071f + 0.25f;
+    }
+    
+    const Texture::Filter filters[] = { Texture::Filter::Nearest, Texture::Filter::Bilinear, Texture::Filter::Trilinear };
+    const char* names[] = { "texture/sample_nearest", "texture/sample_bilinear", "texture/sample_trilinear" };
+    for (int f = 0; f < 3; f++) {
+        suite.run(names[f], [&]() {
+            texture.sample(u.data(), v.data(), count, filters[f], 1.4f, out.data());
+            benchmarkSink = static_cast<float>(out[count / 2]);
+        }, count);
+    }
+}
+
+// Headless end-to-end frame: 100 spheres and cubes drawn by the software
+// backend, which implements the same interface as the OpenGL Renderer
+void benchmarkFrame(BenchmarkSuite& suite) {
+    std::vector<Object3D> objects;
+    objects.push_back(Object3D::createSphere(1.0f, 40));
+    objects.push_back(Object3D::createCube(1.0f));
+    
+    Texture texture = Texture::createProcedural("checkerboard");
+    
+    const char* modes[] = { "filled", "wireframe", "textured" };
+    for (const char* mode : modes) {
+        std::string name = std::string("frame/software_") + mode + "_800x600";
+        if (!suite.enabled(name)) continue;
+        
+        SoftwareRenderer renderer(800, 600);
+        if (std::string(mode) == "wireframe") renderer.toggleWireframe();
+        if (std::string(mode) == "textured") renderer.bindTexture(&texture);
+        
+        suite.run(name, [&]() {
+            renderer.beginFrame();
+            for (int i = 0; i < 100; i++) {
+                renderer.setModelTransform(Vector3((i % 10) - 4.5f, (i / 10) - 4.5f, -10.0f),
+                                           Vector3(30.0f, 30.0f + i, 0.0f), Vector3(0.4f, 0.4f, 0.4f));
+                renderer.renderObject(objects[i % 2]);
+            }
+            renderer.endFrame();
+            benchmarkSink = static_cast<float>(renderer.getColorBuffer()[300 * 800 + 400]);
+        });
+    }
+}
+
+// A textured ground slab reaching behind the camera and past the far plane
+// plus dense spheres straddling the near plane, the clipping the frame
+// benchmarks above never exercise
+void renderClippingScene(SoftwareRenderer& renderer, const Object3D& ground, const Object3D& sphere) {
+    renderer.setModelTransform(Vector3(0.0f, -1.5f, 0.0f), Vector3(0.0f, 0.0f, 0.0f), Vector3(300.0f, 0.2f, 300.0f));
+    renderer.renderObject(ground);
+    for (int i = 0; i < 4; i++) {
+        renderer.setModelTransform(Vector3((i % 2) * 0.3f - 0.15f, (i / 2) * 0.2f - 0.1f, 4.7f - i * 0.05f),
+                                   Vector3(0.0f, static_cast<float>(i), 0.0f), Vector3(0.3f, 0.3f, 0.3f));
+        renderer.renderObject(sphere);
+    }
+}
+
+void benchmarkClipping(BenchmarkSuite& suite) {
+    const char* name = "clipping/software_near_plane_800x600";
+    if (!suite.enabled(name)) return;
+    
+    Object3D ground = Object3D::createCube(1.0f);
+    Object3D sphere = Object3D::createSphere(1.0f, 64);
+    Texture texture = Texture::createProcedural("checkerboard");
+    SoftwareRenderer renderer(800, 600);
+    renderer.toggleWireframe();
+    renderer.bindTexture(&texture);
+    suite.run(name, [&]() {
+        renderer.beginFrame();
+        renderClippingScene(renderer, ground, sphere);
+        renderer.endFrame();
+        benchmarkSink = static_cast<float>(renderer.getColorBuffer()[300 * 800 + 400]);
+    });
+    const CullStats& stats = renderer.getCullStats();
+    suite.addCounter(name, "triangles_accepted", static_cast<double>(stats.trianglesAccepted));
+    suite.addCounter(name, "triangles_clipped", static_cast<double>(stats.trianglesClipped));
+    suite.addCounter(name, "triangles_rejected", static_cast<double>(stats.trianglesRejected));
+}
+
+// 100 filled spheres with and without back-face culling; the closed
+// meshes rasterize the same pixels either way
+void benchmarkFaceCulling(BenchmarkSuite& suite) {
+    Object3D sphere = Object3D::createSphere(1.0f, 48);
+    const char* names[] = { "facecull/software_spheres_none", "facecull/software_spheres_back" };
+    RenderBackend::CullMode modes[] = { RenderBackend::CullMode::None, RenderBackend::CullMode::Back };
+    for (int m = 0; m < 2; m++) {
+        if (!suite.enabled(names[m])) continue;
+        
+        SoftwareRenderer renderer(800, 600);
+        renderer.toggleWireframe();
+        renderer.setCullMode(modes[m]);
+        suite.run(names[m], [&]() {
+            renderer.beginFrame();
+            for (int i = 0; i < 100; i++) {
+                renderer.setModelTransform(Vector3((i % 10) - 4.5f, (i / 10) - 4.5f, -10.0f),
+                                           Vector3(30.0f, 30.0f + i, 0.0f), Vector3(0.6f, 0.6f, 0.6f));
+                renderer.renderObject(sphere);
+            }
+            renderer.endFrame();
+            benchmarkSink = static_cast<float>(renderer.getColorBuffer()[300 * 800 + 400]);
+        });
+        const CullStats& stats = renderer.getCullStats();
+        suite.addCounter(names[m], "triangles_culled_facing", static_cast<double>(stats.trianglesCulledFacing));
+        suite.addCounter(names[m], "triangles_culled_small", static_cast<double>(stats.trianglesCulledSmall));
+    }
+}
+
+// One cube instanced 1k, 10k and 100k times over the same screen area; the
+// items are instances, so flat throughput shows as a flat time per item
+void benchmarkInstancing(BenchmarkSuite& suite) {
+    Object3D cube = Object3D::createCube(1.0f);
+    const size_t counts[] = { 1000, 10000, 100000 };
+    const char* names[] = { "instancing/software_cubes_1k", "instancing/software_cubes_10k", "instancing/software_cubes_100k" };
+    for (int c = 0; c < 3; c++) {
+        if (!suite.enabled(names[c])) continue;
+        
+        size_t count = counts[c];
+        size_t side = static_cast<size_t>(std::sqrt(static_cast<double>(count))) + 1;
+        float spacing = 12.0f / side;
+        std::vector<InstanceData> instances;
+        instances.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            instances.push_back(InstanceData(Vector3((i % side) * spacing - 6.0f, (i / side) * spacing * 0.75f - 4.5f, -10.0f),
+                                             Vector3(30.0f, 30.0f + i, 0.0f), Vector3(spacing * 0.4f, spacing * 0.4f, spacing * 0.4f),
+                                             (i % 3) * 0.5f, (i % 5) * 0.25f, 0.5f));
+        }
+        
+        SoftwareRenderer renderer(800, 600);
+        suite.run(names[c], [&]() {
+            renderer.beginFrame();
+            renderer.renderInstances(cube, instances);
+            renderer.endFrame();
+            benchmarkSink = static_cast<float>(renderer.getColorBuffer()[300 * 800 + 400]);
+        }, static_cast<double>(count));
+        suite.addCounter(names[c], "instances_drawn", static_cast<double>(renderer.getCullStats().objectsDrawn));
+    }
+}
+
+// A field of 1000 spheres receding from 5 to 100 units, drawn at full
+// detail and through LOD chains picked by projected size
+void benchmarkLOD(BenchmarkSuite& suite) {
+    Object3D sphere = Object3D::createSphere(1.0f, 48);
+    
+    suite.run("lod/build_chain_sphere_48", [&]() {
+        LODChain chain = LODChain::build(sphere);
+        benchmarkSink = static_cast<float>(chain.levelCount());
+    }, static_cast<double>(MeshSimplifier::triangleCount(sphere)));
+    
+    LODChain chain = LODChain::build(sphere);
+    const int objectCount = 1000;
+    std::vector<size_t> levels(objectCount, 0);
+    
+    const char* modes[] = { "full", "lod" };
+    for (const char* mode : modes) {
+        std::string name = std::string("lod/scene_") + mode + "_1000_spheres";
+        if (!suite.enabled(name)) continue;
+        bool useLOD = std::string(mode) == "lod";
+        
+        SoftwareRenderer renderer(800, 600);
+        size_t triangles = 0;
+        suite.run(name, [&]() {
+            triangles = 0;
+            renderer.beginFrame();
+            for (int i = 0; i < objectCount; i++) {
+                float depth = 5.0f + 95.0f * i / objectCount;
+                float spread = depth * 0.35f;
+                renderer.setModelTransform(Vector3(((i * 37) % 21 - 10) * spread / 10.0f, ((i * 53) % 15 - 7) * spread / 10.0f, 5.0f - depth),
+                                           Vector3(0.0f, i * 7.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f));
+                size_t level = useLOD ? renderer.selectLOD(chain, levels[i]) : 0;
+                levels[i] = level;
+                triangles += chain.levels[level].triangleCount;
+                renderer.renderObject(chain.level(level));
+            }
+            renderer.endFrame();
+            benchmarkSink = static_cast<float>(renderer.getColorBuffer()[300 * 800 + 400]);
+        });
+        suite.addCounter(name, "triangles_submitted", static_cast<double>(triangles));
+    }
+}
+
+// Indoor-style scene: a wall in front of 2000 spheres, most of them hidden,
+// drawn filled with and without hierarchical-Z occlusion culling
+void benchmarkOcclusion(BenchmarkSuite& suite) {
+    Object3D wall = Object3D::createCube(1.0f);
+    Object3D sphere = Object3D::createSphere(0.5f, 24);
+    
+    const char* modes[] = { "off", "hiz" };
+    for (int occlusion = 0; occlusion < 2; occlusion++) {
+        std::string name = std::string("occlusion/software_") + modes[occlusion] + "_2000_spheres";
+        if (!suite.enabled(name)) continue;
+        
+        SoftwareRenderer renderer(800, 600);
+        renderer.toggleWireframe();
+        renderer.setOcclusionCulling(occlusion != 0);
+        suite.run(name, [&]() {
+            renderer.beginFrame();
+            renderer.setModelTransform(Vector3(0.0f, 0.0f, -6.0f), Vector3(0.0f, 10.0f, 0.0f), Vector3(8.0f, 5.0f, 0.3f));
+            renderer.addOccluder(wall);
+            renderer.renderObject(wall);
+            for (int i = 0; i < 2000; i++) {
+                Vector3 position(((i * 37) % 41 - 20) * 0.5f, ((i * 53) % 31 - 15) * 0.4f, -8.0f - (i % 50) * 0.6f);
+                renderer.setModelTransform(position, Vector3(0.0f, static_cast<float>(i), 0.0f), Vector3(1.0f, 1.0f, 1.0f));
+                renderer.renderObject(sphere);
+            }
+            renderer.endFrame();
+            benchmarkSink = static_cast<float>(renderer.getColorBuffer()[300 * 800 + 400]);
+        });
+        suite.addCounter(name, "objects_occluded", static_cast<double>(renderer.getCullStats().objectsOccluded));
+        suite.addCounter(name, "objects_drawn", static_cast<double>(renderer.getCullStats().objectsDrawn));
+    }
+}
+
+// Tipsify ordering of a 500x500 sphere, with and without overdraw
+// clustering, and a software frame of the sphere before and after. The CPU
+// path transforms every vertex once per draw regardless of order, so there
+// only vertex fetch locality changes; ACMR is what the GPU path saves.
+void benchmarkMeshOptimizer(BenchmarkSuite& suite) {
+    const char* names[] = { "meshopt/optimize_sphere_500", "meshopt/optimize_overdraw_sphere_500" };
+    const char* frames[] = { "meshopt/software_sphere_500_original", "meshopt/software_sphere_500_optimized" };
+    bool enabled = false;
+    for (int i = 0; i < 2; i++) enabled = enabled || suite.enabled(names[i]) || suite.enabled(frames[i]);
+    if (!enabled) return;
+    
+    Object3D sphere = Object3D::createSphere(1.0f, 500);
+    double triangles = static_cast<double>(MeshOptimizer::triangulate(sphere).size() / 3);
+    
+    for (int overdraw = 0; overdraw < 2; overdraw++) {
+        if (!suite.enabled(names[overdraw])) continue;
+        MeshOptimizer::Report report;
+        suite.run(names[overdraw], [&]() {
+            Object3D copy = sphere;
+            report = MeshOptimizer::optimize(copy, overdraw != 0);
+            benchmarkSink = copy.vertices.back().y;
+        }, triangles);
+        suite.addCounter(names[overdraw], "acmr_before", report.before.acmr());
+        suite.addCounter(names[overdraw], "acmr_after", report.after.acmr());
+        suite.addCounter(names[overdraw], "atvr_before", report.before.atvr());
+        suite.addCounter(names[overdraw], "atvr_after", report.after.atvr());
+    }
+    
+    Object3D optimized = sphere;
+    MeshOptimizer::optimize(optimized);
+    const Object3D* meshes[] = { &sphere, &optimized };
+    for (int i = 0; i < 2; i++) {
+        if (!suite.enabled(frames[i])) continue;
+        SoftwareRenderer renderer(800, 600);
+        renderer.setModelTransform(Vector3(0.0f, 0.0f, 0.0f), Vector3(30.0f, 30.0f, 0.0f), Vector3(1.5f, 1.5f, 1.5f));
+        suite.run(frames[i], [&]() {
+            renderer.beginFrame();
+            renderer.renderObject(*meshes[i]);
+            renderer.endFrame();
+            benchmarkSink = static_cast<float>(renderer.getColorBuffer()[300 * 800 + 400]);
+        }, triangles);
+    }
+}
+
+// Triangulated grid of 10M faces, the size edge extraction must handle
+// well under a second
+void benchmarkEdgeExtraction(BenchmarkSuite& suite) {
+    const char* names[] = { "edges/extract_grid_10m", "edges/extract_tagged_grid_10m" };
+    if (!suite.enabled(names[0]) && !suite.enabled(names[1])) return;
+    
+    const int side = 2237;
+    Object3D grid;
+    grid.vertices.reserve(static_cast<size_t>(side + 1) * (side + 1));
+    for (int y = 0; y <= side; y++) {
+        for (int x = 0; x <= side; x++) {
+            grid.vertices.push_back(Vector3(static_cast<float>(x), static_cast<float>(y), std::sin(x * 0.1f) * std::cos(y * 0.1f)));
+        }
+    }
+    grid.faces.reserve(static_cast<size_t>(side) * side * 2);
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            int i = y * (side + 1) + x;
+            grid.faces.push_back({ i, i + 1, i + side + 2 });
+            grid.faces.push_back({ i, i + side + 2, i + side + 1 });
+        }
+    }
+    double faces = static_cast<double>(grid.faces.size());
+    
+    for (int tagged = 0; tagged < 2; tagged++) {
+        if (!suite.enabled(names[tagged])) continue;
+        suite.run(names[tagged], [&]() {
+            grid.extractEdges(tagged != 0);
+            benchmarkSink = static_cast<float>(grid.edges.back().second);
+        }, faces);
+        suite.addCounter(names[tagged], "edges", static_cast<double>(grid.edges.size()));
+    }
+}
+
+// 10k objects with eight keys per track, sampled at an advancing time.
+// The chain baseline is the former per-object path: lerped Euler angles
+// turned into five matrices and four products.
+void benchmarkAnimation(BenchmarkSuite& suite) {
+    const size_t objectCount = 10000;
+    const int keyCount = 8;
+    const float keySpacing = 0.5f;
+    std::vector<Vector3> translations, rotations, scales;
+    AnimationSet animation;
+    for (size_t o = 0; o < objectCount; o++) {
+        std::vector<VectorKey> translationKeys, scaleKeys;
+        std::vector<RotationKey> rotationKeys;
+        for (int k = 0; k < keyCount; k++) {
+            float f = static_cast<float>(o * keyCount + k);
+            Vector3 position(std::sin(f) * 10.0f, std::cos(f * 0.7f) * 10.0f, -f * 0.001f);
+            Vector3 euler(std::fmod(f * 37.0f, 360.0f), std::fmod(f * 53.0f, 360.0f), std::fmod(f * 11.0f, 360.0f));
+            Vector3 size(1.0f + 0.1f * std::sin(f), 1.0f, 1.0f + 0.1f * std::cos(f));
+            translations.push_back(position);
+            rotations.push_back(euler);
+            scales.push_back(size);
+            translationKeys.push_back({ k * keySpacing, position });
+            rotationKeys.push_back({ k * keySpacing, Quaternion::fromEuler(euler) });
+            scaleKeys.push_back({ k * keySpacing, size });
+        }
+        animation.addObject(translationKeys, rotationKeys, scaleKeys);
+    }
+    std::vector<InstanceData> instances(objectCount);
+    float duration = animation.getDuration();
+    float time = 0.0f;
+    
+    suite.run("animation/euler_matrix_chain_10k", [&]() {
+        time = std::fmod(time + 1.0f / 60.0f, duration);
+        int k = std::min(static_cast<int>(time / keySpacing), keyCount - 2);
+        float alpha = time / keySpacing - k;
+        for (size_t o = 0; o < objectCount; o++) {
+            size_t a = o * keyCount + k;
+            Vector3 t = translations[a] + (translations[a + 1] - translations[a]) * alpha;
+            Vector3 r = rotations[a] + (rotations[a + 1] - rotations[a]) * alpha;
+            Vector3 s = scales[a] + (scales[a + 1] - scales[a]) * alpha;
+            instances[o].setMatrix(Matrix4x4::translation(t.x, t.y, t.z) * Matrix4x4::rotationX(r.x) *
+                                   Matrix4x4::rotationY(r.y) * Matrix4x4::rotationZ(r.z) *
+                                   Matrix4x4::scaling(s.x, s.y, s.z));
+        }
+        benchmarkSink = instances[objectCount / 2].transform[0][3];
+    }, static_cast<double>(objectCount));
+    
+    const char* names[] = { "animation/soa_nlerp_10k", "animation/soa_slerp_10k" };
+    const AnimationSet::Interpolation modes[] = { AnimationSet::Interpolation::NLERP, AnimationSet::Interpolation::SLERP };
+    for (int m = 0; m < 2; m++) {
+        animation.setInterpolation(modes[m]);
+        suite.run(names[m], [&]() {
+            time = std::fmod(time + 1.0f / 60.0f, duration);
+            animation.evaluate(time, instances.data());
+            benchmarkSink = instances[objectCount / 2].transform[0][3];
+        }, static_cast<double>(objectCount));
+    }
+}
+
+// Renders a few frames of each scenario to warm up, then counts the heap
+// allocations of the frames after that, which should be none. Returns the
+// number of scenarios that allocated.
+int checkAllocations() {
+    Object3D sphere = Object3D::createSphere(1.0f, 40);
+    Object3D cube = Object3D::createCube(1.0f);
+    Texture texture = Texture::createProcedural("checkerboard");
+    std::vector<InstanceData> instances;
+    for (int i = 0; i < 2000; i++) {
+        instances.push_back(InstanceData(Vector3((i % 50) * 0.25f - 6.0f, (i / 50) * 0.25f - 5.0f, -10.0f),
+                                         Vector3(30.0f, 30.0f + i, 0.0f), Vector3(0.1f, 0.1f, 0.1f), 0.8f, 0.4f, 0.2f));
+    }
+    
+    const char* scenarios[] = { "filled", "wireframe", "textured", "instanced", "occlusion", "clipping" };
+    const int warmupFrames = 3;
+    const int checkedFrames = 10;
+    int failures = 0;
+    for (const char* scenario : scenarios) {
+        std::string mode = scenario;
+        SoftwareRenderer renderer(800, 600);
+        if (mode == "wireframe" || mode == "clipping") renderer.toggleWireframe();
+        if (mode == "textured" || mode == "clipping") renderer.bindTexture(&texture);
+        renderer.setOcclusionCulling(mode == "occlusion");
+        
+        auto frame = [&]() {
+            renderer.beginFrame();
+            if (mode == "instanced") {
+                renderer.renderInstances(cube, instances);
+            } else if (mode == "clipping") {
+                renderClippingScene(renderer, cube, sphere);
+            } else {
+                if (mode == "occlusion") {
+                    renderer.setModelTransform(Vector3(0.0f, 0.0f, -6.0f), Vector3(0.0f, 10.0f, 0.0f), Vector3(4.0f, 3.0f, 0.3f));
+                    renderer.addOccluder(cube);
+                    renderer.renderObject(cube);
+                }
+                for (int i = 0; i < 100; i++) {
+                    renderer.setModelTransform(Vector3((i % 10) - 4.5f, (i / 10) - 4.5f, -10.0f),
+                                               Vector3(30.0f, 30.0f + i, 0.0f), Vector3(0.4f, 0.4f, 0.4f));
+                    renderer.renderObject(i % 2 ? cube : sphere);
+                }
+            }
+            renderer.endFrame();
+        };
+        
+        for (int i = 0; i < warmupFrames; i++) frame();
+        size_t before = heapAllocations.load();
+        for (int i = 0; i < checkedFrames; i++) frame();
+        double perFrame = static_cast<double>(heapAllocations.load() - before) / checkedFrames;
+        std::cout << "allocations/" << mode << ": " << perFrame << " per frame" << std::endl;
+        if (perFrame > 0.0) failures++;
+    }
+    return failures;
+}
+
+// Occlusion culling must never change the image: every scene is rendered
+// filled with and without it and the color buffers compared. Returns the
+// number of scenes that differ.
+int checkOcclusion() {
+    Object3D sphere = Object3D::createSphere(1.0f, 40);
+    Object3D cube = Object3D::createCube(1.0f);
+    
+    const char* scenes[] = { "wall", "occluder_inside_near_plane" };
+    int failures = 0;
+    for (const char* scene : scenes) {
+        std::string name = scene;
+        std::vector<uint32_t> images[2];
+        size_t occluded = 0;
+        for (int occlusion = 0; occlusion < 2; occlusion++) {
+            SoftwareRenderer renderer(320, 240);
+            renderer.toggleWireframe();
+            renderer.setOcclusionCulling(occlusion != 0);
+            renderer.beginFrame();
+            if (name == "wall") {
+                renderer.setModelTransform(Vector3(0.0f, 0.0f, -6.0f), Vector3(0.0f, 10.0f, 0.0f), Vector3(4.0f, 3.0f, 0.3f));
+                renderer.addOccluder(cube);
+                renderer.renderObject(cube);
+                for (int i = 0; i < 100; i++) {
+                    renderer.setModelTransform(Vector3((i % 10) - 4.5f, (i / 10) - 4.5f, -10.0f),
+                                               Vector3(30.0f, 30.0f + i, 0.0f), Vector3(0.4f, 0.4f, 0.4f));
+                    renderer.renderObject(i % 2 ? cube : sphere);
+                }
+            } else {
+                // A thin wall between the camera (z = 5) and its near plane
+                // (0.1 in front), which the rasterizer clips away entirely
+                renderer.setModelTransform(Vector3(0.0f, 0.0f, 4.95f), Vector3(0.0f, 0.0f, 0.0f), Vector3(10.0f, 10.0f, 0.001f));
+                renderer.addOccluder(cube);
+                renderer.renderObject(cube);
+                renderer.setModelTransform(Vector3(1.0f, 0.3f, 0.0f), Vector3(0.0f, 0.0f, 0.0f), Vector3(0.3f, 0.3f, 0.3f));
+                renderer.renderObject(cube);
+            }
+            renderer.endFrame();
+            images[occlusion] = renderer.getColorBuffer();
+            occluded = renderer.getCullStats().objectsOccluded;
+        }
+        bool passed = images[0] == images[1];
+        std::cout << "occlusion/" << name << ": " << (passed ? "ok" : "FAILED") << " (" << occluded << " objects occluded)" << std::endl;
+        if (!passed) failures++;
+    }
+    return failures;
+}
+
+// Loads a three-vertex ASCII PLY with the given vertex properties; false
+// when loading throws
+bool loadTriangle(const char* path, const char* properties, const char* vertices, Object3D& object) {
+    FILE* out = std::fopen(path, "w");
+    if (out == nullptr) return false;
+    std::fprintf(out, "ply\nformat ascii 1.0\nelement vertex 3\n%s"
+                      "element face 1\nproperty list uchar int vertex_indices\nend_header\n%s3 0 1 2\n",
+                 properties, vertices);
+    std::fclose(out);
+    std::remove(MeshCache::cachePathFor(path).c_str());
+    bool loaded = true;
+    try {
+        object = MeshLoader::load(path);
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        loaded = false;
+    }
+    std::remove(path);
+    return loaded;
+}
+
+// True when loading a file with the given content throws
+// std::runtime_error, the loaders' documented failure for malformed files
+bool rejectsMalformed(const char* path, const std::string& content) {
+    FILE* out = std::fopen(path, "wb");
+    if (out == nullptr) return false;
+    std::fwrite(content.data(), 1, content.size(), out);
+    std::fclose(out);
+    std::remove(MeshCache::cachePathFor(path).c_str());
+    bool rejected = false;
+    try {
+        MeshLoader::load(path);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+    }
+    std::remove(path);
+    return rejected;
+}
+
+// PLY vertex properties that only look like half a texture coordinate or
+// normal must not be stored as one, and malformed counts and indices must
+// be reported as such. Returns the number of failed cases.
+int checkLoaders() {
+    const char* path = "check_loader.ply";
+    int failures = 0;
+    auto report = [&](const char* name, bool passed) {
+        std::cout << "loaders/" << name << ": " << (passed ? "ok" : "FAILED") << std::endl;
+        if (!passed) failures++;
+    };
+    
+    Object3D object;
+    bool loaded = loadTriangle(path, "property float x\nproperty float y\nproperty float z\nproperty float t\n",
+                               "0 0 0 5\n1 0 0 6\n0 1 0 7\n", object);
+    report("lone_t", loaded && object.texCoords.empty() && object.vertices[1].x == 1.0f);
+    
+    loaded = loadTriangle(path, "property float x\nproperty float y\nproperty float z\n"
+                                "property float ny\nproperty float nz\n",
+                          "0 0 0 1 0\n1 0 0 1 0\n0 1 0 1 0\n", object);
+    report("ny_nz_without_nx", loaded && object.normals.size() == 3 && object.normals[0].z == 1.0f);
+    
+    loaded = loadTriangle(path, "property float x\nproperty float y\nproperty float z\n"
+                                "property float nx\nproperty float ny\nproperty float nz\n"
+                                "property float u\nproperty float v\n",
+                          "0 0 0 0 1 0 0 0\n1 0 0 0 1 0 1 0\n0 1 0 0 1 0 0 1\n", object);
+    report("full_attributes", loaded && object.texCoords.size() == 3 && object.texCoords[2].second == 1.0f &&
+                              object.normals.size() == 3 && object.normals[0].y == 1.0f);
+    
+    // One face whose signed char vertex count is -1
+    std::string binary = "ply\nformat binary_little_endian 1.0\nelement vertex 3\n"
+                         "property float x\nproperty float y\nproperty float z\n"
+                         "element face 1\nproperty list char int vertex_indices\nend_header\n";
+    binary += std::string(3 * 3 * sizeof(float), '\0');
+    binary += '\xff';
+    binary += std::string(3 * sizeof(int32_t), '\0');
+    report("negative_list_count", rejectsMalformed("check_loader_binary.ply", binary));
+    
+    report("index_overflow", rejectsMalformed("check_loader.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                                                                  "f 1 2 99999999999999999999999999999\n"));
+    return failures;
+}
+
+// Writes a one-triangle OBJ whose second vertex has the given x (one
+// digit, so the file size never changes) and sets its modification time
+bool writeTriangleObj(const char* path, int x, long modifiedAt) {
+    FILE* out = std::fopen(path, "w");
+    if (out == nullptr) return false;
+    std::fprintf(out, "v 0 0 0\nv %d 0 0\nv 0 1 0\nf 1 2 3\n", x);
+    std::fclose(out);
+    struct timeval times[2] = { { modifiedAt, 0 }, { modifiedAt, 0 } };
+    return utimes(path, times) == 0;
+}
+
+// A cache found valid by hashing after its source was touched must record
+// the new time, so the load after that trusts it without hashing. Returns
+// the number of failed cases.
+int checkCache() {
+    const char* path = "check_cache.obj";
+    std::string cachePath = MeshCache::cachePathFor(path);
+    std::remove(cachePath.c_str());
+    int failures = 0;
+    auto report = [&](const char* name, bool passed) {
+        std::cout << "cache/" << name << ": " << (passed ? "ok" : "FAILED") << std::endl;
+        if (!passed) failures++;
+    };
+    
+    try {
+        bool written = writeTriangleObj(path, 1, 1000000000);
+        report("build", written && MeshCache::load(path).positions()[1].x == 1.0f);
+        
+        // Touch: same content, new time
+        written = writeTriangleObj(path, 1, 1000000100);
+        MeshCache::load(path);
+        report("touch_records_time", written &&
+               MeshCache::open(cachePath).header().sourceModifiedAt == MappedFile(path).modifiedAt());
+        
+        // Same size and time as the touched file, so only the fast path
+        // returns the old content
+        written = writeTriangleObj(path, 2, 1000000100);
+        report("touch_then_fast_path", written && MeshCache::load(path).positions()[1].x == 1.0f);
+        
+        written = writeTriangleObj(path, 2, 1000000200);
+        report("changed_content_rebuilds", written && MeshCache::load(path).positions()[1].x == 2.0f);
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        report("exception", false);
+    }
+    std::remove(cachePath.c_str());
+    std::remove(path);
+    return failures;
+}
+
+// Kernel outputs of one instruction set, compared bit for bit
+struct KernelOutputs {
+    std::vector<float> products, inverses, determinants, clip, dots, areas;
+    std::vector<Vector3> points, directions, crossed, normalized;
+};
+
+template <typename T>
+bool sameBits(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+// Every SIMD kernel must match the scalar kernels bit for bit on 100k random
+// vectors and 1000 random matrices, and the affine fast path of
+// Matrix4x4::operator* must keep to what its comment promises against the
+// general product. Returns the number of failed cases.
+int checkKernels() {
+    // Not a multiple of any vector width, so the scalar tails run too
+    const size_t count = 100003;
+    const size_t matrixCount = 1000;
+    uint32_t seed = 1;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) * (1.0f / 16777216.0f) * 200.0f - 100.0f;
+    };
+    std::vector<Vector3> a(count), b(count);
+    for (size_t i = 0; i < count; i++) {
+        a[i] = Vector3(random(), random(), random());
+        b[i] = Vector3(random(), random(), random());
+    }
+    std::vector<float> matrices(matrixCount * 16);
+    for (float& value : matrices) value = random();
+    
+    // The first random matrix has a full bottom row, so the w divide of
+    // transformPoints is exercised as well
+    const float* m = matrices.data();
+    auto run = [&](KernelOutputs& out) {
+        out.products.resize(matrixCount * 16);
+        out.inverses.resize(matrixCount * 16);
+        out.determinants.resize(matrixCount);
+        for (size_t i = 0; i < matrixCount; i++) {
+            MathKernels::multiply4x4(&matrices[i * 16], &matrices[(i + 1) % matrixCount * 16], &out.products[i * 16]);
+            out.determinants[i] = MathKernels::inverse4x4(&matrices[i * 16], &out.inverses[i * 16]);
+        }
+        out.points.resize(count);
+        out.clip.resize(count * 4);
+        out.directions.resize(count);
+        out.dots.resize(count);
+        out.crossed.resize(count);
+        out.normalized.resize(count);
+        out.areas.resize(count);
+        MathKernels::transformPoints(m, a.data(), count, out.points.data());
+        MathKernels::transformPointsToClip(m, a.data(), count, out.clip.data());
+        MathKernels::transformDirections(m, a.data(), count, out.directions.data());
+        MathKernels::dot(a.data(), b.data(), count, out.dots.data());
+        MathKernels::cross(a.data(), b.data(), count, out.crossed.data());
+        MathKernels::normalize(a.data(), count, out.normalized.data());
+        MathKernels::triangleAreas(a.data(), b.data(), count, out.areas.data());
+    };
+    
+    MathKernels::Isa best = MathKernels::supportedIsa();
+    KernelOutputs reference;
+    MathKernels::setIsa(MathKernels::Isa::Scalar);
+    run(reference);
+    
+    int failures = 0;
+    MathKernels::Isa isas[] = { MathKernels::Isa::SSE2, MathKernels::Isa::AVX2, MathKernels::Isa::AVX512 };
+    for (MathKernels::Isa isa : isas) {
+        std::string prefix = std::string("kernels/") + MathKernels::isaName(isa);
+        if (!MathKernels::setIsa(isa)) {
+            std::cout << prefix << ": not supported, skipped" << std::endl;
+            continue;
+        }
+        KernelOutputs out;
+        run(out);
+        auto report = [&](const char* name, bool passed) {
+            std::cout << prefix << "/" << name << ": " << (passed ? "ok" : "FAILED") << std::endl;
+            if (!passed) failures++;
+        };
+        report("multiply4x4", sameBits(out.products, reference.products));
+        report("inverse4x4", sameBits(out.inverses, reference.inverses) &&
+                             sameBits(out.determinants, reference.determinants));
+        report("transformPoints", sameBits(out.points, reference.points));
+        report("transformPointsToClip", sameBits(out.clip, reference.clip));
+        report("transformDirections", sameBits(out.directions, reference.directions));
+        report("dot", sameBits(out.dots, reference.dots));
+        report("cross", sameBits(out.crossed, reference.crossed));
+        report("normalize", sameBits(out.normalized, reference.normalized));
+        report("triangleAreas", sameBits(out.areas, reference.areas));
+    }
+    MathKernels::setIsa(best);
+    
+    // Equal entries everywhere, identical bits for every non-zero entry
+    bool affineMatches = true;
+    std::vector<Matrix4x4> models(matrixCount);
+    for (auto& model : models) {
+        model = TransformationPipeline::composeModelMatrix(Vector3(random(), random(), random()),
+                                                           Vector3(random() * 1.8f, random() * 1.8f, random() * 1.8f),
+                                                           Vector3(random() * 0.1f, random() * 0.1f, random() * 0.1f));
+    }
+    for (size_t i = 0; i < matrixCount; i++) {
+        const Matrix4x4& a = models[i];
+        const Matrix4x4& b = models[(i + 1) % matrixCount];
+        Matrix4x4 fast = a * b;
+        float general[16];
+        MathKernels::multiply4x4(&a.m[0][0], &b.m[0][0], general);
+        for (int k = 0; k < 16; k++) {
+            float value = (&fast.m[0][0])[k];
+            if (value != general[k] || (value != 0.0f && std::memcmp(&value, &general[k], sizeof(float)) != 0)) {
+                affineMatches = false;
+            }
+        }
+    }
+    std::cout << "kernels/affine_product/random: " << (affineMatches ? "ok" : "FAILED") << std::endl;
+    if (!affineMatches) failures++;
+    
+    // Three -0 products: the fast path keeps -0 where the general product
+    // adds 5 * 0 and gives +0, which still compares equal
+    Matrix4x4 negative(-1.0f, 0.0f, 0.0f, 5.0f,
+                       0.0f, 1.0f, 0.0f, 0.0f,
+                       0.0f, 0.0f, 1.0f, 0.0f,
+                       0.0f, 0.0f, 0.0f, 1.0f);
+    Matrix4x4 shear(0.0f, 0.0f, 0.0f, 0.0f,
+                    -1.0f, 1.0f, 0.0f, 0.0f,
+                    -1.0f, 0.0f, 1.0f, 0.0f,
+                    0.0f, 0.0f, 0.0f, 1.0f);
+    float general[16];
+    MathKernels::multiply4x4(&negative.m[0][0], &shear.m[0][0], general);
+    bool zeroEqual = (negative * shear).m[0][0] == general[0];
+    std::cout << "kernels/affine_product/signed_zero: " << (zeroEqual ? "ok" : "FAILED") << std::endl;
+    if (!zeroEqual) failures++;
+    return failures;
+}
+
+// All checks in turn, for CI; returns the total number of failed cases
+int checkAll() {
+    int failures = checkAllocations();
+    failures += checkOcclusion();
+    failures += checkLoaders();
+    failures += checkCache();
+    failures += checkKernels();
+    std::cout << (failures == 0 ? "All checks passed" : std::to_string(failures) + " checks FAILED") << std::endl;
+    return failures;
+}
+
+void printUsage() {
+    std::cout << "Usage: benchmark [--json FILE] [--filter TEXT] [--samples N] [--min-time SECONDS] [--label TEXT]\n"
+              << "       benchmark --check\n"
+              << "       benchmark --check-allocations\n"
+              << "       benchmark --check-occlusion\n"
+              << "       benchmark --check-loaders\n"
+              << "       benchmark --check-cache\n"
+              << "       benchmark --check-kernels" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json" && hasValue) options.jsonPath = argv[++i];
+        else if (arg == "--filter" && hasValue) options.filter = argv[++i];
+        else if (arg == "--samples" && hasValue) options.samples = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--min-time" && hasValue) options.minSampleSeconds = std::atof(argv[++i]);
+        else if (arg == "--label" && hasValue) options.label = argv[++i];
+        else if (arg == "--check") return checkAll() == 0 ? 0 : 1;
+        else if (arg == "--check-allocations") return checkAllocations() == 0 ? 0 : 1;
+        else if (arg == "--check-occlusion") return checkOcclusion() == 0 ? 0 : 1;
+        else if (arg == "--check-loaders") return checkLoaders() == 0 ? 0 : 1;
+        else if (arg == "--check-cache") return checkCache() == 0 ? 0 : 1;
+        else if (arg == "--check-kernels") return checkKernels() == 0 ? 0 : 1;
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    
+    std::cout << "Median ns per call, +- relative stddev over " << options.samples << " samples ("
+              << MathKernels::isaName(MathKernels::activeIsa()) << ", "
+              << ThreadPool::shared().size() << " threads)" << std::endl;
+    
+    BenchmarkSuite suite(options);
+    benchmarkMatrix(suite);
+    benchmarkVertexThroughput(suite);
+    benchmarkMathKernels(suite);
+    benchmarkMeshGeneration(suite);
+    benchmarkMeshLayout(suite);
+    benchmarkMeshImport(suite);
+    benchmarkSceneGraph(suite);
+    benchmarkAnimation(suite);
+    benchmarkCulling(suite);
+    benchmarkTextureSampling(suite);
+    benchmarkFrame(suite);
+    benchmarkClipping(suite);
+    benchmarkFaceCulling(suite);
+    benchmarkInstancing(suite);
+    benchmarkLOD(suite);
+    benchmarkEdgeExtraction(suite);
+    benchmarkMeshOptimizer(suite);
+    benchmarkOcclusion(suite);
+    
+    if (!options.jsonPath.empty()) {
+        if (!suite.writeJson(options.jsonPath)) {
+            std::cerr << "Cannot write " << options.jsonPath << std::endl;
+            return 1;
+        }
+        std::cout << "Results written to " << options.jsonPath << std::endl;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -2,16 +2,32 @@
 #include <vector>
 #include <string>
 
-// macOS specific OpenGL includes
+// OpenGL and GLUT from the macOS frameworks, or Mesa and freeglut elsewhere
+#ifdef __APPLE__
 #define GL_SILENCE_DEPRECATION
 #include <OpenGL/gl.h>
 #include <GLUT/glut.h>
+#else
+// Buffer object entry points are prototypes only with this on Mesa
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glut.h>
+#endif
 
 #include "Vector3.h"
 #include "Matrix4x4.h"
 #include "Object3D.h"
 #include "TransformationPipeline.h"
 #include "TextureLoader.h"
+#include "MeshBuffers.h"
+#include "SceneGraph.h"
+#include "BVH.h"
+#include "LODChain.h"
+#include "MeshOptimizer.h"
+#include "FrameProfiler.h"
 
 int windowWidth = 800;
 int windowHeight = 600;
@@ -39,6 +55,31 @@ int currentObjectIndex = 0;
 std::vector<Object3D> objects;
 std::vector<GLuint> textures;
 
+// The user-controlled root node carries every object node. Only the
+// current object is drawn unless all objects are shown side by side.
+SceneGraph scene;
+SceneGraph::NodeId rootNode = SceneGraph::INVALID_NODE;
+std::vector<SceneGraph::NodeId> objectNodes;
+bool showAllObjects = false;
+
+// World bounds of the objects on screen for frustum culling; BVH instance
+// i is objects[bvhObjects[i]]. Rebuilt when the set of shown objects
+// changes, refit when they move.
+BVH objectBVH;
+std::vector<int> bvhObjects;
+bool bvhObjectsDirty = true;
+CullStats cullStats;
+
+// Simplified versions of every object and the level each was last drawn
+// at, which select() needs for its hysteresis
+std::vector<LODChain> objectLODs;
+std::vector<size_t> objectLODLevels;
+size_t trianglesDrawn = 0;
+
+// Retained GPU copies of every level of every object, uploaded on first
+// draw and after edits
+std::vector<std::vector<MeshBuffers>> meshBuffers;
+
 std::vector<std::string> objectNames = {"Cube", "Pyramid", "Tetrahedron", "Sphere"};
 
 TransformationPipeline pipeline;
@@ -64,6 +105,67 @@ void setupLighting() {
     }
 }
 
+void updateRootTransform() {
+    scene.setLocalTransform(rootNode, objectPosition, objectRotation, objectScale);
+}
+
+// Objects sit at the root, or on a circle around it when all are shown
+void layoutObjectNodes() {
+    for (size_t i = 0; i < objectNodes.size(); i++) {
+        float angle = 2.0f * M_PI * i / objectNodes.size();
+        Vector3 offset = showAllObjects ? Vector3(2.0f * std::sin(angle), 0.0f, 2.0f * std::cos(angle)) : Vector3(0.0f, 0.0f, 0.0f);
+        scene.setLocalTransform(objectNodes[i], offset, Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f));
+    }
+}
+
+AABB objectWorldBounds(int index) {
+    return objects[index].bounds.transformed(scene.worldMatrix(objectNodes[index]));
+}
+
+// Rebuilds the chain when the object was edited since it was simplified
+const LODChain& objectLOD(int index) {
+    LODChain& chain = objectLODs[index];
+    if (chain.levels.empty() || chain.levels[0].mesh.revision != objects[index].revision) {
+        chain = LODChain::build(objects[index]);
+        objectLODLevels[index] = 0;
+        meshBuffers[index].clear();
+        meshBuffers[index].resize(chain.levelCount());
+    }
+    return chain;
+}
+
+// Level for the object's current projected size; the caller has applied
+// the object's world matrix
+size_t selectObjectLOD(int index, const Matrix4x4& world) {
+    const LODChain& chain = objectLOD(index);
+    float size = LODChain::screenSize(objects[index].boundingSphere, pipeline.viewMatrix * world,
+                                      pipeline.projectionMatrix, windowHeight);
+    objectLODLevels[index] = chain.select(size, objectLODLevels[index]);
+    return objectLODLevels[index];
+}
+
+void updateObjectBVH() {
+    if (bvhObjectsDirty) {
+        bvhObjects.clear();
+        std::vector<AABB> bounds;
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (!showAllObjects && static_cast<int>(i) != currentObjectIndex) continue;
+            bvhObjects.push_back(static_cast<int>(i));
+            bounds.push_back(objectWorldBounds(static_cast<int>(i)));
+        }
+        objectBVH.build(bounds);
+        bvhObjectsDirty = false;
+        return;
+    }
+    
+    for (size_t k = 0; k < bvhObjects.size(); k++) {
+        if (scene.worldChanged(objectNodes[bvhObjects[k]])) {
+            objectBVH.setInstanceBounds(k, objectWorldBounds(bvhObjects[k]));
+        }
+    }
+    objectBVH.refit();
+}
+
 void renderText(float x, float y, const char *text) {
     glDisable(GL_LIGHTING);
     glDisable(GL_TEXTURE_2D);
@@ -115,7 +217,15 @@ void displayInstructions() {
     renderText(10, windowHeight - 70, "Controls:");
     renderText(10, windowHeight - 90, "WASD: Move | Q/E: Up/Down | Arrows: Rotate X/Y | Z/X: Rotate Z");
     renderText(10, windowHeight - 110, "+/-: Scale | R: Reset | F: Wireframe | T: Depth Test");
-    renderText(10, windowHeight - 130, "L: Lighting | G: Textures | TAB: Switch Object | H: Hide/Show Help");
+    renderText(10, windowHeight - 130, "L: Lighting | G: Textures | TAB: Switch Object | O: All Objects | H: Hide/Show Help | P: Profile");
+    
+    sprintf(buffer, "Culling: %zu tested, %zu culled, %zu drawn",
+            cullStats.objectsTested, cullStats.objectsCulled, cullStats.objectsDrawn);
+    renderText(10, 70, buffer);
+    
+    sprintf(buffer, "LOD: %s at level %zu of %zu, %zu triangles drawn", objectNames[currentObjectIndex].c_str(),
+            objectLODLevels[currentObjectIndex], objectLODs[currentObjectIndex].levelCount(), trianglesDrawn);
+    renderText(10, 90, buffer);
     
     sprintf(buffer, "Position: (%.1f, %.1f, %.1f)", objectPosition.x, objectPosition.y, objectPosition.z);
     renderText(10, 50, buffer);
@@ -127,6 +237,43 @@ void displayInstructions() {
     renderText(10, 10, buffer);
 }
 
+// Material, texture and retained buffers of one object at the given level
+// of detail; the caller has already applied its world matrix
+void drawObject(int index, size_t level) {
+    const Object3D& object = objects[index];
+    
+    if (!wireframeMode && texturesEnabled) {
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, textures[index]);
+    } else {
+        glDisable(GL_TEXTURE_2D);
+    }
+    
+    GLfloat materialAmbient[] = { object.color[0] * 0.2f, object.color[1] * 0.2f, object.color[2] * 0.2f, 1.0f };
+    GLfloat materialDiffuse[] = { object.color[0], object.color[1], object.color[2], 1.0f };
+    GLfloat materialSpecular[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glMaterialfv(GL_FRONT, GL_AMBIENT, materialAmbient);
+    glMaterialfv(GL_FRONT, GL_DIFFUSE, materialDiffuse);
+    glMaterialfv(GL_FRONT, GL_SPECULAR, materialSpecular);
+    glMaterialf(GL_FRONT, GL_SHININESS, shininess);
+    
+    MeshBuffers& buffers = meshBuffers[index][level];
+    buffers.update(objectLODs[index].level(level));
+    trianglesDrawn += objectLODs[index].levels[level].triangleCount;
+    
+    if (wireframeMode) {
+        glDisable(GL_LIGHTING);
+        glColor3f(object.color[0], object.color[1], object.color[2]);
+        buffers.drawEdges();
+        
+        if (lightingEnabled) {
+            glEnable(GL_LIGHTING);
+        }
+    } else {
+        buffers.drawTriangles(lightingEnabled, texturesEnabled);
+    }
+}
+
 void display() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
@@ -142,11 +289,17 @@ void display() {
         cameraUp.x, cameraUp.y, cameraUp.z
     );
     
-    glTranslatef(objectPosition.x, objectPosition.y, objectPosition.z);
-    glRotatef(objectRotation.x, 1.0f, 0.0f, 0.0f);
-    glRotatef(objectRotation.y, 0.0f, 1.0f, 0.0f);
-    glRotatef(objectRotation.z, 0.0f, 0.0f, 1.0f);
-    glScalef(objectScale.x, objectScale.y, objectScale.z);
+    {
+        // World matrices and bounds; vertices themselves are transformed
+        // by GL from the retained buffers
+        PROFILE_ZONE("scene update");
+        scene.update();
+        
+        // CPU copy of the GL matrices, for the culling frustum
+        pipeline.setViewTransform(cameraPosition, cameraTarget, cameraUp);
+        pipeline.setProjection(45.0f, (float)windowWidth / (float)windowHeight, 0.1f, 100.0f);
+        updateObjectBVH();
+    }
     
     if (depthTestEnabled) {
         glEnable(GL_DEPTH_TEST);
@@ -160,78 +313,45 @@ void display() {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
     
-    setupLighting();
-    
-    const Object3D& object = objects[currentObjectIndex];
-    
-    if (!wireframeMode && texturesEnabled) {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, textures[currentObjectIndex]);
-    } else {
-        glDisable(GL_TEXTURE_2D);
+    {
+        // Light position is given in world space, before any object transform
+        PROFILE_ZONE("lighting");
+        setupLighting();
     }
     
-    GLfloat materialAmbient[] = { object.color[0] * 0.2f, object.color[1] * 0.2f, object.color[2] * 0.2f, 1.0f };
-    GLfloat materialDiffuse[] = { object.color[0], object.color[1], object.color[2], 1.0f };
-    GLfloat materialSpecular[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-    glMaterialfv(GL_FRONT, GL_AMBIENT, materialAmbient);
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, materialDiffuse);
-    glMaterialfv(GL_FRONT, GL_SPECULAR, materialSpecular);
-    glMaterialf(GL_FRONT, GL_SHININESS, shininess);
-    
-    if (wireframeMode) {
-        glDisable(GL_LIGHTING);
-        glColor3f(object.color[0], object.color[1], object.color[2]);
-        
-        glBegin(GL_LINES);
-        for (const auto& edge : object.edges) {
-            const Vector3& v1 = object.vertices[edge.first];
-            const Vector3& v2 = object.vertices[edge.second];
+    {
+        PROFILE_ZONE("raster");
+        cullStats.reset();
+        trianglesDrawn = 0;
+        objectBVH.cull(pipeline.getFrustum(), cullStats, [](size_t instance) {
+            int index = bvhObjects[instance];
+            const Matrix4x4& world = scene.worldMatrix(objectNodes[index]);
+            size_t level = selectObjectLOD(index, world);
             
-            glVertex3f(v1.x, v1.y, v1.z);
-            glVertex3f(v2.x, v2.y, v2.z);
-        }
-        glEnd();
-        
-        if (lightingEnabled) {
-            glEnable(GL_LIGHTING);
-        }
-    } else {
-        for (const auto& face : object.faces) {
-            if (face.size() == 3) {
-                glBegin(GL_TRIANGLES);
-            } else {
-                glBegin(GL_POLYGON);
-            }
-            
-            for (size_t i = 0; i < face.size(); i++) {
-                int vertexIndex = face[i];
-                
-                if (lightingEnabled && !object.normals.empty() && vertexIndex < object.normals.size()) {
-                    const Vector3& normal = object.normals[vertexIndex];
-                    glNormal3f(normal.x, normal.y, normal.z);
-                }
-                
-                if (texturesEnabled && !object.texCoords.empty() && vertexIndex < object.texCoords.size()) {
-                    glTexCoord2f(object.texCoords[vertexIndex].first, 
-                                object.texCoords[vertexIndex].second);
-                }
-                
-                const Vector3& vertex = object.vertices[vertexIndex];
-                glVertex3f(vertex.x, vertex.y, vertex.z);
-            }
-            
-            glEnd();
-        }
+            // OpenGL expects column-major matrices
+            Matrix4x4 columnMajor = world.transpose();
+            glPushMatrix();
+            glMultMatrixf(&columnMajor.m[0][0]);
+            drawObject(index, level);
+            glPopMatrix();
+        });
     }
     
-    displayInstructions();
+    {
+        PROFILE_ZONE("text overlay");
+        displayInstructions();
+    }
     
     glDisable(GL_TEXTURE_2D);
     
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     
-    glutSwapBuffers();
+    {
+        PROFILE_ZONE("buffer swap");
+        glutSwapBuffers();
+    }
+    
+    FrameProfiler::instance().endFrame();
 }
 
 void reshape(int width, int height) {
@@ -256,7 +376,7 @@ void keyboard(unsigned char key, int x, int y) {
         
         case 'z': objectRotation.z += rotateSpeed; break;
         case 'x': objectRotation.z -= rotateSpeed; break;
-
+        
         case '+': case '=':
             objectScale.x += scaleSpeed;
             objectScale.y += scaleSpeed;
@@ -283,29 +403,46 @@ void keyboard(unsigned char key, int x, int y) {
         case 't':
             depthTestEnabled = !depthTestEnabled;
             break;
-            
+        
         case 'l':
             lightingEnabled = !lightingEnabled;
             break;
-            
+        
         case 'g':
             texturesEnabled = !texturesEnabled;
             break;
         
+        case 'p': case 'P':
+            // Rolling summary to the console, recent events as a Chrome trace
+            std::cout << FrameProfiler::instance().summary();
+            if (FrameProfiler::instance().writeChromeTrace("frame_trace.json")) {
+                std::cout << "Trace written to frame_trace.json" << std::endl;
+            }
+            break;
+        
         case 'h': case 'H':
             showInstructions = !showInstructions;
             break;
         
+        case 'o': case 'O':
+            showAllObjects = !showAllObjects;
+            layoutObjectNodes();
+            bvhObjectsDirty = true;
+            break;
+        
         case '\t':
             currentObjectIndex = (currentObjectIndex + 1) % objects.size();
+            bvhObjectsDirty = true;
             break;
         
         case 27:
+            meshBuffers.clear();
             TextureLoader::cleanup();
             exit(0);
             break;
     }
     
+    updateRootTransform();
     glutPostRedisplay();
 }
 
@@ -327,6 +464,7 @@ void specialKeys(int key, int x, int y) {
             break;
     }
     
+    updateRootTransform();
     glutPostRedisplay();
 }
 
@@ -337,6 +475,9 @@ int main(int argc, char** argv) {
     glutInitWindowPosition(100, 100);
     glutCreateWindow("3D Transformation and Rendering");
     
+    FrameProfiler::setEnabled(true);
+    FrameProfiler::instance().setThreadName("main");
+    
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboard);
@@ -351,13 +492,32 @@ int main(int argc, char** argv) {
     objects.push_back(Object3D::createCube(1.0f));
     objects.push_back(Object3D::createPyramid(1.0f, 1.5f));
     objects.push_back(Object3D::createTetrahedron(1.0f));
-    objects.push_back(Object3D::createSphere(1.0f, 12));
+    objects.push_back(Object3D::createSphere(1.0f, 48));
     
     objects[0].setColor(1.0f, 0.0f, 0.0f);  // Red cube
     objects[1].setColor(0.0f, 1.0f, 0.0f);  // Green pyramid
     objects[2].setColor(0.0f, 0.0f, 1.0f);  // Blue tetrahedron
     objects[3].setColor(1.0f, 1.0f, 0.0f);  // Yellow sphere
     
+    // Fewer vertex transforms per triangle on the GPU's post-transform cache
+    for (size_t i = 0; i < objects.size(); i++) {
+        MeshOptimizer::Report report = MeshOptimizer::optimize(objects[i]);
+        std::cout << objectNames[i] << ": vertex cache ACMR " << report.before.acmr() << " -> " << report.after.acmr()
+                  << ", ATVR " << report.before.atvr() << " -> " << report.after.atvr() << std::endl;
+    }
+    objectLODs.resize(objects.size());
+    objectLODLevels.resize(objects.size());
+    meshBuffers.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); i++) {
+        objectLOD(static_cast<int>(i));
+    }
+    
+    rootNode = scene.addNode(SceneGraph::INVALID_NODE);
+    for (size_t i = 0; i < objects.size(); i++) {
+        objectNodes.push_back(scene.addNode(rootNode, Matrix4x4(), static_cast<int>(i)));
+    }
+    layoutObjectNodes();
+    
     textures.push_back(TextureLoader::createProceduralTexture("checkerboard"));
     textures.push_back(TextureLoader::createProceduralTexture("brick"));
     textures.push_back(TextureLoader::createProceduralTexture("gradient"));
@@ -376,7 +536,9 @@ int main(int argc, char** argv) {
     std::cout << "  L: Toggle lighting" << std::endl;
     std::cout << "  G: Toggle textures" << std::endl;
     std::cout << "  H: Toggle on-screen instructions" << std::endl;
+    std::cout << "  P: Print frame profile and write frame_trace.json" << std::endl;
     std::cout << "  TAB: Switch between objects" << std::endl;
+    std::cout << "  O: Show all objects around the center" << std::endl;
     std::cout << "  ESC: Exit application" << std::endl;
     
     glutMainLoop();